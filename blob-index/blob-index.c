@@ -1,6 +1,11 @@
 #include <stdio.h>  /* for printf() */
 #include <stdlib.h> /* for free() */
 #include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "blob-index.h"
 #include "config.h"
@@ -13,41 +18,107 @@
 
 #include <assert.h>
 
-#if 0
-typedef off_t blob_ptr_t; /* large index */
-#else
-typedef uint32_t blob_ptr_t; /* small index */
-#endif
+typedef uint32_t blob_ptr_v1_t; /* small index (version 1) */
+typedef uint64_t blob_ptr_t;    /* large index */
 
 typedef uint32_t blob_sz_t;
 
 struct blob_index {
+	uint32_t version;
+
+	/* files opened for writing (NULL if index is read-only) */
 	FILE *ptr_file;
 	FILE *dat_file;
+
+	/* mapped files of read-only index */
+	const char *ptr_map, *dat_map;
+	size_t      ptr_map_sz, dat_map_sz;
 };
 
-blob_index_t
-blob_index_open(const char * path, enum blob_open_mode mode)
+static size_t head_size(uint32_t version)
 {
-	struct blob_index *bi;
-	char ptr_file_path[BLOBINDEX_FILEPATH_MAX_LEN];
-	char dat_file_path[BLOBINDEX_FILEPATH_MAX_LEN];
+	return (version == 1) ? 0 : sizeof(struct blob_index_head);
+}
 
-	sprintf(ptr_file_path, "%s.ptr.bin", path);
-	sprintf(dat_file_path, "%s.dat.bin", path);
+static size_t ptr_size(uint32_t version)
+{
+	return (version == 1) ? sizeof(blob_ptr_v1_t) : sizeof(blob_ptr_t);
+}
 
-	bi = malloc(sizeof(struct blob_index));
-	assert(NULL != bi);
+/* files without a head are of version 1 */
+static uint32_t head_version(const void *head, size_t sz)
+{
+	struct blob_index_head h;
+
+	if (sz < sizeof(h))
+		return 1;
 
-	if (mode == BLOB_OPEN_RD) {
-		bi->ptr_file = fopen(ptr_file_path, "r");
-		bi->dat_file = fopen(dat_file_path, "r");
-	} else if (mode == BLOB_OPEN_WR) {
-		bi->ptr_file = fopen(ptr_file_path, "r+");
-		bi->dat_file = fopen(dat_file_path, "a");
+	memcpy(&h, head, sizeof(h));
+	return (h.magic == BLOB_INDEX_MAGIC) ? h.version : 1;
+}
+
+/* map a whole file read-only (NULL map if it is empty), return non-zero
+ * if file cannot be opened. */
+static int map_file(const char *path, const char **map, size_t *sz)
+{
+	int fd;
+	struct stat st;
+	void *p;
+
+	*map = NULL;
+	*sz = 0;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return 1;
+
+	if (0 != fstat(fd, &st)) {
+		close(fd);
+		return 1;
+	}
+
+	if (st.st_size == 0) {
+		close(fd);
+		return 0;
 	}
 
-	if (mode == BLOB_OPEN_WR && bi->ptr_file == NULL) {
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (p == MAP_FAILED) {
+		perror("mmap() function");
+		return 1;
+	}
+
+	*map = p;
+	*sz = st.st_size;
+	return 0;
+}
+
+static int open_rd(struct blob_index *bi, const char *ptr_file_path,
+                   const char *dat_file_path)
+{
+	if (map_file(ptr_file_path, &bi->ptr_map, &bi->ptr_map_sz) ||
+	    map_file(dat_file_path, &bi->dat_map, &bi->dat_map_sz))
+		return 1;
+
+	/* blobs are read at random */
+	if (bi->dat_map)
+		madvise((void*)bi->dat_map, bi->dat_map_sz, MADV_RANDOM);
+
+	bi->version = head_version(bi->ptr_map, bi->ptr_map_sz);
+	return 0;
+}
+
+static int open_wr(struct blob_index *bi, const char *ptr_file_path,
+                   const char *dat_file_path)
+{
+	struct blob_index_head head = {BLOB_INDEX_MAGIC, BLOB_INDEX_VERSION};
+	off_t ptr_file_sz, dat_file_sz;
+
+	bi->ptr_file = fopen(ptr_file_path, "r+");
+	bi->dat_file = fopen(dat_file_path, "a+"); /* readable for read_wr() */
+
+	if (bi->ptr_file == NULL) {
 		/*
 		 * file at ptr_file_path does not exists, since
 		 * "r+" mode does not create a file, we need to
@@ -61,8 +132,58 @@ blob_index_open(const char * path, enum blob_open_mode mode)
 	}
 
 	if (bi->ptr_file == NULL ||
-	    bi->dat_file == NULL) {
+	    bi->dat_file == NULL)
+		return 1;
+
+	assert(0 == fseeko(bi->ptr_file, 0, SEEK_END));
+	assert(0 == fseeko(bi->dat_file, 0, SEEK_END));
+	ptr_file_sz = ftello(bi->ptr_file);
+	dat_file_sz = ftello(bi->dat_file);
+
+	if (ptr_file_sz == 0 && dat_file_sz == 0) {
+		/* new index is created in current version */
+		fwrite(&head, 1, sizeof(head), bi->ptr_file);
+		fwrite(&head, 1, sizeof(head), bi->dat_file);
+		bi->version = BLOB_INDEX_VERSION;
+
+	} else {
+		/* existing index is appended in its own version */
+		assert(0 == fseeko(bi->ptr_file, 0, SEEK_SET));
+		if (sizeof(head) != fread(&head, 1, sizeof(head), bi->ptr_file))
+			bi->version = 1;
+		else
+			bi->version = head_version(&head, sizeof(head));
+	}
+
+	return 0;
+}
 
+blob_index_t
+blob_index_open(const char * path, enum blob_open_mode mode)
+{
+	struct blob_index *bi;
+	char ptr_file_path[BLOBINDEX_FILEPATH_MAX_LEN];
+	char dat_file_path[BLOBINDEX_FILEPATH_MAX_LEN];
+	int  err = 1;
+
+	sprintf(ptr_file_path, "%s.ptr.bin", path);
+	sprintf(dat_file_path, "%s.dat.bin", path);
+
+	bi = calloc(1, sizeof(struct blob_index));
+	assert(NULL != bi);
+
+	if (mode == BLOB_OPEN_RD)
+		err = open_rd(bi, ptr_file_path, dat_file_path);
+	else if (mode == BLOB_OPEN_WR)
+		err = open_wr(bi, ptr_file_path, dat_file_path);
+
+	if (!err && bi->version > BLOB_INDEX_VERSION) {
+		fprintf(stderr, "blob index: unsupported version %u.\n",
+		        bi->version);
+		err = 1;
+	}
+
+	if (err) {
 		blob_index_close(bi);
 		return NULL;
 	}
@@ -70,27 +191,36 @@ blob_index_open(const char * path, enum blob_open_mode mode)
 	return bi;
 }
 
-static blob_ptr_t file_seek_end(FILE *fh)
-{
-	assert(0 == fseek(fh, 0L, SEEK_END));
-	return (blob_ptr_t)ftell(fh);
-}
-
 size_t
 blob_index_write(blob_index_t index, doc_id_t docID,
                  const void *blob, size_t size)
 {
 	struct blob_index *bi = (struct blob_index *)index;
-	blob_ptr_t ptr_wr_pos = (docID * sizeof(blob_ptr_t));
-	blob_ptr_t dat_pos = ftell(bi->dat_file);
-	blob_sz_t  blob_sz;
+	off_t ptr_wr_pos, dat_pos;
+	blob_ptr_t    ptr;
+	blob_ptr_v1_t ptr_v1;
+	blob_sz_t     blob_sz;
 	size_t blob_sz_written;
 
-	assert(0 == fseek(bi->ptr_file, ptr_wr_pos, SEEK_SET));
+	if (bi->ptr_file == NULL) {
+		fprintf(stderr, "blob index: write to read-only index.\n");
+		return 0;
+	}
+
+	ptr_wr_pos = head_size(bi->version) +
+	             (off_t)docID * ptr_size(bi->version);
+	dat_pos = ftello(bi->dat_file);
+
+	if (bi->version == 1 && dat_pos > UINT32_MAX) {
+		fprintf(stderr, "blob index: version 1 index exceeds 4 GB.\n");
+		return 0;
+	}
+
+	assert(0 == fseeko(bi->ptr_file, ptr_wr_pos, SEEK_SET));
 
 #ifdef DEBUG_BLOBINDEX
 	printf("blob writing: ptr_wr_pos, dat_pos @ (%lu, %lu)\n",
-	       (off_t)ftell(bi->ptr_file), (off_t)dat_pos);
+	       (off_t)ftello(bi->ptr_file), (off_t)dat_pos);
 #endif
 
 	/* write blob data file */
@@ -99,44 +229,163 @@ blob_index_write(blob_index_t index, doc_id_t docID,
 	blob_sz_written = fwrite(blob, 1, size, bi->dat_file);
 
 	/* write pointer file with saved blob data position */
-	fwrite(&dat_pos, 1, sizeof(blob_ptr_t), bi->ptr_file);
+	if (bi->version == 1) {
+		ptr_v1 = (blob_ptr_v1_t)dat_pos;
+		fwrite(&ptr_v1, 1, sizeof(blob_ptr_v1_t), bi->ptr_file);
+	} else {
+		ptr = (blob_ptr_t)dat_pos;
+		fwrite(&ptr, 1, sizeof(blob_ptr_t), bi->ptr_file);
+	}
 
 	return blob_sz_written;
 }
 
-size_t blob_index_read(blob_index_t index, doc_id_t docID, void **blob)
+/* decode blob data position from a pointer of index version */
+static blob_ptr_t decode_ptr(uint32_t version, const void *p)
 {
-	struct blob_index *bi = (struct blob_index *)index;
-	blob_ptr_t ptr_rd_pos = (docID * sizeof(blob_ptr_t));
-	blob_ptr_t ptr_file_end = file_seek_end(bi->ptr_file);
+	blob_ptr_t    ptr;
+	blob_ptr_v1_t ptr_v1;
+
+	if (version == 1) {
+		memcpy(&ptr_v1, p, sizeof(blob_ptr_v1_t));
+		return ptr_v1;
+	}
+
+	memcpy(&ptr, p, sizeof(blob_ptr_t));
+	return ptr;
+}
+
+/* locate blob in mapped files, error message is returned if not found */
+static const char *
+map_locate(struct blob_index *bi, doc_id_t docID, size_t *size,
+           const char **err)
+{
+	size_t     ptr_sz = ptr_size(bi->version);
+	size_t     ptr_rd_pos = head_size(bi->version) + (size_t)docID * ptr_sz;
 	blob_ptr_t dat_pos;
 	blob_sz_t  blob_sz;
 
-	if (ptr_rd_pos + sizeof(blob_ptr_t) > ptr_file_end) {
-		fprintf(stderr, "blob index: not indexed docID.\n");
-		*blob = NULL;
-		return 0;
-	}
+	*size = 0;
+	*err = "blob index: not indexed docID.\n";
 
-#ifdef DEBUG_BLOBINDEX
-	printf("blob reading: ptr_wr_pos @ %lu.\n", (off_t)ptr_rd_pos);
-#endif
-	/* seek pointer file to get blob data position */
-	assert(0 == fseek(bi->ptr_file, ptr_rd_pos, SEEK_SET));
-	fread(&dat_pos, 1, sizeof(blob_ptr_t), bi->ptr_file);
+	if (ptr_rd_pos + ptr_sz > bi->ptr_map_sz)
+		return NULL;
+
+	/* pointer of version 2 is zero if docID is not written */
+	dat_pos = decode_ptr(bi->version, bi->ptr_map + ptr_rd_pos);
+	if (bi->version != 1 && dat_pos == 0)
+		return NULL;
 
 #ifdef DEBUG_BLOBINDEX
 	printf("blob reading: dat_pos @ %lu.\n", (off_t)dat_pos);
 #endif
-	/* seek to that data position and first get blob size */
-	assert(0 == fseek(bi->dat_file, dat_pos, SEEK_SET));
-	fread(&blob_sz, 1, sizeof(blob_sz_t), bi->dat_file);
+	*err = "blob index: blob exceeds data file.\n";
+
+	if (dat_pos + sizeof(blob_sz_t) > bi->dat_map_sz)
+		return NULL;
+
+	memcpy(&blob_sz, bi->dat_map + dat_pos, sizeof(blob_sz_t));
+	if (dat_pos + sizeof(blob_sz_t) + blob_sz > bi->dat_map_sz)
+		return NULL;
 
-	/* alloc read buffer */
+	*size = blob_sz;
+	return bi->dat_map + dat_pos + sizeof(blob_sz_t);
+}
+
+const void *
+blob_index_view(blob_index_t index, doc_id_t docID, size_t *size)
+{
+	struct blob_index *bi = (struct blob_index *)index;
+	const char *err;
+
+	if (bi->ptr_file) {
+		*size = 0;
+		return NULL;
+	}
+
+	return map_locate(bi, docID, size, &err);
+}
+
+/* read from index opened for writing */
+static size_t
+read_wr(struct blob_index *bi, doc_id_t docID, void **blob)
+{
+	size_t     ptr_sz = ptr_size(bi->version);
+	off_t      ptr_rd_pos = head_size(bi->version) + (off_t)docID * ptr_sz;
+	char       ptr[sizeof(blob_ptr_t)];
+	blob_ptr_t dat_pos;
+	blob_sz_t  blob_sz;
+	ssize_t    rd_sz;
+
+	*blob = NULL;
+
+	/* written blobs may be still buffered */
+	fflush(bi->ptr_file);
+	fflush(bi->dat_file);
+
+	if (ptr_sz != pread(fileno(bi->ptr_file), ptr, ptr_sz, ptr_rd_pos))
+		goto not_indexed;
+
+	dat_pos = decode_ptr(bi->version, ptr);
+	if (bi->version != 1 && dat_pos == 0)
+		goto not_indexed;
+
+	if (sizeof(blob_sz_t) != pread(fileno(bi->dat_file), &blob_sz,
+	                               sizeof(blob_sz_t), dat_pos)) {
+		fprintf(stderr, "blob index: blob exceeds data file.\n");
+		return 0;
+	}
+
+	/* alloc read buffer, then get blob binary */
 	*blob = malloc(blob_sz);
+	rd_sz = pread(fileno(bi->dat_file), *blob, blob_sz,
+	              dat_pos + sizeof(blob_sz_t));
 
-	/* then, get blob binary */
-	return fread(*blob, 1, blob_sz, bi->dat_file);
+	return (rd_sz < 0) ? 0 : rd_sz;
+
+not_indexed:
+	fprintf(stderr, "blob index: not indexed docID.\n");
+	return 0;
+}
+
+size_t blob_index_read(blob_index_t index, doc_id_t docID, void **blob)
+{
+	struct blob_index *bi = (struct blob_index *)index;
+	const char *view, *err;
+	size_t      size;
+
+	if (bi->ptr_file)
+		return read_wr(bi, docID, blob);
+
+	view = map_locate(bi, docID, &size, &err);
+	if (view == NULL) {
+		fprintf(stderr, "%s", err);
+		*blob = NULL;
+		return 0;
+	}
+
+	/* copy blob out of mapped file */
+	*blob = malloc(size);
+	memcpy(*blob, view, size);
+
+	return size;
+}
+
+bool blob_index_empty(blob_index_t index)
+{
+	struct blob_index *bi = (struct blob_index *)index;
+	struct stat st;
+
+	if (bi->dat_file) {
+		/* written blobs may be still buffered */
+		fflush(bi->dat_file);
+		if (0 != fstat(fileno(bi->dat_file), &st))
+			return 0;
+
+		return ((size_t)st.st_size <= head_size(bi->version));
+	}
+
+	return (bi->dat_map_sz <= head_size(bi->version));
 }
 
 void blob_free(void *blob)
@@ -154,6 +403,12 @@ void blob_index_close(blob_index_t index)
 	if (bi->dat_file)
 		fclose(bi->dat_file);
 
+	if (bi->ptr_map)
+		munmap((void*)bi->ptr_map, bi->ptr_map_sz);
+
+	if (bi->dat_map)
+		munmap((void*)bi->dat_map, bi->dat_map_sz);
+
 	free(index);
 	return;
 }
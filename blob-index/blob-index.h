@@ -1,6 +1,28 @@
+#pragma once
 #include <stddef.h> /* for size_t */
+#include <stdint.h>
+#include <stdbool.h>
 #include "term-index/term-index.h" /* for doc_id_t */
 
+/*
+ * blob index files (version 2):
+ * pointer file: head, 64-bit data file offsets indexed by docID (zero if
+ * the docID is not written);
+ * data file: head, blobs each prefixed by its 32-bit size.
+ *
+ * files without head are of version 1, whose pointers are 32-bit. They
+ * are still read and appended in their own format.
+ */
+#define BLOB_INDEX_MAGIC   0x424f4c42 /* "BLOB" */
+#define BLOB_INDEX_VERSION 2
+
+#pragma pack(push, 1)
+struct blob_index_head {
+	uint32_t magic;
+	uint32_t version;
+};
+#pragma pack(pop)
+
 enum blob_open_mode {
 	BLOB_OPEN_RD,
 	BLOB_OPEN_WR
@@ -8,12 +30,22 @@ enum blob_open_mode {
 
 typedef void * blob_index_t;
 
+/* read-only opened index is memory mapped, it can be read by concurrent
+ * threads. */
 blob_index_t blob_index_open(const char*, enum blob_open_mode);
 
 size_t blob_index_write(blob_index_t, doc_id_t, const void *, size_t);
 
 size_t blob_index_read(blob_index_t, doc_id_t, void **);
 
+/* return blob (and its size) in a read-only opened index without copy,
+ * or NULL silently if blob is not found or index is not read-only. The
+ * returned pointer is valid until index is closed. */
+const void *blob_index_view(blob_index_t, doc_id_t, size_t*);
+
+/* return true if no blob has been written, in any open mode */
+bool blob_index_empty(blob_index_t);
+
 void blob_free(void *);
 
 void blob_index_close(blob_index_t);
@@ -0,0 +1,106 @@
+#include "mhook/mhook.h"
+#include "blob-index.h"
+#include <string.h> /* for strlen() */
+#include <stdio.h>  /* for printf() */
+#include <stdlib.h>
+#include <assert.h>
+
+static const char *strings[] = {"hello", "world!", "blob", "index"};
+
+static void check_view(blob_index_t bi, doc_id_t docID, const char *expect)
+{
+	size_t sz;
+	const char *view = blob_index_view(bi, docID, &sz);
+
+	printf("view doc#%u: ", docID);
+	if (view == NULL) {
+		printf("NULL\n");
+		assert(expect == NULL);
+		return;
+	}
+
+	printf("%.*s\n", (int)sz, view);
+	assert(sz == strlen(expect) && 0 == memcmp(view, expect, sz));
+}
+
+static void check_read(blob_index_t bi, doc_id_t docID, const char *expect)
+{
+	size_t sz;
+	char  *out;
+
+	sz = blob_index_read(bi, docID, (void**)&out);
+	assert(out != NULL && sz == strlen(expect));
+	assert(0 == memcmp(out, expect, sz));
+	blob_free(out);
+}
+
+int main()
+{
+	blob_index_t bi;
+	FILE *fh;
+	uint32_t ptr, blob_sz;
+	int i;
+
+	/* write, docID 3 is left unwritten */
+	remove("./test-view.ptr.bin");
+	remove("./test-view.dat.bin");
+
+	bi = blob_index_open("./test-view", BLOB_OPEN_WR);
+	assert(blob_index_empty(bi));
+	blob_index_write(bi, 1, strings[0], strlen(strings[0]));
+	assert(!blob_index_empty(bi));
+	blob_index_write(bi, 2, strings[1], strlen(strings[1]));
+
+	/* read before close (buffered) */
+	check_read(bi, 2, strings[1]);
+	check_view(bi, 2, NULL);
+	blob_index_close(bi);
+
+	bi = blob_index_open("./test-view", BLOB_OPEN_WR);
+	blob_index_write(bi, 4, strings[3], strlen(strings[3]));
+	blob_index_close(bi);
+
+	/* read-only index returns views */
+	bi = blob_index_open("./test-view", BLOB_OPEN_RD);
+	assert(!blob_index_empty(bi));
+	check_view(bi, 1, strings[0]);
+	check_view(bi, 2, strings[1]);
+	check_view(bi, 3, NULL);
+	check_view(bi, 4, strings[3]);
+	check_view(bi, 5, NULL);
+	check_read(bi, 4, strings[3]);
+	blob_index_close(bi);
+
+	/* version 1 files (without head, 32-bit pointers) */
+	remove("./test-v1.ptr.bin");
+	remove("./test-v1.dat.bin");
+
+	fh = fopen("./test-v1.dat.bin", "w");
+	for (i = 0; i < 3; i++) {
+		blob_sz = strlen(strings[i]);
+		fwrite(&blob_sz, 1, sizeof(blob_sz), fh);
+		fwrite(strings[i], 1, blob_sz, fh);
+	}
+	fclose(fh);
+
+	fh = fopen("./test-v1.ptr.bin", "w");
+	for (ptr = 0, i = 0; i < 3; i++) {
+		fwrite(&ptr, 1, sizeof(ptr), fh);
+		ptr += sizeof(blob_sz) + strlen(strings[i]);
+	}
+	fclose(fh);
+
+	/* append in version 1 */
+	bi = blob_index_open("./test-v1", BLOB_OPEN_WR);
+	blob_index_write(bi, 3, strings[3], strlen(strings[3]));
+	blob_index_close(bi);
+
+	bi = blob_index_open("./test-v1", BLOB_OPEN_RD);
+	for (i = 0; i < 4; i++)
+		check_view(bi, i, strings[i]);
+	blob_index_close(bi);
+
+	/* check unfree */
+	mhook_print_unfree();
+	return 0;
+}
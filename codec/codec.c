@@ -21,6 +21,9 @@ struct codec *codec_new(enum codec_method method, void* args)
 	case CODEC_GZ:
 		args_sz = 0;
 		break;
+	case CODEC_GZ_DICT:
+		args_sz = sizeof(struct gz_dict_args);
+		break;
 	default:
 		assert(0);
 	}
@@ -55,6 +58,9 @@ char *codec_method_str(enum codec_method method)
 	case CODEC_GZ:
 		strcpy(ret, "GNU zip codec");
 		break;
+	case CODEC_GZ_DICT:
+		strcpy(ret, "GNU zip codec with preset dictionary");
+		break;
 	case CODEC_PLAIN:
 		strcpy(ret, "No codec (plain)");
 		break;
@@ -157,6 +163,14 @@ codec_compress(struct codec* codec, const void* src, size_t src_sz,
 
 		break;
 
+	case CODEC_GZ_DICT:
+		{
+			struct gz_dict_args *args = (struct gz_dict_args*)codec->args;
+			dest_sz = gz_dict_compress(args->dict, args->dict_sz,
+			                           src, src_sz, dest);
+		}
+		break;
+
 	default:
 		assert(0);
 	}
@@ -180,6 +194,14 @@ codec_decompress(struct codec* codec, const void* src, size_t src_sz,
 
 		break;
 
+	case CODEC_GZ_DICT:
+		{
+			struct gz_dict_args *args = (struct gz_dict_args*)codec->args;
+			dest_sz = gz_dict_decompress(args->dict, args->dict_sz,
+			                             src, src_sz, dest, dest_sz);
+		}
+		break;
+
 	default:
 		assert(0);
 	}
@@ -10,10 +10,20 @@ struct for_delta_args {
 };
 /* import END */
 
+/* import gzip with preset dictionary */
+#include "gz-dict.h"
+
+struct gz_dict_args {
+	void  *dict;
+	size_t dict_sz;
+};
+/* import END */
+
 enum codec_method {
 	CODEC_FOR,
 	CODEC_FOR_DELTA,
 	CODEC_GZ,
+	CODEC_GZ_DICT, /* also decompresses CODEC_GZ output */
 	CODEC_PLAIN /* do nothing */
 };
 
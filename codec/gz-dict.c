@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "gz-dict.h"
+
+#define HASH_MASK ((1 << GZ_DICT_HASH_BITS) - 1)
+
+struct dict_seg {
+	size_t   begin;
+	uint64_t score;
+};
+
+static uint32_t kgram_hash(const char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, GZ_DICT_KGRAM);
+
+	/* multiplicative hashing, take the high bits */
+	return (uint32_t)((v * 0x9e3779b97f4a7c15ULL) >> (64 - GZ_DICT_HASH_BITS));
+}
+
+static int seg_score_cmp(const void *a, const void *b)
+{
+	const struct dict_seg *sa = a, *sb = b;
+
+	if (sa->score == sb->score)
+		return 0;
+
+	return (sa->score < sb->score) ? -1 : 1;
+}
+
+/* window score of segment beginning at `begin' */
+static uint64_t
+seg_score(const uint32_t *freq, const uint32_t *hash, size_t begin)
+{
+	uint64_t score = 0;
+	size_t   i;
+
+	for (i = begin; i < begin + GZ_DICT_SEGMENT - GZ_DICT_KGRAM + 1; i++)
+		score += freq[hash[i]];
+
+	return score;
+}
+
+size_t gz_dict_train(const char *sample, const size_t *doc_sz, size_t n,
+                     char *dict, size_t dict_cap)
+{
+	size_t    i, tot = 0, doc = 0, doc_begin = 0, n_segs, n_sel = 0;
+	size_t    epoch, begin, end, best, dict_sz = 0;
+	uint64_t  score, best_score;
+	uint32_t *freq, *last_doc, *hash;
+	struct dict_seg *sel;
+
+	for (i = 0; i < n; i++)
+		tot += doc_sz[i];
+
+	if (dict_cap > GZ_DICT_MAX_SZ)
+		dict_cap = GZ_DICT_MAX_SZ;
+
+	n_segs = dict_cap / GZ_DICT_SEGMENT;
+	if (tot < GZ_DICT_SEGMENT || n_segs == 0)
+		return 0;
+
+	freq = calloc(HASH_MASK + 1, sizeof(uint32_t));
+	last_doc = calloc(HASH_MASK + 1, sizeof(uint32_t));
+	hash = calloc(tot, sizeof(uint32_t));
+	sel = malloc(n_segs * sizeof(struct dict_seg));
+
+	/* count document frequency of k-grams (hash collisions are merged),
+	 * k-grams across documents are also counted, as they are rare. */
+	for (i = 0; i + GZ_DICT_KGRAM <= tot; i++) {
+		hash[i] = kgram_hash(sample + i);
+
+		while (doc < n && i >= doc_begin + doc_sz[doc]) {
+			doc_begin += doc_sz[doc];
+			doc ++;
+		}
+
+		/* document numbers start from 1 in last_doc */
+		if (last_doc[hash[i]] != doc + 1) {
+			last_doc[hash[i]] = doc + 1;
+			freq[hash[i]] ++;
+		}
+	}
+
+	/* select the best segment of each epoch of sample */
+	epoch = tot / n_segs;
+	if (epoch < GZ_DICT_SEGMENT)
+		epoch = GZ_DICT_SEGMENT;
+
+	for (begin = 0; begin + GZ_DICT_SEGMENT <= tot && n_sel < n_segs;
+	     begin += epoch) {
+		end = begin + epoch;
+		if (end > tot)
+			end = tot;
+
+		best = begin;
+		best_score = score = seg_score(freq, hash, begin);
+
+		/* slide segment window through epoch */
+		for (i = begin + 1; i + GZ_DICT_SEGMENT <= end; i++) {
+			score -= freq[hash[i - 1]];
+			score += freq[hash[i + GZ_DICT_SEGMENT - GZ_DICT_KGRAM]];
+
+			if (score > best_score) {
+				best_score = score;
+				best = i;
+			}
+		}
+
+		if (best_score == 0)
+			continue;
+
+		sel[n_sel].begin = best;
+		sel[n_sel].score = best_score;
+		n_sel ++;
+
+		/* k-grams in dictionary are not worth selecting again */
+		for (i = best; i < best + GZ_DICT_SEGMENT - GZ_DICT_KGRAM + 1; i++)
+			freq[hash[i]] = 0;
+	}
+
+	/* put segments of higher score closer to dictionary end */
+	qsort(sel, n_sel, sizeof(struct dict_seg), &seg_score_cmp);
+
+	for (i = 0; i < n_sel; i++) {
+		memcpy(dict + dict_sz, sample + sel[i].begin, GZ_DICT_SEGMENT);
+		dict_sz += GZ_DICT_SEGMENT;
+	}
+
+	free(freq);
+	free(last_doc);
+	free(hash);
+	free(sel);
+
+	return dict_sz;
+}
+
+size_t
+gz_dict_compress(const void *dict, size_t dict_sz,
+                 const void *src, size_t src_sz, void **dest)
+{
+	z_stream zs;
+	size_t   dest_sz = 0;
+	int      res;
+
+	memset(&zs, 0, sizeof(zs));
+	*dest = NULL;
+
+	if (Z_OK != deflateInit(&zs, Z_DEFAULT_COMPRESSION))
+		return 0;
+
+	if (Z_OK != deflateSetDictionary(&zs, dict, dict_sz))
+		goto end;
+
+	dest_sz = deflateBound(&zs, src_sz);
+	*dest = malloc(dest_sz);
+
+	zs.next_in = (Bytef*)src;
+	zs.avail_in = src_sz;
+	zs.next_out = *dest;
+	zs.avail_out = dest_sz;
+
+	res = deflate(&zs, Z_FINISH);
+
+	if (res == Z_STREAM_END) {
+		dest_sz = zs.total_out;
+	} else {
+		dest_sz = 0;
+		free(*dest);
+		*dest = NULL;
+	}
+
+end:
+	deflateEnd(&zs);
+	return dest_sz;
+}
+
+size_t
+gz_dict_decompress(const void *dict, size_t dict_sz,
+                   const void *src, size_t src_sz,
+                   void *dest, size_t dest_sz)
+{
+	z_stream zs;
+	int      res;
+
+	memset(&zs, 0, sizeof(zs));
+	zs.next_in = (Bytef*)src;
+	zs.avail_in = src_sz;
+
+	if (Z_OK != inflateInit(&zs))
+		return 0;
+
+	zs.next_out = dest;
+	zs.avail_out = dest_sz;
+
+	/* streams compressed without dictionary are also decompressed */
+	res = inflate(&zs, Z_FINISH);
+	if (res == Z_NEED_DICT &&
+	    Z_OK == inflateSetDictionary(&zs, dict, dict_sz))
+		res = inflate(&zs, Z_FINISH);
+
+	dest_sz = (res == Z_STREAM_END) ? zs.total_out : 0;
+
+	inflateEnd(&zs);
+	return dest_sz;
+}
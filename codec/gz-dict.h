@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* deflate window size, no dictionary bytes are used beyond it */
+#define GZ_DICT_MAX_SZ    (32 << 10)
+
+/* dictionary is made of segments of sample, scored by the document
+ * frequencies of k-grams in them */
+#define GZ_DICT_SEGMENT   256
+#define GZ_DICT_KGRAM     8
+#define GZ_DICT_HASH_BITS 20
+
+/*
+ * train a preset dictionary of at most `dict_cap' bytes from sample
+ * documents, which are concatenated in `sample' and their sizes are
+ * given in array of length `n'. Most useful segments are put at the end
+ * of dictionary, where they can be referenced at smaller distances.
+ *
+ * Return the size of dictionary.
+ */
+size_t gz_dict_train(const char*, const size_t*, size_t, char*, size_t);
+
+size_t gz_dict_compress(const void*, size_t, const void*, size_t, void**);
+
+size_t gz_dict_decompress(const void*, size_t, const void*, size_t,
+                          void*, size_t);
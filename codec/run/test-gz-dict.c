@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "mhook/mhook.h"
+#include "codec.h"
+
+#define N_DOCS 2000
+
+static const char *sentences[] = {
+	"How do I prove that the sequence converges? ",
+	"Let $f$ be a continuous function on the closed interval. ",
+	"Consider the integral [imath]\\int_0^1 f(x) dx[/imath] here. ",
+	"Use induction on $n$ and the triangle inequality. ",
+	"This follows from the dominated convergence theorem. ",
+	"Could anyone give me a hint on this exercise? ",
+	"Thanks in advance for your help! ",
+	"Hint: try to bound the terms by a geometric series. "
+};
+
+int main()
+{
+	static char sample[N_DOCS * 512];
+	static char out[4096];
+	size_t doc_sz[N_DOCS], sample_sz = 0;
+	size_t i, j, sz, tot_gz = 0, tot_dict = 0;
+	char   dict[GZ_DICT_MAX_SZ];
+	struct gz_dict_args args;
+	struct codec gz = {CODEC_GZ, NULL};
+	struct codec gz_dict = {CODEC_GZ_DICT, &args};
+	void  *compressed;
+
+	/* short documents made of common sentences */
+	srand(1);
+	for (i = 0; i < N_DOCS; i++) {
+		doc_sz[i] = sprintf(sample + sample_sz, "Question %lu: ", i);
+		for (j = 0; j < 3 + rand() % 5; j++)
+			doc_sz[i] += sprintf(sample + sample_sz + doc_sz[i], "%s",
+			                     sentences[rand() % 8]);
+		sample_sz += doc_sz[i];
+	}
+
+	/* train on the first half of documents */
+	args.dict = dict;
+	args.dict_sz = gz_dict_train(sample, doc_sz, N_DOCS / 2, dict,
+	                             sizeof(dict));
+	printf("trained dictionary of %lu bytes.\n", args.dict_sz);
+	assert(args.dict_sz > 0);
+
+	/* compress the other half */
+	for (sample_sz = 0, i = 0; i < N_DOCS; sample_sz += doc_sz[i++]) {
+		if (i < N_DOCS / 2)
+			continue;
+
+		sz = codec_compress(&gz, sample + sample_sz, doc_sz[i], &compressed);
+		tot_gz += sz;
+
+		/* dictionary codec also decompresses plain gzip blobs */
+		assert(doc_sz[i] == codec_decompress(&gz_dict, compressed, sz,
+		                                     out, sizeof(out)));
+		free(compressed);
+
+		sz = codec_compress(&gz_dict, sample + sample_sz, doc_sz[i],
+		                    &compressed);
+		tot_dict += sz;
+
+		memset(out, 0, doc_sz[i]);
+		assert(doc_sz[i] == codec_decompress(&gz_dict, compressed, sz,
+		                                     out, sizeof(out)));
+		assert(0 == memcmp(out, sample + sample_sz, doc_sz[i]));
+
+		/* not decompressed without dictionary */
+		assert(0 == codec_decompress(&gz, compressed, sz,
+		                             out, sizeof(out)));
+		free(compressed);
+	}
+
+	printf("%s: %lu bytes.\n", codec_method_str(CODEC_GZ), tot_gz);
+	printf("%s: %lu bytes.\n", codec_method_str(CODEC_GZ_DICT), tot_dict);
+	assert(tot_dict < tot_gz);
+
+	mhook_print_unfree();
+	return 0;
+}
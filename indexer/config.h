@@ -5,3 +5,18 @@
 #define DEFAULT_INDEXER_OUTPUT_DIR "./tmp"
 
 #define UNFREE_CNT_INDEXER_MAINTAIN 300
+
+/* seconds serial indexer pauses after maintaining index */
+#define INDEXER_MAINTAIN_PAUSE 10
+
+/* max documents in flight (read but not yet written) of pipelined indexer */
+#define INDEXER_PIPELINE_DEPTH 256
+
+/* pipelined indexer maintains index every this many documents
+ * (allocation counter includes documents in flight) */
+#define INDEXER_MAINTAIN_DOCS  20000
+
+/* sample of text blob dictionary training, i.e. text of the first
+ * documents in corpus, up to these limits */
+#define INDEXER_DICT_SAMPLE_SZ   (1024 * 1024 * 8)
+#define INDEXER_DICT_SAMPLE_DOCS 100000
@@ -2,6 +2,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include "parson/parson.h"
 #include "tex-parser/vt100-color.h"
@@ -15,13 +16,25 @@ static void        *term_index = NULL;
 static math_index_t math_index = NULL;
 static blob_index_t blob_index_url = NULL;
 static blob_index_t blob_index_txt = NULL;
+static blob_index_t blob_index_ofs = NULL;
+static struct codec *txt_codec = NULL;
 
 static doc_id_t   prev_docID /* docID just indexed */ = 0;
-static position_t cur_position = 0;
 
 uint64_t n_parse_err = 0;
 uint64_t n_parse_tex = 0;
 
+/* lexers are generated non-reentrant, slices are collected holding
+ * g_lex_mutex and then analyzed without holding it. */
+static list *lex_slices = NULL;
+
+struct slice_copy {
+	enum lex_slice_type type;
+	uint32_t            offset;
+	struct list_node    ln;
+	char                str[];
+};
+
 doc_id_t indexer_assign(struct indices *indices)
 {
 	uint32_t max_docID;
@@ -30,6 +43,8 @@ doc_id_t indexer_assign(struct indices *indices)
 	math_index = indices->mi;
 	blob_index_url = indices->url_bi;
 	blob_index_txt = indices->txt_bi;
+	blob_index_ofs = indices->ofs_bi;
+	txt_codec = indices->txt_codec;
 
 	max_docID = term_index_get_docN(term_index);
 	prev_docID = max_docID;
@@ -37,39 +52,49 @@ doc_id_t indexer_assign(struct indices *indices)
 	return max_docID;
 }
 
-static void
-index_blob(blob_index_t bi, const char *str, size_t str_sz, bool compress)
+/*
+ * document analysis (thread-safe)
+ */
+static void batch_add_term(struct index_batch *batch, const char *term,
+                           uint32_t offset, uint32_t n_bytes)
 {
-	struct codec codec = {CODEC_GZ, NULL};
-	size_t compressed_sz;
-	void  *compressed;
+	size_t sz = strlen(term) + 1;
 
-#ifdef DEBUG_INDEXER
-	printf("indexing blob:\n""%s\n", str);
-#endif
+	if (batch->terms_sz + sz > batch->terms_cap) {
+		batch->terms_cap = (batch->terms_cap) ? batch->terms_cap : 256;
+		while (batch->terms_sz + sz > batch->terms_cap)
+			batch->terms_cap = batch->terms_cap << 1;
 
-	if (compress) {
-		compressed_sz = codec_compress(&codec, str, str_sz, &compressed);
+		batch->terms = realloc(batch->terms, batch->terms_cap);
+	}
 
-#ifdef DEBUG_INDEXER
-		printf("compressed from %lu into %lu bytes.\n", str_sz, compressed_sz);
-#endif
-		blob_index_write(bi, prev_docID + 1, compressed, compressed_sz);
-		free(compressed);
-	} else {
-#ifdef DEBUG_INDEXER
-		printf("not compressed.\n");
-#endif
+	memcpy(batch->terms + batch->terms_sz, term, sz);
+	batch->terms_sz += sz;
+	batch->n_terms ++;
 
-		blob_index_write(bi, prev_docID + 1, str, str_sz);
+	offset_table_add(&batch->offsets, offset, n_bytes);
+}
+
+static void
+batch_add_tex(struct index_batch *batch, position_t pos, struct subpaths sp)
+{
+	if (batch->n_texs == batch->texs_cap) {
+		batch->texs_cap = (batch->texs_cap) ? batch->texs_cap << 1 : 8;
+		batch->texs = realloc(batch->texs,
+		                      batch->texs_cap * sizeof(struct index_tex));
 	}
+
+	batch->texs[batch->n_texs].pos = pos;
+	batch->texs[batch->n_texs].subpaths = sp;
+	batch->n_texs ++;
 }
 
-static int
-index_tex(char *tex, uint32_t offset, size_t n_bytes)
+static int analyze_tex(struct index_batch *batch, char *tex)
 {
-	int ret;
 	struct tex_parse_ret parse_ret;
+	/* position of the "math_exp" term just added */
+	position_t pos = batch->n_terms - 1;
+
 #ifdef DEBUG_INDEXER
 	printf("[parse tex] `%s'\n", tex);
 #endif
@@ -80,50 +105,35 @@ index_tex(char *tex, uint32_t offset, size_t n_bytes)
 #ifdef DEBUG_INDEXER
 		printf("[index tex] `%s'\n", tex);
 #endif
-		/* actual tex indexing */
-		math_index_add_tex(math_index, prev_docID + 1,
-		                   cur_position, parse_ret.subpaths);
-		subpaths_release(&parse_ret.subpaths);
+		/* subpaths are released after being written */
+		batch_add_tex(batch, pos, parse_ret.subpaths);
+		return 0;
 
-		ret = 0; /* successful */
 	} else {
 		/* grammar error or too many subpaths */
 		fprintf(stderr, C_RED "`%s': %s\n" C_RST,
 		        tex, parse_ret.msg);
-
-		ret = 1;
+		return 1;
 	}
-
-	/* increment position */
-	cur_position ++;
-
-	return ret;
 }
 
-static void index_term(char *term, uint32_t offset, size_t n_bytes)
-{
-#ifdef DEBUG_INDEXER
-	/* print */
-	printf("[index term] %s <%u, %lu>\n", term,
-	       offset, n_bytes);
-#endif
+struct analyze_term_arg {
+	struct index_batch *batch;
+	uint32_t            slice_offset;
+};
 
-	/* add term into inverted-index */
-	term_index_doc_add(term_index, term);
-
-	/* increment position */
-	cur_position ++;
-}
-
-static LIST_IT_CALLBK(_index_term)
+static LIST_IT_CALLBK(_analyze_term)
 {
 	LIST_OBJ(struct text_seg, seg, ln);
+	P_CAST(ata, struct analyze_term_arg, pa_extra);
 
-	/* adjust offset relatively to file */
-	P_CAST(slice_offset, uint32_t, pa_extra);
-	seg->offset += *slice_offset;
-
-	index_term(seg->str, seg->offset, seg->n_bytes);
+#ifdef DEBUG_INDEXER
+	printf("[index term] %s <%u, %u>\n", seg->str,
+	       seg->offset, seg->n_bytes);
+#endif
+	/* segment offset is relative to slice */
+	batch_add_term(ata->batch, seg->str,
+	               ata->slice_offset + seg->offset, seg->n_bytes);
 
 	LIST_GO_OVER;
 }
@@ -131,51 +141,56 @@ static LIST_IT_CALLBK(_index_term)
 LIST_DEF_FREE_FUN(txt_seg_li_release, struct text_seg,
                   ln, free(p));
 
-int indexer_handle_slice(struct lex_slice *slice)
+static int analyze_slice(struct index_batch *batch, struct slice_copy *slice)
 {
-	size_t str_sz = strlen(slice->mb_str);
+	size_t str_sz = strlen(slice->str);
 	list   li     = LIST_NULL;
+	struct analyze_term_arg ata = {batch, slice->offset};
 
 #ifdef DEBUG_INDEXER
-	printf("input slice: [%s]\n", slice->mb_str);
+	printf("input slice: [%s]\n", slice->str);
 #endif
 
 	switch (slice->type) {
 	case LEX_SLICE_TYPE_MATH_SEG:
 #ifdef DEBUG_INDEXER
-		printf("[index math tag] %s <%u, %lu>\n", slice->mb_str,
+		printf("[index math tag] %s <%u, %lu>\n", slice->str,
 		       slice->offset, str_sz);
 #endif
-		/* term_index_doc_add() is invoked here to make position numbers
+		/* "math_exp" term is added here to make position numbers
 		 * synchronous in both math-index and Indri. */
-		term_index_doc_add(term_index, "math_exp");
+		batch_add_term(batch, "math_exp", slice->offset, str_sz);
 
 		/* extract tex from math tag and add it into math-index */
-		strip_math_tag(slice->mb_str, str_sz);
+		strip_math_tag(slice->str, str_sz);
 
 		/* count how many TeX parsed */
-		n_parse_tex ++;
+		batch->n_parse_tex ++;
 
-		if (index_tex(slice->mb_str, slice->offset, str_sz)) {
-			n_parse_err++;
+		if (analyze_tex(batch, slice->str)) {
+			batch->n_parse_err ++;
 			return 1;
 		}
 
 		break;
 
 	case LEX_SLICE_TYPE_MIX_SEG:
-		eng_to_lower_case(slice->mb_str, str_sz);
+		eng_to_lower_case(slice->str, str_sz);
 
-		li = text_segment(slice->mb_str);
-		list_foreach(&li, &_index_term, &slice->offset);
+		li = text_segment(slice->str);
+		list_foreach(&li, &_analyze_term, &ata);
 		txt_seg_li_release(&li);
 
 		break;
 
 	case LEX_SLICE_TYPE_ENG_SEG:
-		eng_to_lower_case(slice->mb_str, str_sz);
+		eng_to_lower_case(slice->str, str_sz);
 
-		index_term(slice->mb_str, slice->offset, str_sz);
+#ifdef DEBUG_INDEXER
+		printf("[index term] %s <%u, %lu>\n", slice->str,
+		       slice->offset, str_sz);
+#endif
+		batch_add_term(batch, slice->str, slice->offset, str_sz);
 		break;
 
 	default:
@@ -185,58 +200,176 @@ int indexer_handle_slice(struct lex_slice *slice)
 	return 0;
 }
 
-int index_maintain()
+static LIST_IT_CALLBK(_analyze_slice)
 {
-	printf("\r[index maintaining...]");
-	fflush(stdout);
-	term_index_maintain(term_index);
-	sleep(10);
+	LIST_OBJ(struct slice_copy, slice, ln);
+	P_CAST(batch, struct index_batch, pa_extra);
+
+	if (analyze_slice(batch, slice))
+		batch->err = 1;
+
+	LIST_GO_OVER;
+}
+
+LIST_DEF_FREE_FUN(slice_li_release, struct slice_copy,
+                  ln, free(p));
+
+int indexer_handle_slice(struct lex_slice *slice)
+{
+	size_t sz = strlen(slice->mb_str) + 1;
+	struct slice_copy *copy = malloc(sizeof(struct slice_copy) + sz);
+
+	copy->type = slice->type;
+	copy->offset = slice->offset;
+	memcpy(copy->str, slice->mb_str, sz);
+
+	LIST_NODE_CONS(copy->ln);
+	list_insert_one_at_tail(&copy->ln, lex_slices, NULL, NULL);
 
 	return 0;
 }
 
-static bool get_json_val(const char *json, const char *key, char *val)
+static void analyze_text(struct index_batch *batch, const char *txt,
+                         size_t txt_sz, text_lexer lex)
+{
+	list  slices = LIST_NULL;
+	FILE *fh_txt = fmemopen((void *)txt, txt_sz, "r");
+
+	/* safe check */
+	if (fh_txt == NULL) {
+		perror("fmemopen() function");
+		fprintf(stderr, "txt: %s (size=%lu)", txt, txt_sz);
+		exit(EXIT_FAILURE);
+	}
+
+	/* invoke lexer */
+	pthread_mutex_lock(&g_lex_mutex);
+	g_lex_handler = &indexer_handle_slice;
+	lex_slices = &slices;
+	(*lex)(fh_txt);
+	lex_slices = NULL;
+	pthread_mutex_unlock(&g_lex_mutex);
+
+	/* close memory file handler */
+	fclose(fh_txt);
+
+	/* segment text and parse TeX */
+	list_foreach(&slices, &_analyze_slice, batch);
+	slice_li_release(&slices);
+}
+
+static bool
+get_json_vals(const char *json, char **url, char **txt)
 {
 	JSON_Value *parson_val = json_parse_string(json);
 	JSON_Object *parson_obj;
+	const char *str;
 
-	if (parson_val == NULL) {
-		json_value_free(parson_val);
+	if (parson_val == NULL)
 		return 0;
-	}
 
 	parson_obj = json_value_get_object(parson_val);
-	strcpy(val, json_object_get_string(parson_obj, key));
+
+	str = json_object_get_string(parson_obj, "url");
+	*url = (str) ? strdup(str) : NULL;
+
+	str = json_object_get_string(parson_obj, "text");
+	*txt = (str) ? strdup(str) : NULL;
 
 	json_value_free(parson_val);
 	return 1;
 }
 
-static int index_text_field(const char *txt, text_lexer lex)
+int indexer_analyze_json(const char *doc_json, text_lexer lex,
+                         struct index_batch *batch)
 {
-	doc_id_t docID;
-	size_t txt_sz = strlen(txt);
-	FILE *fh_txt = fmemopen((void *)txt, txt_sz, "r");
-	int ret;
+	char  *url_field, *txt_field;
+	size_t txt_sz;
 
-	/* safe check */
-	if (fh_txt == NULL) {
-		perror("fmemopen() function");
-		fprintf(stderr, "txt: %s (size=%lu)", txt, txt_sz);
-		exit(EXIT_FAILURE);
+	memset(batch, 0, sizeof(struct index_batch));
+
+	if (!get_json_vals(doc_json, &url_field, &txt_field)) {
+		fprintf(stderr, "JSON: parse failed.\n");
+		return 1;
 	}
 
+	if (url_field == NULL || txt_field == NULL) {
+		fprintf(stderr, "JSON: get URL/TXT field failed.\n");
+		goto skip;
+	}
+
+	if (strlen(url_field) == 0 || strlen(txt_field) == 0) {
+		fprintf(stderr, "JSON: URL/TXT field strlen is zero.\n");
+		goto skip;
+	}
+
+	/* text segmentation and TeX parsing */
+	txt_sz = strlen(txt_field);
+	offset_table_init(&batch->offsets, txt_sz);
+	analyze_text(batch, txt_field, txt_sz, lex);
+
+	/* compress text blob */
+	batch->txt_sz = codec_compress(txt_codec, txt_field, txt_sz, &batch->txt);
+#ifdef DEBUG_INDEXER
+	printf("compressed from %lu into %lu bytes.\n", txt_sz, batch->txt_sz);
+#endif
+
+	batch->url = url_field;
+	batch->url_sz = strlen(url_field);
+
+	free(txt_field);
+	return batch->err;
+
+skip:
+	free(url_field);
+	free(txt_field);
+	return 1;
+}
+
+/*
+ * document writing (single writer)
+ */
+int indexer_write_batch(struct index_batch *batch)
+{
+	doc_id_t  docID;
+	char     *term = batch->terms;
+	uint32_t  i;
+
+	/* document skipped in analysis */
+	if (batch->url == NULL)
+		return 1;
+
+#ifdef DEBUG_INDEXER
+	printf("indexing blob:\n""%s\n", batch->url);
+#endif
+	/* URL blob is written prior to term_index_doc_end() because
+	 * prev_docID is not updated at this point. */
+	blob_index_write(blob_index_url, prev_docID + 1,
+	                 batch->url, batch->url_sz);
+
 	/* prepare indexing a document */
 	term_index_doc_begin(term_index);
 
-	/* invoke lexer */
-	ret = (*lex)(fh_txt);
+	for (i = 0; i < batch->n_terms; i++) {
+		/* add term into inverted-index */
+		term_index_doc_add(term_index, term);
+		term += strlen(term) + 1;
+	}
+
+	for (i = 0; i < batch->n_texs; i++) {
+		/* actual tex indexing */
+		math_index_add_tex(math_index, prev_docID + 1,
+		                   batch->texs[i].pos, batch->texs[i].subpaths);
+	}
 
 	/* index text blob */
-	index_blob(blob_index_txt, txt, txt_sz, 1);
+	blob_index_write(blob_index_txt, prev_docID + 1,
+	                 batch->txt, batch->txt_sz);
 
-	/* close memory file handler */
-	fclose(fh_txt);
+	/* index position-offset table, so that snippets can be located
+	 * without lexing document text again */
+	blob_index_write(blob_index_ofs, prev_docID + 1,
+	                 batch->offsets.buf, batch->offsets.sz);
 
 	/* done indexing this document */
 	docID = term_index_doc_end(term_index);
@@ -244,49 +377,69 @@ static int index_text_field(const char *txt, text_lexer lex)
 
 	/* update document indexing variables */
 	prev_docID = docID;
-	cur_position = 0;
+	n_parse_tex += batch->n_parse_tex;
+	n_parse_err += batch->n_parse_err;
 
-	return ret;
+	return 0;
 }
 
-int indexer_index_json(FILE *fh, text_lexer lex)
+void indexer_batch_free(struct index_batch *batch)
+{
+	uint32_t i;
+
+	for (i = 0; i < batch->n_texs; i++)
+		subpaths_release(&batch->texs[i].subpaths);
+
+	free(batch->url);
+	free(batch->txt);
+	free(batch->terms);
+	free(batch->texs);
+	offset_table_free(&batch->offsets);
+}
+
+int index_maintain(bool pause)
+{
+	printf("\r[index maintaining...]");
+	fflush(stdout);
+	term_index_maintain(term_index);
+
+	if (pause)
+		sleep(INDEXER_MAINTAIN_PAUSE);
+
+	return 0;
+}
+
+char *indexer_read_json(FILE *fh)
 {
-	static char doc_json[MAX_CORPUS_FILE_SZ + 1];
-	static char url_field[MAX_CORPUS_FILE_SZ];
-	static char txt_field[MAX_CORPUS_FILE_SZ];
-	size_t      rd_sz;
-	int         ret;
+	char  *doc_json = malloc(MAX_CORPUS_FILE_SZ + 1);
+	size_t rd_sz;
 
 	rd_sz = fread(doc_json, 1, MAX_CORPUS_FILE_SZ, fh);
 	doc_json[rd_sz] = '\0';
 
 	if (rd_sz == MAX_CORPUS_FILE_SZ) {
 		fprintf(stderr, "corpus file too large!\n");
-		return 1;
+		free(doc_json);
+		return NULL;
 	}
 
-	if (!get_json_val(doc_json, "url", url_field)) {
-		fprintf(stderr, "JSON: get URL field failed.\n");
-		return 1;
-	}
+	return realloc(doc_json, rd_sz + 1);
+}
 
-	if (!get_json_val(doc_json, "text", txt_field)) {
-		fprintf(stderr, "JSON: get TXT field failed.\n");
-		return 1;
-	}
+int indexer_index_json(FILE *fh, text_lexer lex)
+{
+	struct index_batch batch;
+	char *doc_json = indexer_read_json(fh);
+	int   ret;
 
-	if (strlen(url_field) == 0 || strlen(txt_field) == 0) {
-		fprintf(stderr, "JSON: URL/TXT field strlen is zero.\n");
+	if (doc_json == NULL)
 		return 1;
-	}
 
-	/* URL blob indexing, it is done prior than text indexing
-	 * because prev_docID is not updated at this point. */
-	index_blob(blob_index_url, url_field, strlen(url_field), 0);
-
-	/* text indexing */
-	ret = index_text_field(txt_field, lex);
+	ret = indexer_analyze_json(doc_json, lex, &batch);
+	indexer_write_batch(&batch);
 
+	indexer_batch_free(&batch);
+	free(doc_json);
 	return ret;
 }
 
@@ -319,3 +472,115 @@ uint64_t total_json_files(const char *dir)
 
 	return cnt;
 }
+
+/*
+ * text blob dictionary training
+ */
+struct dict_sample {
+	const char *path;
+	char       *buf;
+	size_t      sz;
+	size_t     *doc_sz;
+	size_t      n;
+};
+
+static bool sample_full(struct dict_sample *sample)
+{
+	return (sample->n == INDEXER_DICT_SAMPLE_DOCS ||
+	        sample->sz == INDEXER_DICT_SAMPLE_SZ);
+}
+
+/* add text field of a corpus file into sample */
+static void sample_json_file(const char *path, struct dict_sample *sample)
+{
+	FILE  *fh = fopen(path, "r");
+	char  *doc_json, *url, *txt;
+	size_t txt_sz;
+
+	if (fh == NULL)
+		return;
+
+	doc_json = indexer_read_json(fh);
+	fclose(fh);
+
+	if (doc_json && get_json_vals(doc_json, &url, &txt)) {
+		txt_sz = (txt) ? strlen(txt) : 0;
+		if (sample->sz + txt_sz > INDEXER_DICT_SAMPLE_SZ)
+			txt_sz = INDEXER_DICT_SAMPLE_SZ - sample->sz;
+
+		if (txt_sz) {
+			memcpy(sample->buf + sample->sz, txt, txt_sz);
+			sample->doc_sz[sample->n ++] = txt_sz;
+			sample->sz += txt_sz;
+		}
+
+		free(url);
+		free(txt);
+	}
+
+	free(doc_json);
+}
+
+static int sample_file_callbk(const char *filename, void *arg)
+{
+	P_CAST(sample, struct dict_sample, arg);
+	char fullpath[MAX_FILE_NAME_LEN];
+
+	if (json_ext(filename)) {
+		sprintf(fullpath, "%s/%s", sample->path, filename);
+		sample_json_file(fullpath, sample);
+	}
+
+	return sample_full(sample);
+}
+
+static enum ds_ret
+sample_dir_callbk(const char* path, const char *srchpath,
+                  uint32_t level, void *arg)
+{
+	P_CAST(sample, struct dict_sample, arg);
+
+	sample->path = path;
+	foreach_files_in(path, &sample_file_callbk, sample);
+
+	return sample_full(sample) ? DS_RET_STOP_ALLDIR : DS_RET_CONTINUE;
+}
+
+int indexer_train_dict(struct indices *indices, const char *index_path,
+                       const char *corpus_path)
+{
+	struct dict_sample sample = {NULL, NULL, 0, NULL, 0};
+	char  *dict;
+	size_t dict_sz;
+	int    ret = 1;
+
+	sample.buf = malloc(INDEXER_DICT_SAMPLE_SZ);
+	sample.doc_sz = malloc(INDEXER_DICT_SAMPLE_DOCS * sizeof(size_t));
+	dict = malloc(GZ_DICT_MAX_SZ);
+
+	if (dir_exists(corpus_path))
+		dir_search_podfs(corpus_path, &sample_dir_callbk, &sample);
+	else
+		sample_json_file(corpus_path, &sample);
+
+	dict_sz = gz_dict_train(sample.buf, sample.doc_sz, sample.n,
+	                        dict, GZ_DICT_MAX_SZ);
+	if (dict_sz == 0) {
+		fprintf(stderr, "too small sample (%lu bytes) to train "
+		        "dictionary.\n", sample.sz);
+		goto free;
+	}
+
+	printf("trained dictionary of %lu bytes from %lu documents.\n",
+	       dict_sz, sample.n);
+
+	ret = indices_set_txt_dict(indices, index_path, dict, dict_sz);
+	if (ret == 0)
+		txt_codec = indices->txt_codec;
+
+free:
+	free(sample.buf);
+	free(sample.doc_sz);
+	free(dict);
+	return ret;
+}
@@ -25,7 +25,59 @@ int indexer_index_json(FILE*, text_lexer);
 
 int indexer_handle_slice(struct lex_slice*);
 
-int index_maintain();
+/*
+ * train a preset dictionary of text blobs from (the first documents of)
+ * corpus, for the indices (at the path) opened for writing but have not
+ * been indexed any document. Return 0 on success.
+ */
+int indexer_train_dict(struct indices*, const char*, const char*);
+
+/*
+ * a document is indexed in two steps: analysis (JSON parsing, text
+ * segmentation, TeX parsing and blob compression) which can run in
+ * concurrent threads, and writing to indices, which must be done by
+ * a single thread in docID order.
+ */
+struct index_tex {
+	position_t       pos; /* position of its "math_exp" term */
+	struct subpaths  subpaths;
+};
+
+struct index_batch {
+	char     *url;  /* NULL if document is skipped */
+	size_t    url_sz;
+	void     *txt;  /* compressed text blob */
+	size_t    txt_sz;
+
+	/* byte ranges of terms in text, by position */
+	struct offset_table offsets;
+
+	/* NUL-terminated terms in position order */
+	char     *terms;
+	size_t    terms_sz, terms_cap;
+	uint32_t  n_terms;
+
+	struct index_tex *texs;
+	uint32_t  n_texs, texs_cap;
+
+	/* TeX parse counters of this document */
+	uint32_t  n_parse_tex, n_parse_err;
+	int       err;
+};
+
+/* read a corpus file into a malloc'd string, NULL if too large */
+char *indexer_read_json(FILE*);
+
+/* return non-zero on error, batch should be freed in any case */
+int indexer_analyze_json(const char*, text_lexer, struct index_batch*);
+
+/* return non-zero if the document is skipped */
+int indexer_write_batch(struct index_batch*);
+
+void indexer_batch_free(struct index_batch*);
+
+/* write out and merge term index, pause afterwards if specified */
+int index_maintain(bool);
 
 /* other utilities */
 static __inline void strip_math_tag(char *str, size_t n_bytes)
@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "pipeline.h"
+
+static void *worker_main(void *arg)
+{
+	struct index_pipeline *pl = (struct index_pipeline*)arg;
+	struct index_job *job;
+
+	pthread_mutex_lock(&pl->mutex);
+	while (1) {
+		while (!pl->eof && pl->n_taken == pl->n_pushed)
+			pthread_cond_wait(&pl->cond_input, &pl->mutex);
+
+		if (pl->n_taken == pl->n_pushed)
+			break; /* no more input */
+
+		job = pl->slot[pl->n_taken % INDEXER_PIPELINE_DEPTH];
+		pl->n_taken ++;
+		pthread_mutex_unlock(&pl->mutex);
+
+		job->err = indexer_analyze_json(job->json, pl->lex, &job->batch);
+		free(job->json);
+		job->json = NULL;
+
+		pthread_mutex_lock(&pl->mutex);
+		job->done = 1;
+		pthread_cond_signal(&pl->cond_done);
+	}
+	pthread_mutex_unlock(&pl->mutex);
+
+	return NULL;
+}
+
+static void *writer_main(void *arg)
+{
+	struct index_pipeline *pl = (struct index_pipeline*)arg;
+	struct index_job *job;
+	uint32_t n_unmaintained = 0;
+
+	pthread_mutex_lock(&pl->mutex);
+	while (1) {
+		/* wait for the next job in order to be analyzed */
+		while (1) {
+			if (pl->n_written == pl->n_pushed) {
+				if (pl->eof)
+					goto exit;
+			} else {
+				job = pl->slot[pl->n_written % INDEXER_PIPELINE_DEPTH];
+				if (job->done)
+					break;
+			}
+
+			pthread_cond_wait(&pl->cond_done, &pl->mutex);
+		}
+		pthread_mutex_unlock(&pl->mutex);
+
+		indexer_write_batch(&job->batch);
+		if (pl->callbk)
+			pl->callbk(pl->n_written + 1, job, pl->arg);
+
+		indexer_batch_free(&job->batch);
+		free(job->path);
+		free(job);
+
+		/* no pause, workers would stall waiting for free slots */
+		if (++n_unmaintained >= INDEXER_MAINTAIN_DOCS) {
+			index_maintain(0);
+			n_unmaintained = 0;
+		}
+
+		pthread_mutex_lock(&pl->mutex);
+		pl->slot[pl->n_written % INDEXER_PIPELINE_DEPTH] = NULL;
+		pl->n_written ++;
+		pthread_cond_signal(&pl->cond_slot);
+	}
+
+exit:
+	pthread_mutex_unlock(&pl->mutex);
+	return NULL;
+}
+
+struct index_pipeline *
+index_pipeline_new(uint32_t n_workers, text_lexer lex,
+                   index_pipeline_callbk callbk, void *arg)
+{
+	uint32_t i;
+	struct index_pipeline *pl = calloc(1, sizeof(struct index_pipeline));
+
+	pthread_mutex_init(&pl->mutex, NULL);
+	pthread_cond_init(&pl->cond_input, NULL);
+	pthread_cond_init(&pl->cond_done, NULL);
+	pthread_cond_init(&pl->cond_slot, NULL);
+
+	pl->lex = lex;
+	pl->callbk = callbk;
+	pl->arg = arg;
+
+	pl->n_workers = n_workers;
+	pl->workers = malloc(n_workers * sizeof(pthread_t));
+
+	for (i = 0; i < n_workers; i++)
+		pthread_create(pl->workers + i, NULL, &worker_main, pl);
+
+	pthread_create(&pl->writer, NULL, &writer_main, pl);
+
+	return pl;
+}
+
+void index_pipeline_push(struct index_pipeline *pl, char *json,
+                         const char *path)
+{
+	struct index_job *job = calloc(1, sizeof(struct index_job));
+	job->json = json;
+	job->path = strdup(path);
+
+	pthread_mutex_lock(&pl->mutex);
+	while (pl->n_pushed - pl->n_written >= INDEXER_PIPELINE_DEPTH)
+		pthread_cond_wait(&pl->cond_slot, &pl->mutex);
+
+	pl->slot[pl->n_pushed % INDEXER_PIPELINE_DEPTH] = job;
+	pl->n_pushed ++;
+	pthread_cond_signal(&pl->cond_input);
+	pthread_mutex_unlock(&pl->mutex);
+}
+
+void index_pipeline_free(struct index_pipeline *pl)
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&pl->mutex);
+	pl->eof = 1;
+	pthread_cond_broadcast(&pl->cond_input);
+	pthread_cond_broadcast(&pl->cond_done);
+	pthread_mutex_unlock(&pl->mutex);
+
+	for (i = 0; i < pl->n_workers; i++)
+		pthread_join(pl->workers[i], NULL);
+
+	pthread_join(pl->writer, NULL);
+
+	pthread_mutex_destroy(&pl->mutex);
+	pthread_cond_destroy(&pl->cond_input);
+	pthread_cond_destroy(&pl->cond_done);
+	pthread_cond_destroy(&pl->cond_slot);
+
+	free(pl->workers);
+	free(pl);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "config.h"
+#include "index.h"
+
+/*
+ * pipelined indexer: the caller (reader stage) pushes documents read
+ * from corpus files, a pool of worker threads analyze them into
+ * index batches, and a single writer thread writes batches to
+ * indices in the order they are pushed (so docIDs are assigned in
+ * the same order as single-threaded indexing).
+ */
+struct index_job {
+	char              *json; /* document, freed after analysis */
+	char              *path; /* corpus file path, for error report */
+	struct index_batch batch;
+	int                err;
+	bool               done;
+};
+
+/* called by writer thread after each document is written */
+typedef void (*index_pipeline_callbk)(uint64_t, struct index_job*, void*);
+
+struct index_pipeline {
+	pthread_mutex_t   mutex;
+	pthread_cond_t    cond_input, cond_done, cond_slot;
+
+	/* in-flight jobs, a job of sequence number i is at slot[i % DEPTH] */
+	struct index_job *slot[INDEXER_PIPELINE_DEPTH];
+	uint64_t          n_pushed, n_taken, n_written;
+	bool              eof;
+
+	pthread_t        *workers;
+	uint32_t          n_workers;
+	pthread_t         writer;
+
+	text_lexer        lex;
+	index_pipeline_callbk callbk;
+	void             *arg;
+};
+
+struct index_pipeline *
+index_pipeline_new(uint32_t, text_lexer, index_pipeline_callbk, void*);
+
+/* push a document (taking ownership of the JSON string), block if
+ * there are too many documents in flight. */
+void index_pipeline_push(struct index_pipeline*, char*, const char*);
+
+/* wait for all pushed documents to be written, then release pipeline */
+void index_pipeline_free(struct index_pipeline*);
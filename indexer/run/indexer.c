@@ -6,6 +6,7 @@
 #include "mhook/mhook.h"
 #include "config.h"
 #include "index.h"
+#include "pipeline.h"
 
 static volatile int force_stop = 0;
 
@@ -13,6 +14,7 @@ struct indexer_args {
 	uint64_t    indexed_files, tot_files;
 	char       *path;
 	text_lexer  lex;
+	struct index_pipeline *pipeline; /* NULL if not pipelined */
 };
 
 static void signal_handler(int sig) {
@@ -57,6 +59,18 @@ static int foreach_file_callbk(const char *filename, void *arg)
 			return 1;
 		}
 
+		if (i_args->pipeline) {
+			/* progress is printed by the writer stage */
+			char *json = indexer_read_json(fh);
+			if (json)
+				index_pipeline_push(i_args->pipeline, json, fullpath);
+			else
+				fprintf(stderr, "@ %s\n", fullpath);
+
+			fclose(fh);
+			return 0;
+		}
+
 		if (indexer_index_json(fh, i_args->lex))
 			fprintf(stderr, "@ %s\n", fullpath);
 
@@ -70,6 +84,21 @@ static int foreach_file_callbk(const char *filename, void *arg)
 	return 0;
 }
 
+/* writer stage callback of pipelined indexing */
+static void pipeline_callbk(uint64_t n_written, struct index_job *job,
+                            void *arg)
+{
+	P_CAST(i_args, struct indexer_args, arg);
+
+	if (job->err)
+		fprintf(stderr, "@ %s\n", job->path);
+
+	i_args->indexed_files = n_written;
+
+	printf("\33[2K\r"); /* clear last line & reset cursor */
+	print_process(i_args->indexed_files, i_args->tot_files);
+}
+
 static enum ds_ret
 dir_search_callbk(const char* path, const char *srchpath,
                   uint32_t level, void *arg)
@@ -82,8 +111,10 @@ dir_search_callbk(const char* path, const char *srchpath,
 
 	foreach_files_in(path, &foreach_file_callbk, i_args);
 
-	if (mhook_unfree() > UNFREE_CNT_INDEXER_MAINTAIN)
-		index_maintain();
+	/* pipelined writer maintains index by itself */
+	if (i_args->pipeline == NULL &&
+	    mhook_unfree() > UNFREE_CNT_INDEXER_MAINTAIN)
+		index_maintain(1);
 
 	if (force_stop) {
 		printf("\n");
@@ -92,7 +123,9 @@ dir_search_callbk(const char* path, const char *srchpath,
 		return DS_RET_STOP_ALLDIR;
 	}
 
-	if (i_args->indexed_files != last)
+	if (i_args->pipeline)
+		; /* files may still be in flight */
+	else if (i_args->indexed_files != last)
 		printf("\n");
 	else
 		printf("no file in this directory.\n");
@@ -109,8 +142,11 @@ int main(int argc, char* argv[])
 	char *output_path = NULL;
 	struct indices indices;
 	doc_id_t max_doc_id;
+	enum indices_open_mode open_mode = INDICES_OPEN_RW;
+	uint32_t n_threads = 1;
+	bool train_dict = 0;
 
-	while ((opt = getopt(argc, argv, "ho:p:d:")) != -1) {
+	while ((opt = getopt(argc, argv, "ho:p:d:bj:z")) != -1) {
 		switch (opt) {
 		case 'h':
 			printf("DESCRIPTION:\n");
@@ -120,12 +156,17 @@ int main(int argc, char* argv[])
 			printf("%s -h | "
 			       "-d <dict path> | "
 			       "-p <corpus path> | "
-			       "-o <output path>"
+			       "-o <output path> | "
+			       "-b (bulk build math index) | "
+			       "-j <analysis threads> (pipelined) | "
+			       "-z (compress text with trained dictionary)"
 			       "\n", argv[0]);
 			printf("\n");
 			printf("EXAMPLE:\n");
 			printf("%s -p ./some/where/file.txt\n", argv[0]);
 			printf("%s -p ./some/where\n", argv[0]);
+			printf("%s -p ./some/where -j 30\n", argv[0]);
+			printf("%s -p ./some/where -z\n", argv[0]);
 			goto exit;
 
 		case 'p':
@@ -141,6 +182,18 @@ int main(int argc, char* argv[])
 			output_path = strdup(optarg);
 			break;
 
+		case 'b':
+			open_mode = INDICES_OPEN_RW_BULK;
+			break;
+
+		case 'j':
+			sscanf(optarg, "%u", &n_threads);
+			break;
+
+		case 'z':
+			train_dict = 1;
+			break;
+
 		default:
 			printf("bad argument(s). \n");
 			goto exit;
@@ -172,7 +225,7 @@ int main(int argc, char* argv[])
 
 	/* open indices for writing */
 	printf("opening indices...\n");
-	if(indices_open(&indices, output_path, INDICES_OPEN_RW)) {
+	if(indices_open(&indices, output_path, open_mode)) {
 		fprintf(stderr, "indices open failed.\n");
 		goto close;
 	}
@@ -183,7 +236,17 @@ int main(int argc, char* argv[])
 	/* initialize indexer */
 	max_doc_id = indexer_assign(&indices);
 	printf("previous max docID = %u.\n", max_doc_id);
-	g_lex_handler = &indexer_handle_slice;
+
+	/* dictionary is trained only for a new index, documents indexed
+	 * earlier are compressed by the dictionary index already has. */
+	if (train_dict && max_doc_id != 0) {
+		printf("index is not empty, dictionary is not trained.\n");
+	} else if (train_dict) {
+		printf("training text blob dictionary...\n");
+		if (indexer_train_dict(&indices, output_path, corpus_path))
+			fprintf(stderr, "text blobs are compressed without "
+			        "dictionary.\n");
+	}
 
 	/* start indexing */
 	if (file_exists(corpus_path)) {
@@ -203,11 +266,25 @@ int main(int argc, char* argv[])
 		fclose(fh);
 
 	} else if (dir_exists(corpus_path)) {
-		struct indexer_args arg = {0, 0, NULL, lex};
+		struct indexer_args arg = {0, 0, NULL, lex, NULL};
 
 		arg.tot_files = total_json_files(corpus_path);
+
+		if (n_threads > 1) {
+			printf("pipelined indexing with %u analysis threads.\n",
+			       n_threads);
+			arg.pipeline = index_pipeline_new(n_threads, lex,
+			                                  &pipeline_callbk, &arg);
+		}
+
 		dir_search_podfs(corpus_path, &dir_search_callbk, &arg);
 
+		if (arg.pipeline) {
+			/* drain documents in flight */
+			index_pipeline_free(arg.pipeline);
+			printf("\n");
+		}
+
 	} else {
 		printf("not file/directory.\n");
 	}
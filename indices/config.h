@@ -1,2 +1,27 @@
 #define MAX_PRINT_CACHE_TERMS 512
 //#define ENABLE_PRINT_CACHE_TERMS
+
+/* part (1/n) of cache memory reserved for math posting lists */
+#define MATH_CACHE_MEM_SHARE_DIV 2
+
+/* posting cache look-up hash buckets */
+#define POSTCACHE_HASH_BUCKETS (1 << 16)
+
+/* access frequency sketch of cached posting lists, counters are
+ * halved every POSTCACHE_SKETCH_WINDOW accesses */
+#define POSTCACHE_SKETCH_DEPTH  4
+#define POSTCACHE_SKETCH_WIDTH  (1 << 16)
+#define POSTCACHE_SKETCH_WINDOW (POSTCACHE_SKETCH_WIDTH * 8)
+
+/* a missed posting list is forked for admission only if it has been
+ * accessed at least this many times (recently) */
+#define POSTCACHE_ADMIT_MIN_FREQ 2
+
+/* max missed posting lists waiting for admission */
+#define POSTCACHE_MAX_PENDING 64
+
+//#define DEBUG_POSTCACHE
+
+/* max (uncompressed) size of a text blob re-compressed in merging, at
+ * least the max corpus file size of indexer */
+#define MAX_TXT_BLOB_SZ (1024 * 1024 * 16)
@@ -0,0 +1,2 @@
+CFLAGS +=
+LDFLAGS += -L "../codec/$(BUILD_DIR)"
@@ -0,0 +1,2 @@
+CFLAGS +=
+LDFLAGS += -L "../timer/$(BUILD_DIR)"
@@ -1,13 +1,58 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
 #include "indices.h"
+#include "math-index/packed.h"
 #include "config.h"
 
+static const char blob_index_url_name[] = "url";
+static const char blob_index_txt_name[] = "doc";
+static const char blob_index_ofs_name[] = "offset";
+static const char txt_dict_file_name[] = "doc.dict.bin";
+
+static void stop_admitter(struct indices_admitter*);
+
 void indices_init(struct indices* indices)
 {
 	indices->ti = NULL;
 	indices->mi = NULL;
 	indices->url_bi = NULL;
 	indices->txt_bi = NULL;
-	indices->postcache.trp_root = NULL;
+	indices->ofs_bi = NULL;
+	indices->txt_codec = NULL;
+	indices->postcache.bucket = NULL;
+	indices->cache = &indices->postcache;
+	indices->admitter = NULL;
+}
+
+/* text blobs are compressed with a preset dictionary if the index has
+ * one, otherwise with plain gzip. */
+static struct codec *open_txt_codec(const char *index_path)
+{
+	char   path[MAX_FILE_NAME_LEN];
+	struct gz_dict_args args;
+	FILE  *fh;
+
+	sprintf(path, "%s/%s", index_path, txt_dict_file_name);
+	if (NULL == (fh = fopen(path, "r")))
+		return codec_new(CODEC_GZ, NULL);
+
+	args.dict = malloc(GZ_DICT_MAX_SZ);
+	args.dict_sz = fread(args.dict, 1, GZ_DICT_MAX_SZ, fh);
+	fclose(fh);
+
+	return codec_new(CODEC_GZ_DICT, &args);
+}
+
+static void free_txt_codec(struct codec *codec)
+{
+	struct gz_dict_args *args = (struct gz_dict_args*)codec->args;
+
+	if (codec->method == CODEC_GZ_DICT)
+		free(args->dict);
+
+	codec_free(codec);
 }
 
 bool indices_open(struct indices* indices, const char* index_path,
@@ -17,8 +62,6 @@ bool indices_open(struct indices* indices, const char* index_path,
 	bool                  open_err = 0;
 
 	/* temporary variables */
-	const char            blob_index_url_name[] = "url";
-	const char            blob_index_txt_name[] = "doc";
 	char                  path[MAX_FILE_NAME_LEN];
 
 	/* indices variables */
@@ -26,17 +69,20 @@ bool indices_open(struct indices* indices, const char* index_path,
 	math_index_t          math_index = NULL;
 	blob_index_t          blob_index_url = NULL;
 	blob_index_t          blob_index_txt = NULL;
+	blob_index_t          blob_index_ofs = NULL;
+	struct codec         *txt_codec = NULL;
 
-	/* cache variables */
-	struct postcache_pool postcache;
-	postcache.trp_root = NULL;
+	/* initialize posting cache pool in place (it holds locks, which
+	 * must not be copied), even if opening fails below, so that it is
+	 * always ready for lookups */
+	postcache_init(&indices->postcache, 0 MB);
 
 	/*
 	 * open term index.
 	 */
 	sprintf(path, "%s/term", index_path);
 
-	if (mode == INDICES_OPEN_RW)
+	if (mode != INDICES_OPEN_RD)
 		mkdir_p(path);
 
 	term_index = term_index_open(path, (mode == INDICES_OPEN_RD) ?
@@ -52,8 +98,12 @@ bool indices_open(struct indices* indices, const char* index_path,
 	/*
 	 * open math index.
 	 */
-	math_index = math_index_open(index_path, (mode == INDICES_OPEN_RD) ?
-	                             MATH_INDEX_READ_ONLY: MATH_INDEX_WRITE);
+	if (mode == INDICES_OPEN_RD)
+		math_index = math_index_open(index_path, MATH_INDEX_READ_ONLY);
+	else if (mode == INDICES_OPEN_RW_BULK)
+		math_index = math_index_open(index_path, MATH_INDEX_WRITE_BULK);
+	else
+		math_index = math_index_open(index_path, MATH_INDEX_WRITE_BUFFERED);
 	if (NULL == math_index) {
 		fprintf(stderr, "cannot create/open math index.\n");
 
@@ -84,21 +134,83 @@ bool indices_open(struct indices* indices, const char* index_path,
 		goto skip;
 	}
 
-	/* initialize posting cache pool */
-	postcache_init(&postcache, 0 MB);
+	txt_codec = open_txt_codec(index_path);
+
+	/* offset index may not exist in indices built before it, in which
+	 * case snippets are prepared by lexing document text. */
+	sprintf(path, "%s/%s", index_path, blob_index_ofs_name);
+	blob_index_ofs = blob_index_open(path, (mode == INDICES_OPEN_RD) ?
+	                                 BLOB_OPEN_RD : BLOB_OPEN_WR);
+	if (NULL == blob_index_ofs && mode != INDICES_OPEN_RD) {
+		fprintf(stderr, "cannot create/open offset blob index.\n");
+
+		open_err = 1;
+		goto skip;
+	}
 
 skip:
 	indices->ti = term_index;
 	indices->mi = math_index;
 	indices->url_bi = blob_index_url;
 	indices->txt_bi = blob_index_txt;
-	indices->postcache = postcache;
+	indices->ofs_bi = blob_index_ofs;
+	indices->txt_codec = txt_codec;
+	indices->cache = &indices->postcache;
+	indices->admitter = NULL;
 
 	return open_err;
 }
 
+bool indices_open_reader(struct indices* reader, struct indices* indices,
+                         const char* index_path)
+{
+	char path[MAX_FILE_NAME_LEN];
+
+	indices_init(reader);
+
+	/* share read-only math index, (mapped) blob indices and posting
+	 * cache */
+	reader->mi = indices->mi;
+	reader->url_bi = indices->url_bi;
+	reader->txt_bi = indices->txt_bi;
+	reader->ofs_bi = indices->ofs_bi;
+	reader->txt_codec = indices->txt_codec;
+	reader->cache = indices->cache;
+	reader->admitter = indices->admitter;
+
+	/* term index has its own read handle */
+	sprintf(path, "%s/term", index_path);
+	reader->ti = term_index_open(path, TERM_INDEX_OPEN_READ);
+	if (NULL == reader->ti) {
+		fprintf(stderr, "cannot open term index reader.\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+void indices_close_reader(struct indices* reader)
+{
+	/* shared indices and cache are left to their owner */
+	reader->mi = NULL;
+	reader->url_bi = NULL;
+	reader->txt_bi = NULL;
+	reader->ofs_bi = NULL;
+	reader->txt_codec = NULL;
+	reader->cache = NULL;
+	reader->admitter = NULL;
+
+	indices_close(reader);
+}
+
 void indices_close(struct indices* indices)
 {
+	/* admitter reads shared indices below */
+	if (indices->admitter) {
+		stop_admitter(indices->admitter);
+		indices->admitter = NULL;
+	}
+
 	if (indices->ti) {
 		term_index_close(indices->ti);
 		indices->ti = NULL;
@@ -119,9 +231,128 @@ void indices_close(struct indices* indices)
 		indices->txt_bi = NULL;
 	}
 
-	if (indices->postcache.trp_root) {
-		postcache_free(&indices->postcache);
+	if (indices->ofs_bi) {
+		blob_index_close(indices->ofs_bi);
+		indices->ofs_bi = NULL;
 	}
+
+	if (indices->txt_codec) {
+		free_txt_codec(indices->txt_codec);
+		indices->txt_codec = NULL;
+	}
+
+	postcache_free(&indices->postcache);
+}
+
+int indices_set_txt_dict(struct indices* indices, const char* index_path,
+                         const void *dict, size_t dict_sz)
+{
+	char   path[MAX_FILE_NAME_LEN];
+	struct gz_dict_args args;
+	FILE  *fh;
+
+	/* term index (opened for writing) can not tell its document
+	 * number, but every indexed document has a text blob */
+	if (indices->txt_bi == NULL || !blob_index_empty(indices->txt_bi)) {
+		fprintf(stderr, "cannot set dictionary of non-empty index.\n");
+		return 1;
+	}
+
+	if (dict_sz == 0 || dict_sz > GZ_DICT_MAX_SZ) {
+		fprintf(stderr, "bad dictionary size: %lu.\n", dict_sz);
+		return 1;
+	}
+
+	sprintf(path, "%s/%s", index_path, txt_dict_file_name);
+	fh = fopen(path, "w");
+	if (fh == NULL || dict_sz != fwrite(dict, 1, dict_sz, fh)) {
+		fprintf(stderr, "cannot write dictionary `%s'.\n", path);
+		if (fh) fclose(fh);
+		return 1;
+	}
+	fclose(fh);
+
+	args.dict = malloc(dict_sz);
+	args.dict_sz = dict_sz;
+	memcpy(args.dict, dict, dict_sz);
+
+	if (indices->txt_codec)
+		free_txt_codec(indices->txt_codec);
+	indices->txt_codec = codec_new(CODEC_GZ_DICT, &args);
+
+	return 0;
+}
+
+static bool math_cache_lookup(const char *path, void *po, void *arg)
+{
+	P_CAST(pool, struct postcache_pool, arg);
+	struct postcache_math_posting *mp = postcache_find_math(pool, path);
+
+	if (mp == NULL)
+		return 0;
+
+	/* cached lists are blocks with pathinfo inlined */
+	math_posting_set_mem(po, 1, mp->data, mp->sz, NULL, 0);
+	return 1;
+}
+
+/* open a reader of math path dictionary node, relpath is written */
+static math_posting_t
+math_node_reader(struct indices* indices, uint32_t id, char *relpath)
+{
+	struct math_packed *dict = indices->mi->packed;
+	char fullpath[MAX_DIR_PATH_NAME_LEN];
+	math_posting_t po;
+
+	math_packed_path(dict, 0, id, relpath);
+	sprintf(fullpath, "%s%s", indices->mi->dir, relpath);
+
+	po = math_posting_new_reader(NULL, fullpath);
+	math_packed_set_reader(dict, id, po);
+	return po;
+}
+
+static uint32_t cache_math_postings(struct indices* indices)
+{
+	struct postcache_pool *pool = &indices->postcache;
+	struct math_packed *dict = indices->mi->packed;
+	const struct math_packed_node *node;
+	uint32_t id, n_cached = 0;
+	math_posting_t po;
+	char relpath[MAX_DIR_PATH_NAME_LEN];
+
+	/* lists are found by path dictionary, scan one if not packed */
+	if (dict == NULL && 0 == math_index_scan_trie(indices->mi))
+		dict = indices->mi->packed;
+
+	if (dict == NULL) {
+		printf("no math path dictionary, math postings not cached.\n");
+		return 0;
+	}
+
+	/* paths are visited in BFS order, so that short paths (like a
+	 * single variable) shared by most math queries are cached first */
+	for (id = 0; id < dict->n_nodes; id++) {
+		node = dict->nodes + id;
+
+		/* skip empty lists and those would not fit in anyway */
+		if (node->posting_sz == 0 ||
+		    pool->tab_mem_usage + pool->pos_mem_usage + node->posting_sz >
+		    pool->tot_mem_limit)
+			continue;
+
+		po = math_node_reader(indices, id, relpath);
+
+		/* relative path without leading slash */
+		if (POSTCACHE_NO_ERR ==
+		    postcache_add_math_posting(pool, relpath + 1, po))
+			n_cached ++;
+
+		math_posting_free_reader(po);
+	}
+
+	math_index_set_cache(indices->mi, &math_cache_lookup, pool);
+	return n_cached;
 }
 
 
@@ -131,6 +362,7 @@ void indices_cache(struct indices* indices, uint64_t mem_limit)
 	uint32_t  termN;
 	void     *posting;
 	term_id_t term_id;
+	uint32_t  n_math;
 
 #ifdef ENABLE_PRINT_CACHE_TERMS
 	uint32_t  df;
@@ -138,7 +370,9 @@ void indices_cache(struct indices* indices, uint64_t mem_limit)
 	bool      ellp_lock = 0;
 #endif
 
-	postcache_set_mem_limit(&indices->postcache, mem_limit);
+	/* leave some memory for math postings */
+	postcache_set_mem_limit(&indices->postcache,
+	                        mem_limit - mem_limit / MATH_CACHE_MEM_SHARE_DIV);
 
 	termN = term_index_get_termN(indices->ti);
 
@@ -172,7 +406,268 @@ void indices_cache(struct indices* indices, uint64_t mem_limit)
 	printf("\n");
 #endif
 
-	printf("caching completed (%u posting lists cached):\n", term_id);
+	printf("caching math postings...\n");
+	postcache_set_mem_limit(&indices->postcache, mem_limit);
+	n_math = cache_math_postings(indices);
+
+	printf("caching completed (%u term and %u math posting lists cached):\n",
+	       term_id, n_math);
 	postcache_print_mem_usage(&indices->postcache);
 	printf("\n");
 }
+
+struct indices_admitter {
+	pthread_t       tid;
+	pthread_mutex_t mutex;
+	pthread_cond_t  cond;
+	bool            kicked, stop;
+	struct indices  reader; /* own term index handle */
+};
+
+static void admit_pending(struct indices* indices)
+{
+	struct postcache_pool *pool = indices->cache;
+	struct postcache_cand cand;
+	struct math_packed *dict = indices->mi->packed;
+	char relpath[MAX_DIR_PATH_NAME_LEN];
+	math_posting_t po;
+	void *posting;
+	uint32_t id;
+
+	if (pool->tot_mem_limit == 0) {
+		/* caching is not set up */
+		postcache_clear_pending(pool);
+		return;
+	}
+
+	/* candidates are taken in order of access frequency, each one is
+	 * forked while queries go on (see postcache_admit_*()) */
+	while (postcache_take_pending(pool, &cand)) {
+		if (cand.type == POSTCACHE_TERM_POSTING) {
+			posting = term_index_get_posting(indices->ti, cand.key);
+			if (posting)
+				postcache_admit_term_posting(pool, cand.key, posting);
+
+		} else if (dict) {
+			/* missed path may not exist at all */
+			id = math_packed_lookup(dict, cand.path);
+			if (id != MATH_PACKED_NONE && dict->nodes[id].posting_sz) {
+				po = math_node_reader(indices, id, relpath);
+				postcache_admit_math_posting(pool, cand.path, po);
+				math_posting_free_reader(po);
+			}
+		}
+
+		free(cand.path);
+	}
+}
+
+static void *admitter_main(void *arg)
+{
+	P_CAST(adm, struct indices_admitter, arg);
+
+	pthread_mutex_lock(&adm->mutex);
+	while (!adm->stop) {
+		if (!adm->kicked) {
+			pthread_cond_wait(&adm->cond, &adm->mutex);
+			continue;
+		}
+
+		adm->kicked = 0;
+		pthread_mutex_unlock(&adm->mutex);
+
+		admit_pending(&adm->reader);
+
+		pthread_mutex_lock(&adm->mutex);
+	}
+	pthread_mutex_unlock(&adm->mutex);
+
+	return NULL;
+}
+
+int indices_cache_admitter(struct indices* indices, const char* index_path)
+{
+	struct indices_admitter *adm;
+
+	/* shared cache is fixed */
+	if (indices->cache->bucket == NULL || indices->cache->shm)
+		return 0;
+
+	adm = malloc(sizeof(struct indices_admitter));
+	if (indices_open_reader(&adm->reader, indices, index_path)) {
+		indices_close_reader(&adm->reader);
+		free(adm);
+		return 1;
+	}
+
+	pthread_mutex_init(&adm->mutex, NULL);
+	pthread_cond_init(&adm->cond, NULL);
+	adm->kicked = 0;
+	adm->stop = 0;
+
+	if (0 != pthread_create(&adm->tid, NULL, &admitter_main, adm)) {
+		fprintf(stderr, "cannot start cache admitter.\n");
+		pthread_mutex_destroy(&adm->mutex);
+		pthread_cond_destroy(&adm->cond);
+		indices_close_reader(&adm->reader);
+		free(adm);
+		return 1;
+	}
+
+	indices->admitter = adm;
+	return 0;
+}
+
+static void stop_admitter(struct indices_admitter *adm)
+{
+	pthread_mutex_lock(&adm->mutex);
+	adm->stop = 1;
+	pthread_cond_signal(&adm->cond);
+	pthread_mutex_unlock(&adm->mutex);
+
+	pthread_join(adm->tid, NULL);
+	pthread_mutex_destroy(&adm->mutex);
+	pthread_cond_destroy(&adm->cond);
+
+	indices_close_reader(&adm->reader);
+	free(adm);
+}
+
+void indices_cache_update(struct indices* indices)
+{
+	struct indices_admitter *adm = indices->admitter;
+
+	/* only wake up admitter, it takes pending lists by itself */
+	if (adm == NULL)
+		return;
+
+	pthread_mutex_lock(&adm->mutex);
+	adm->kicked = 1;
+	pthread_cond_signal(&adm->cond);
+	pthread_mutex_unlock(&adm->mutex);
+}
+
+static int
+copy_blob(blob_index_t dst, blob_index_t src, doc_id_t src_id,
+          doc_id_t dst_id)
+{
+	void  *blob;
+	size_t sz = blob_index_read(src, src_id, &blob);
+	int    ret = 0;
+
+	if (blob == NULL) {
+		fprintf(stderr, "cannot read blob #%u.\n", src_id);
+		return 1;
+	}
+
+	if (sz != blob_index_write(dst, dst_id, blob, sz)) {
+		fprintf(stderr, "cannot write blob #%u.\n", dst_id);
+		ret = 1;
+	}
+
+	blob_free(blob);
+	return ret;
+}
+
+static bool same_codec(struct codec *a, struct codec *b)
+{
+	struct gz_dict_args *args_a = (struct gz_dict_args*)a->args;
+	struct gz_dict_args *args_b = (struct gz_dict_args*)b->args;
+
+	if (a->method != b->method)
+		return 0;
+	else if (a->method != CODEC_GZ_DICT)
+		return 1;
+
+	return (args_a->dict_sz == args_b->dict_sz &&
+	        0 == memcmp(args_a->dict, args_b->dict, args_a->dict_sz));
+}
+
+/* copy a text blob compressed by another dictionary (or without one) */
+static int
+transcode_blob(struct indices* dst, struct indices* src, doc_id_t src_id,
+               doc_id_t dst_id, char *buf)
+{
+	void  *blob, *out;
+	size_t sz = blob_index_read(src->txt_bi, src_id, &blob);
+	int    ret = 0;
+
+	if (blob == NULL) {
+		fprintf(stderr, "cannot read text blob #%u.\n", src_id);
+		return 1;
+	}
+
+	sz = codec_decompress(src->txt_codec, blob, sz, buf, MAX_TXT_BLOB_SZ);
+	blob_free(blob);
+
+	if (sz == 0) {
+		fprintf(stderr, "cannot decompress text blob #%u.\n", src_id);
+		return 1;
+	}
+
+	sz = codec_compress(dst->txt_codec, buf, sz, &out);
+	if (sz == 0) {
+		fprintf(stderr, "cannot compress text blob #%u.\n", src_id);
+		return 1;
+	}
+
+	if (sz != blob_index_write(dst->txt_bi, dst_id, out, sz)) {
+		fprintf(stderr, "cannot write text blob #%u.\n", dst_id);
+		ret = 1;
+	}
+
+	free(out);
+	return ret;
+}
+
+int indices_merge(struct indices* indices, struct indices* shard)
+{
+	uint32_t  docN = term_index_get_docN(shard->ti);
+	doc_id_t *doc_map = calloc(docN + 1, sizeof(doc_id_t));
+	doc_id_t  doc_id, new_id;
+	int       ret = 0;
+	char     *txt_buf = NULL;
+
+	/* text blobs are re-compressed if shard has a different codec */
+	if (!same_codec(indices->txt_codec, shard->txt_codec)) {
+		printf("text blobs are re-compressed by %s.\n",
+		       codec_method_str(indices->txt_codec->method));
+		txt_buf = malloc(MAX_TXT_BLOB_SZ);
+	}
+
+	/* documents get new IDs in their order in shard */
+	printf("merging %u documents...\n", docN);
+	for (doc_id = 1; doc_id <= docN; doc_id++) {
+		new_id = term_index_doc_copy(indices->ti, shard->ti, doc_id);
+		if (new_id == 0) {
+			fprintf(stderr, "cannot copy document #%u.\n", doc_id);
+			ret = 1;
+			goto free;
+		}
+
+		doc_map[doc_id] = new_id;
+		if (copy_blob(indices->url_bi, shard->url_bi, doc_id, new_id) ||
+		    ((txt_buf) ?
+		     transcode_blob(indices, shard, doc_id, new_id, txt_buf) :
+		     copy_blob(indices->txt_bi, shard->txt_bi, doc_id, new_id)) ||
+		    (shard->ofs_bi &&
+		     copy_blob(indices->ofs_bi, shard->ofs_bi, doc_id, new_id))) {
+			fprintf(stderr, "cannot copy blobs of document #%u.\n",
+			        doc_id);
+			ret = 1;
+			goto free;
+		}
+	}
+
+	printf("merging math postings...\n");
+	ret = math_index_append_index(indices->mi, shard->mi, doc_map, docN);
+	if (math_index_flush(indices->mi)) {
+		fprintf(stderr, "cannot write out math postings.\n");
+		ret = 1;
+	}
+
+free:
+	free(txt_buf);
+	free(doc_map);
+	return ret;
+}
@@ -5,11 +5,16 @@
 #include "term-index/term-index.h"
 #include "math-index/math-index.h"
 #include "blob-index/blob-index.h"
+#include "codec/codec.h"
 #include "postcache.h"
+#include "offset-table.h"
+
+struct indices_admitter;
 
 enum indices_open_mode {
 	INDICES_OPEN_RD,
-	INDICES_OPEN_RW
+	INDICES_OPEN_RW,
+	INDICES_OPEN_RW_BULK /* RW, math index is built in bulk */
 };
 
 struct indices {
@@ -17,13 +22,52 @@ struct indices {
 	math_index_t          mi;
 	blob_index_t          url_bi;
 	blob_index_t          txt_bi;
+	blob_index_t          ofs_bi; /* position-offset tables, NULL if not indexed */
+	struct codec         *txt_codec; /* codec of text blobs */
 	struct postcache_pool postcache;
+
+	/* posting cache used by queries, i.e. the postcache above, or that
+	 * of the indices a reader is opened from */
+	struct postcache_pool *cache;
+
+	/* background admission of lists missed in cache, NULL if it is
+	 * not started (readers share that of their indices) */
+	struct indices_admitter *admitter;
 };
 
 void indices_init(struct indices*);
 bool indices_open(struct indices*, const char*, enum indices_open_mode);
 void indices_close(struct indices*);
 
+/*
+ * open a reader of (read-only) opened indices for a concurrent query
+ * thread: term index is opened again, while math index, blob indices
+ * (which are memory mapped) and posting cache are shared with the opened
+ * indices, which should be closed after all its readers.
+ */
+bool indices_open_reader(struct indices*, struct indices*, const char*);
+void indices_close_reader(struct indices*);
+
+/*
+ * set the preset dictionary text blobs are compressed with, which is
+ * only allowed before any document is indexed. Return 0 on success.
+ */
+int indices_set_txt_dict(struct indices*, const char*, const void*, size_t);
+
 #define MB * POSTCACHE_POOL_LIMIT_1MB
 
 void indices_cache(struct indices*, uint64_t);
+
+/*
+ * start a background thread (with its own index reader) admitting
+ * posting lists missed in cache, so that queries do not fork lists.
+ * It is stopped when the indices are closed. Return 0 on success.
+ */
+int indices_cache_admitter(struct indices*, const char*);
+
+/* let admitter (if started) admit lists missed by recent queries */
+void indices_cache_update(struct indices*);
+
+/* append all documents of a (read-only) shard indices, return 0 on
+ * success. Documents are assigned new IDs after existing ones. */
+int indices_merge(struct indices*, struct indices*);
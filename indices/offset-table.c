@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "offset-table.h"
+
+/* max bytes of a 32-bit varint */
+#define VARINT_MAX_BYTES 5
+
+static void table_put_varint(struct offset_table *tab, uint32_t val)
+{
+	if (tab->sz + VARINT_MAX_BYTES > tab->cap) {
+		tab->cap = (tab->cap) ? tab->cap << 1 : 64;
+		tab->buf = realloc(tab->buf, tab->cap);
+	}
+
+	while (val >= 0x80) {
+		tab->buf[tab->sz++] = (char)(val | 0x80);
+		val = val >> 7;
+	}
+
+	tab->buf[tab->sz++] = (char)val;
+}
+
+/* return the number of bytes decoded, zero if buffer is exhausted */
+static size_t get_varint(const unsigned char *p, const unsigned char *end,
+                         uint32_t *val)
+{
+	const unsigned char *begin = p;
+	uint32_t shift = 0;
+
+	*val = 0;
+	while (p < end && shift < 7 * VARINT_MAX_BYTES) {
+		*val |= (uint32_t)(*p & 0x7f) << shift;
+		shift += 7;
+
+		if (!(*p++ & 0x80))
+			return p - begin;
+	}
+
+	return 0;
+}
+
+void offset_table_init(struct offset_table *tab, size_t text_sz)
+{
+	tab->buf = NULL;
+	tab->sz = tab->cap = 0;
+	tab->prev_offset = 0;
+
+	table_put_varint(tab, (uint32_t)text_sz);
+}
+
+void offset_table_add(struct offset_table *tab, uint32_t offset, uint32_t len)
+{
+	int32_t delta = (int32_t)(offset - tab->prev_offset);
+
+	/* zigzag encoding maps small negative deltas to small values */
+	table_put_varint(tab, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+	table_put_varint(tab, len);
+
+	tab->prev_offset = offset;
+}
+
+void offset_table_free(struct offset_table *tab)
+{
+	free(tab->buf);
+	tab->buf = NULL;
+	tab->sz = tab->cap = 0;
+}
+
+int offset_table_lookup(const void *tab, size_t tab_sz, size_t text_sz,
+                        const position_t *pos, uint32_t n,
+                        struct pos_range *ranges)
+{
+	const unsigned char *p = tab, *end = p + tab_sz;
+	uint32_t zz, len, offset = 0, cur = 0, found = 0;
+	size_t   rd;
+
+	/* check table header against document text */
+	if (0 == (rd = get_varint(p, end, &zz)) || zz != text_sz)
+		return -1;
+	p += rd;
+
+	while (found < n) {
+		if (0 == (rd = get_varint(p, end, &zz)))
+			break;
+		p += rd;
+
+		if (0 == (rd = get_varint(p, end, &len)))
+			return -1;
+		p += rd;
+
+		offset += (zz >> 1) ^ (-(zz & 1));
+
+		if (cur == pos[found]) {
+			if ((size_t)offset + len > text_sz)
+				return -1;
+
+			ranges[found].offset = offset;
+			ranges[found].len = len;
+			found ++;
+		}
+
+		cur ++;
+	}
+
+	return (int)found;
+}
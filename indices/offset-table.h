@@ -0,0 +1,33 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "term-index/term-index.h" /* for position_t */
+
+/*
+ * position to byte-offset table of a document. The table begins with
+ * a varint of document text size, followed by one entry per position
+ * (term): a zigzag varint of its offset delta to the previous position
+ * (segmented words may overlap, so deltas can be negative) and a varint
+ * of its length in bytes.
+ */
+struct offset_table {
+	char     *buf;
+	size_t    sz, cap;
+	uint32_t  prev_offset;
+};
+
+struct pos_range {
+	uint32_t offset, len;
+};
+
+void offset_table_init(struct offset_table*, size_t);
+void offset_table_add(struct offset_table*, uint32_t, uint32_t);
+void offset_table_free(struct offset_table*);
+
+/*
+ * look up ranges of (sorted) positions in an encoded table of document
+ * text of given size, ranges are written in order. Return the number of
+ * positions found, or -1 if table does not match the text.
+ */
+int offset_table_lookup(const void*, size_t, size_t,
+                        const position_t*, uint32_t, struct pos_range*);
@@ -1,60 +1,410 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 
 #include "list/list.h"
+#include "wstring/wstring.h"
 #include "mem-index/mem-posting.h"
 #include "postcache.h"
+#include "config.h"
+#include "math-index/config.h"
+#include "math-index/math-posting-blk.h"
 
 int postcache_init(struct postcache_pool *pool, uint64_t mem_limit)
 {
-	pool->trp_root = NULL;
+	pool->bucket = calloc(POSTCACHE_HASH_BUCKETS,
+	                      sizeof(struct postcache_item*));
+	LIST_CONS(pool->ring);
+	pool->n_items = 0;
 
-	pool->trp_mem_usage = 0;
+	pool->sketch.cnt = calloc(POSTCACHE_SKETCH_DEPTH *
+	                          POSTCACHE_SKETCH_WIDTH, sizeof(uint8_t));
+	pool->sketch.n_samples = 0;
+
+	pool->pending = malloc(POSTCACHE_MAX_PENDING *
+	                       sizeof(struct postcache_cand));
+	pool->n_pending = 0;
+
+	pool->tab_mem_usage = 0;
 	pool->pos_mem_usage = 0;
 	pool->tot_mem_limit = mem_limit;
 
+	pthread_rwlock_init(&pool->lock, NULL);
+	pthread_mutex_init(&pool->stat_lock, NULL);
+
+	pool->shm = NULL;
+	pool->shm_sz = 0;
+
 	return 0;
 }
 
-static enum bintr_it_ret
-free_postcache_item(struct bintr_ref *ref, uint32_t level, void *arg)
+/*
+ * access frequency sketch
+ */
+static uint32_t
+sketch_idx(enum postcache_item_type type, uint32_t key, uint32_t row)
+{
+	static const uint32_t seed[] = {
+		0x8f1bbcdc, 0xca62c1d6, 0x6ed9eba1, 0x5a827999
+	};
+	uint32_t h = (key + (uint32_t)type * 0x85ebca6b) ^ seed[row % 4];
+
+	h *= 0x9e3779b1;
+	h ^= h >> 15;
+	return row * POSTCACHE_SKETCH_WIDTH + h % POSTCACHE_SKETCH_WIDTH;
+}
+
+static void
+sketch_add(struct postcache_sketch *sk, enum postcache_item_type type,
+           uint32_t key)
 {
-	struct postcache_item *item =
-		MEMBER_2_STRUCT(ref->this_, struct postcache_item, trp_nd.bintr_nd);
-	P_CAST(pool, struct postcache_pool, arg);
-	P_CAST(mem_po, struct mem_posting, item->posting);
+	uint32_t i, j;
 
-	//printf("free posting cache item and memory posting list...\n");
-	pool->trp_mem_usage -= sizeof(struct postcache_item);
-	pool->pos_mem_usage -= mem_po->tot_sz;;
+	for (i = 0; i < POSTCACHE_SKETCH_DEPTH; i++) {
+		j = sketch_idx(type, key, i);
+		if (sk->cnt[j] < UINT8_MAX)
+			sk->cnt[j] ++;
+	}
+
+	/* age all counters so that old popularity fades out */
+	if (++ sk->n_samples >= POSTCACHE_SKETCH_WINDOW) {
+		for (j = 0; j < POSTCACHE_SKETCH_DEPTH * POSTCACHE_SKETCH_WIDTH; j++)
+			sk->cnt[j] = sk->cnt[j] >> 1;
+		sk->n_samples = sk->n_samples >> 1;
+	}
+}
+
+static uint32_t
+sketch_estimate(struct postcache_sketch *sk, enum postcache_item_type type,
+                uint32_t key)
+{
+	uint32_t i, c, min = UINT8_MAX;
+
+	for (i = 0; i < POSTCACHE_SKETCH_DEPTH; i++) {
+		c = sk->cnt[sketch_idx(type, key, i)];
+		if (c < min)
+			min = c;
+	}
+
+	return min;
+}
+
+/*
+ * item functions
+ */
+static void
+item_mem_usage(struct postcache_item *item, uint64_t *tab, uint64_t *pos)
+{
+	struct mem_posting *mem_po;
+	struct postcache_math_posting *mp;
+
+	*tab = sizeof(struct postcache_item);
+
+	if (item->type == POSTCACHE_TERM_POSTING) {
+		mem_po = item->posting;
+		*pos = mem_po->tot_sz;
+	} else {
+		mp = item->posting;
+		*tab += sizeof(struct postcache_math_posting) +
+		        strlen(mp->path) + 1;
+		*pos = mp->sz;
+	}
+}
+
+static void free_item(struct postcache_item *item)
+{
+	if (item->type == POSTCACHE_TERM_POSTING)
+		mem_posting_free(item->posting);
+	else
+		postcache_free_math_posting(item->posting);
 
-	bintr_detach(ref->this_, ref->ptr_to_this);
-	mem_posting_free(mem_po);
 	free(item);
+}
+
+static struct postcache_item *
+new_item(enum postcache_item_type type, uint32_t key, void *posting)
+{
+	struct postcache_item *item = malloc(sizeof(struct postcache_item));
+
+	item->key = key;
+	item->type = type;
+	item->posting = posting;
+	item->ref = 0;
+	item->hash_next = NULL;
+	LIST_NODE_CONS(item->ln);
+
+	return item;
+}
+
+static struct postcache_item *
+lookup(struct postcache_pool *pool, enum postcache_item_type type,
+       uint32_t key, const char *path)
+{
+	struct postcache_item *item;
+	struct postcache_math_posting *mp;
+
+	item = pool->bucket[key % POSTCACHE_HASH_BUCKETS];
+	for (; item != NULL; item = item->hash_next) {
+		if (item->key != key || item->type != type)
+			continue;
+
+		if (type == POSTCACHE_MATH_POSTING) {
+			mp = item->posting;
+			if (strcmp(mp->path, path))
+				continue; /* hash collision */
+		}
+
+		return item;
+	}
 
-	return BINTR_IT_CONTINUE;
+	return NULL;
+}
+
+static void insert_item(struct postcache_pool *pool,
+                        struct postcache_item *item)
+{
+	uint64_t tab, pos;
+	uint32_t b = item->key % POSTCACHE_HASH_BUCKETS;
+
+	item->hash_next = pool->bucket[b];
+	pool->bucket[b] = item;
+
+	/* new item goes right behind the CLOCK hand */
+	list_insert_one_at_tail(&item->ln, &pool->ring, NULL, NULL);
+	pool->n_items ++;
+
+	item_mem_usage(item, &tab, &pos);
+	pool->tab_mem_usage += tab;
+	pool->pos_mem_usage += pos;
+}
+
+static void evict_item(struct postcache_pool *pool,
+                       struct postcache_item *item)
+{
+	struct postcache_item **p;
+	uint64_t tab, pos;
+	uint32_t b = item->key % POSTCACHE_HASH_BUCKETS;
+
+#ifdef DEBUG_POSTCACHE
+	printf("postcache: evict %s posting (key=%u)\n",
+	       (item->type == POSTCACHE_TERM_POSTING) ? "term" : "math",
+	       item->key);
+#endif
+	for (p = pool->bucket + b; *p != item; p = &(*p)->hash_next);
+	*p = item->hash_next;
+
+	list_detach_one(&item->ln, &pool->ring, NULL, NULL);
+	pool->n_items --;
+
+	item_mem_usage(item, &tab, &pos);
+	pool->tab_mem_usage -= tab;
+	pool->pos_mem_usage -= pos;
+
+	free_item(item);
+}
+
+/* return item under CLOCK hand which is not recently referenced,
+ * and move the hand one step further. */
+static struct postcache_item *clock_victim(struct postcache_pool *pool)
+{
+	struct postcache_item *item;
+
+	for (;;) {
+		item = MEMBER_2_STRUCT(pool->ring.now, struct postcache_item, ln);
+		pool->ring = list_get_it(pool->ring.now->next);
+
+		if (item->ref)
+			item->ref = 0; /* give it a second chance */
+		else
+			return item;
+	}
+}
+
+static uint64_t pool_mem_usage(struct postcache_pool *pool)
+{
+	return pool->tab_mem_usage + pool->pos_mem_usage;
+}
+
+/*
+ * cache a new item, if it does not fit, either give up (when not
+ * `admit') or let it compete with CLOCK victims by the amount of
+ * posting bytes read they are expected to save.
+ */
+static enum postcache_err
+cache_item(struct postcache_pool *pool, struct postcache_item *item,
+           bool admit)
+{
+	struct postcache_item **victims = NULL;
+	uint32_t i, n_victims = 0;
+	uint64_t tab, pos, freed = 0;
+	uint64_t value, victims_value = 0;
+	enum postcache_err ret = POSTCACHE_NO_ERR;
+
+	item_mem_usage(item, &tab, &pos);
+
+	if (pool_mem_usage(pool) + tab + pos <= pool->tot_mem_limit) {
+		insert_item(pool, item);
+		return POSTCACHE_NO_ERR;
+
+	} else if (!admit || tab + pos > pool->tot_mem_limit) {
+		free_item(item);
+		return POSTCACHE_EXCEED_MEM_LIMIT;
+	}
+
+	value = sketch_estimate(&pool->sketch, item->type, item->key) * pos;
+
+	victims = malloc(pool->n_items * sizeof(struct postcache_item*));
+	while (pool_mem_usage(pool) - freed + tab + pos > pool->tot_mem_limit &&
+	       n_victims < pool->n_items) {
+		struct postcache_item *v = clock_victim(pool);
+		uint64_t v_tab, v_pos;
+
+		/* the hand may come around to a picked victim */
+		for (i = 0; i < n_victims; i++)
+			if (victims[i] == v)
+				break;
+		if (i < n_victims)
+			break;
+
+		item_mem_usage(v, &v_tab, &v_pos);
+		freed += v_tab + v_pos;
+		victims_value += sketch_estimate(&pool->sketch, v->type,
+		                                 v->key) * v_pos;
+		victims[n_victims ++] = v;
+	}
+
+	if (pool_mem_usage(pool) - freed + tab + pos > pool->tot_mem_limit ||
+	    victims_value >= value) {
+		free_item(item);
+		ret = POSTCACHE_NOT_ADMITTED;
+	} else {
+		for (i = 0; i < n_victims; i++)
+			evict_item(pool, victims[i]);
+		insert_item(pool, item);
+	}
+
+	free(victims);
+	return ret;
+}
+
+/*
+ * pending candidates
+ */
+static void add_pending(struct postcache_pool *pool,
+                        enum postcache_item_type type, uint32_t key,
+                        const char *path)
+{
+	uint32_t i;
+	struct postcache_cand *cand;
+
+	for (i = 0; i < pool->n_pending; i++) {
+		cand = pool->pending + i;
+		if (cand->key == key && cand->type == type &&
+		    (path == NULL || 0 == strcmp(cand->path, path)))
+			return;
+	}
+
+	if (pool->n_pending == POSTCACHE_MAX_PENDING)
+		return;
+
+	cand = pool->pending + pool->n_pending;
+	cand->type = type;
+	cand->key = key;
+	cand->path = (path) ? strdup(path) : NULL;
+	pool->n_pending ++;
+}
+
+static void clear_pending(struct postcache_pool *pool)
+{
+	uint32_t i;
+
+	for (i = 0; i < pool->n_pending; i++)
+		free(pool->pending[i].path);
+
+	pool->n_pending = 0;
+}
+
+bool postcache_take_pending(struct postcache_pool *pool,
+                            struct postcache_cand *out)
+{
+	uint32_t i, best = 0, freq, best_freq = 0;
+	struct postcache_cand *cand;
+
+	pthread_mutex_lock(&pool->stat_lock);
+	for (i = 0; i < pool->n_pending; i++) {
+		cand = pool->pending + i;
+		freq = sketch_estimate(&pool->sketch, cand->type, cand->key);
+		if (freq > best_freq) {
+			best_freq = freq;
+			best = i;
+		}
+	}
+
+	/* nothing would be admitted anyway */
+	if (best_freq < POSTCACHE_ADMIT_MIN_FREQ) {
+		clear_pending(pool);
+		pthread_mutex_unlock(&pool->stat_lock);
+		return 0;
+	}
+
+	/* fill its place with the last candidate */
+	*out = pool->pending[best];
+	pool->pending[best] = pool->pending[-- pool->n_pending];
+	pthread_mutex_unlock(&pool->stat_lock);
+
+	return 1;
+}
+
+void postcache_clear_pending(struct postcache_pool *pool)
+{
+	pthread_mutex_lock(&pool->stat_lock);
+	clear_pending(pool);
+	pthread_mutex_unlock(&pool->stat_lock);
 }
 
 int postcache_free(struct postcache_pool *pool)
 {
-	bintr_foreach((struct bintr_node **)&pool->trp_root,
-	              &bintr_postorder, &free_postcache_item, pool);
+	if (pool->bucket == NULL)
+		return 0;
+
+	while (pool->ring.now)
+		evict_item(pool, MEMBER_2_STRUCT(pool->ring.now,
+		                                 struct postcache_item, ln));
+
+	clear_pending(pool);
+
+	if (pool->shm) {
+		/* bucket and items are in shared map */
+		munmap(pool->shm, pool->shm_sz);
+		pool->shm = NULL;
+		pool->n_items = 0;
+	} else {
+		free(pool->bucket);
+	}
 
-	assert(pool->trp_root == NULL);
+	free(pool->sketch.cnt);
+	free(pool->pending);
+	pool->bucket = NULL;
+
+	pthread_rwlock_destroy(&pool->lock);
+	pthread_mutex_destroy(&pool->stat_lock);
+
+	assert(pool->n_items == 0);
 	return 0;
 }
 
 void postcache_print_mem_usage(struct postcache_pool *pool)
 {
-	float trp_mem_usage_KB = (float)pool->trp_mem_usage / 1024.f;
+	float tab_mem_usage_KB = (float)pool->tab_mem_usage / 1024.f;
 	float pos_mem_usage_KB = (float)pool->pos_mem_usage / 1024.f;
-	uint64_t total = pool->trp_mem_usage + pool->pos_mem_usage;
+	uint64_t total = pool->tab_mem_usage + pool->pos_mem_usage;
 
 	printf("%.2f KB look-up structure and "
 	       "%.2f KB memory posting list "
 	       "(total %.2f KB, %.2f%% of specified memory limit)",
-	       trp_mem_usage_KB, pos_mem_usage_KB, (float)total / 1024.f,
+	       tab_mem_usage_KB, pos_mem_usage_KB, (float)total / 1024.f,
 	       ((float)total / (float)pool->tot_mem_limit) * 100.f);
 	printf("\n");
 }
@@ -99,67 +449,388 @@ postcache_add_term_posting(struct postcache_pool *pool,
                            term_id_t term_id, void *term_posting)
 {
 	struct mem_posting *mem_po;
-	struct postcache_item *new;
-	struct treap_node *inserted;
 
-	uint64_t trp_mem_usage, pos_mem_usage;
+	if (NULL != lookup(pool, POSTCACHE_TERM_POSTING, term_id, NULL)) {
+		fprintf(stderr, "cached posting with same term ID exists.\n");
+		return POSTCACHE_SAME_KEY_EXISTS;
+	}
 
 	/* fork on-disk term posting list */
 	mem_po = postcache_fork_term_posting(term_posting);
 
-	/* get the size of memory consume */
-	trp_mem_usage = sizeof(struct postcache_item);
-	pos_mem_usage = mem_po->tot_sz;
+	return cache_item(pool, new_item(POSTCACHE_TERM_POSTING, term_id,
+	                                 mem_po), 0);
+}
 
-	if (pool->trp_mem_usage + trp_mem_usage +
-	    pool->pos_mem_usage + pos_mem_usage >
-	    pool->tot_mem_limit) {
+/* whether a missed list is not cached yet and has been accessed
+ * frequently enough to be forked for admission */
+static bool worth_forking(struct postcache_pool *pool,
+                          enum postcache_item_type type, uint32_t key,
+                          const char *path)
+{
+	bool cached;
+	uint32_t freq;
 
-		mem_posting_free(mem_po);
-		return POSTCACHE_EXCEED_MEM_LIMIT;
-	}
+	pthread_rwlock_rdlock(&pool->lock);
+	cached = (NULL != lookup(pool, type, key, path));
+	pthread_rwlock_unlock(&pool->lock);
 
-	/* insert this forked posting into cache pool */
-	new = malloc(sizeof(struct postcache_item));
+	pthread_mutex_lock(&pool->stat_lock);
+	freq = sketch_estimate(&pool->sketch, type, key);
+	pthread_mutex_unlock(&pool->stat_lock);
 
-	new->posting = mem_po;
-	new->type    = POSTCACHE_TERM_POSTING;
-	TREAP_NODE_CONS(new->trp_nd, term_id);
+	return (!cached && freq >= POSTCACHE_ADMIT_MIN_FREQ);
+}
+
+enum postcache_err
+postcache_admit_term_posting(struct postcache_pool *pool,
+                             term_id_t term_id, void *term_posting)
+{
+	struct mem_posting *mem_po;
+	enum postcache_err ret;
 
-	inserted = treap_insert(&pool->trp_root, &new->trp_nd);
+	if (!worth_forking(pool, POSTCACHE_TERM_POSTING, term_id, NULL))
+		return POSTCACHE_NOT_ADMITTED;
 
-	if (inserted == NULL) {
-		fprintf(stderr, "treap node with same term ID exists.\n");
+	/* fork without holding the pool, queries go on meanwhile */
+	mem_po = postcache_fork_term_posting(term_posting);
 
+	pthread_rwlock_wrlock(&pool->lock);
+	if (NULL != lookup(pool, POSTCACHE_TERM_POSTING, term_id, NULL)) {
 		mem_posting_free(mem_po);
-		free(new);
-		return POSTCACHE_SAME_KEY_EXISTS;
+		ret = POSTCACHE_SAME_KEY_EXISTS;
+	} else {
+		ret = cache_item(pool, new_item(POSTCACHE_TERM_POSTING, term_id,
+		                                mem_po), 1);
 	}
+	pthread_rwlock_unlock(&pool->lock);
 
-	/* update memory usage */
-	pool->trp_mem_usage += trp_mem_usage;
-	pool->pos_mem_usage += pos_mem_usage;
-	return POSTCACHE_NO_ERR;
+	return ret;
 }
 
 struct postcache_item*
-postcache_find(struct postcache_pool *pool, bintr_key_t key)
+postcache_find(struct postcache_pool *pool, term_id_t term_id)
+{
+	struct postcache_item *item;
+
+	if (pool->bucket == NULL)
+		return NULL; /* pool is not initialized */
+	else if (pool->shm)
+		return lookup(pool, POSTCACHE_TERM_POSTING, term_id, NULL);
+
+	pthread_mutex_lock(&pool->stat_lock);
+	sketch_add(&pool->sketch, POSTCACHE_TERM_POSTING, term_id);
+	item = lookup(pool, POSTCACHE_TERM_POSTING, term_id, NULL);
+
+	if (item)
+		item->ref = 1;
+	else
+		add_pending(pool, POSTCACHE_TERM_POSTING, term_id, NULL);
+	pthread_mutex_unlock(&pool->stat_lock);
+
+	return item;
+}
+
+/*
+ * math posting cache
+ */
+struct math_fork_buf {
+	char    *data;
+	size_t   sz, cap;
+
+	/* items of current block and their pathinfo packs */
+	uint32_t n_items;
+	struct math_posting_item items[MATH_POSTING_BLK_ITEMS];
+	char     pinfo[MATH_POSTING_BLK_ITEMS * MATH_POSTING_BLK_MAX_PACK_SZ];
+	size_t   pinfo_sz;
+};
+
+static void math_fork_flush(struct math_fork_buf *fb)
 {
-	struct bintr_ref ref;
+	size_t need = fb->sz + sizeof(struct math_posting_blk_head) +
+	              MATH_POSTING_BLK_MAX_SZ;
 
-	ref = bintr_find((struct bintr_node**)&pool->trp_root, key);
+	if (fb->n_items == 0)
+		return;
 
-	if (ref.this_ == NULL)
+	if (need > fb->cap) {
+		fb->cap = (fb->cap) ? fb->cap : need;
+		while (need > fb->cap)
+			fb->cap = fb->cap << 1;
+		fb->data = realloc(fb->data, fb->cap);
+	}
+
+	fb->sz += math_posting_blk_encode(fb->items, fb->n_items, fb->pinfo,
+	                                  fb->data + fb->sz);
+	fb->n_items = 0;
+	fb->pinfo_sz = 0;
+}
+
+struct postcache_math_posting *
+postcache_fork_math_posting(math_posting_t po, const char *path)
+{
+	struct math_fork_buf *fb;
+	struct math_posting_item *item;
+	struct math_pathinfo_pack *pack;
+	struct postcache_math_posting *ret = NULL;
+	size_t pack_sz;
+
+	if (!math_posting_start(po)) {
+		math_posting_finish(po);
 		return NULL;
+	}
+
+	fb = malloc(sizeof(struct math_fork_buf));
+	fb->data = NULL;
+	fb->sz = fb->cap = 0;
+	fb->n_items = 0;
+	fb->pinfo_sz = 0;
+
+	do {
+		item = math_posting_current(po);
+		pack = math_posting_pathinfo(po, item->pathinfo_pos);
+		if (pack == NULL)
+			goto free;
+
+		pack_sz = math_posting_blk_pack_sz(pack);
+		memcpy(fb->pinfo + fb->pinfo_sz, pack, pack_sz);
+
+		fb->items[fb->n_items] = *item;
+		fb->items[fb->n_items].pathinfo_pos = fb->pinfo_sz;
+		fb->pinfo_sz += pack_sz;
+
+		if (++ fb->n_items == MATH_POSTING_BLK_ITEMS)
+			math_fork_flush(fb);
+
+	} while (math_posting_next(po));
+
+	math_fork_flush(fb);
+
+	ret = malloc(sizeof(struct postcache_math_posting));
+	ret->path = strdup(path);
+	ret->data = realloc(fb->data, fb->sz); /* shrink to fit */
+	ret->sz = fb->sz;
+	fb->data = NULL;
+
+free:
+	math_posting_finish(po);
+	free(fb->data);
+	free(fb);
+	return ret;
+}
+
+void postcache_free_math_posting(struct postcache_math_posting *mp)
+{
+	free(mp->path);
+	free(mp->data);
+	free(mp);
+}
+
+enum postcache_err
+postcache_add_math_posting(struct postcache_pool *pool, const char *path,
+                           math_posting_t po)
+{
+	struct postcache_math_posting *mp;
+	uint32_t key = str_hash(path);
+
+	if (NULL != lookup(pool, POSTCACHE_MATH_POSTING, key, path))
+		return POSTCACHE_SAME_KEY_EXISTS;
+
+	/* fork math posting list */
+	mp = postcache_fork_math_posting(po, path);
+	if (mp == NULL)
+		return POSTCACHE_NO_ERR; /* nothing to cache */
+
+	return cache_item(pool, new_item(POSTCACHE_MATH_POSTING, key, mp), 0);
+}
+
+enum postcache_err
+postcache_admit_math_posting(struct postcache_pool *pool, const char *path,
+                             math_posting_t po)
+{
+	struct postcache_math_posting *mp;
+	uint32_t key = str_hash(path);
+	enum postcache_err ret;
+
+	if (!worth_forking(pool, POSTCACHE_MATH_POSTING, key, path))
+		return POSTCACHE_NOT_ADMITTED;
+
+	/* fork without holding the pool, queries go on meanwhile */
+	mp = postcache_fork_math_posting(po, path);
+	if (mp == NULL)
+		return POSTCACHE_NO_ERR; /* nothing to cache */
+
+	pthread_rwlock_wrlock(&pool->lock);
+	if (NULL != lookup(pool, POSTCACHE_MATH_POSTING, key, path)) {
+		postcache_free_math_posting(mp);
+		ret = POSTCACHE_SAME_KEY_EXISTS;
+	} else {
+		ret = cache_item(pool, new_item(POSTCACHE_MATH_POSTING, key, mp),
+		                 1);
+	}
+	pthread_rwlock_unlock(&pool->lock);
+
+	return ret;
+}
+
+struct postcache_math_posting *
+postcache_find_math(struct postcache_pool *pool, const char *path)
+{
+	struct postcache_item *item;
+	uint32_t key = str_hash(path);
+
+	if (pool->bucket == NULL) {
+		return NULL; /* pool is not initialized */
+	} else if (pool->shm) {
+		item = lookup(pool, POSTCACHE_MATH_POSTING, key, path);
+		return (item) ? item->posting : NULL;
+	}
+
+	pthread_mutex_lock(&pool->stat_lock);
+	sketch_add(&pool->sketch, POSTCACHE_MATH_POSTING, key);
+	item = lookup(pool, POSTCACHE_MATH_POSTING, key, path);
+
+	if (item == NULL)
+		add_pending(pool, POSTCACHE_MATH_POSTING, key, path);
 	else
-		return MEMBER_2_STRUCT(ref.this_, struct postcache_item,
-		                       trp_nd.bintr_nd);
+		item->ref = 1;
+	pthread_mutex_unlock(&pool->stat_lock);
+
+	return (item) ? item->posting : NULL;
 }
 
 int postcache_set_mem_limit(struct postcache_pool *pool, uint64_t mem_limit)
 {
+	pthread_rwlock_wrlock(&pool->lock);
 	pool->tot_mem_limit = mem_limit;
-	/* TODO: free memory if a lower limit is put on memory */
+
+	/* free memory if a lower limit is put on memory */
+	while (pool->ring.now && pool_mem_usage(pool) > mem_limit)
+		evict_item(pool, clock_victim(pool));
+	pthread_rwlock_unlock(&pool->lock);
+
+	return 0;
+}
+
+/*
+ * shared pool
+ */
+#define SHM_ALIGN(_sz) (((_sz) + 7) & ~((size_t)7))
+
+static size_t shared_item_sz(struct postcache_item *item)
+{
+	struct postcache_math_posting *mp = item->posting;
+	size_t sz = SHM_ALIGN(sizeof(struct postcache_item));
+
+	if (item->type == POSTCACHE_TERM_POSTING)
+		return sz + SHM_ALIGN(mem_posting_pack_sz(item->posting));
+	else
+		return sz + SHM_ALIGN(sizeof(struct postcache_math_posting)) +
+		       SHM_ALIGN(strlen(mp->path) + 1) + SHM_ALIGN(mp->sz);
+}
+
+/* copy an item and its posting list to dst, return the end of copy */
+static char *
+share_item(struct postcache_item *item, char *dst,
+           struct postcache_item **copy)
+{
+	struct postcache_math_posting *mp = item->posting, *mp_copy;
+
+	*copy = (struct postcache_item*)dst;
+	dst += SHM_ALIGN(sizeof(struct postcache_item));
+
+	**copy = *item;
+	(*copy)->ref = 0;
+	(*copy)->hash_next = NULL;
+	LIST_NODE_CONS((*copy)->ln);
+
+	if (item->type == POSTCACHE_TERM_POSTING) {
+		(*copy)->posting = mem_posting_pack(item->posting, dst);
+		return dst + SHM_ALIGN(mem_posting_pack_sz(item->posting));
+	}
+
+	mp_copy = (struct postcache_math_posting*)dst;
+	dst += SHM_ALIGN(sizeof(struct postcache_math_posting));
+
+	mp_copy->path = dst;
+	strcpy(dst, mp->path);
+	dst += SHM_ALIGN(strlen(mp->path) + 1);
+
+	mp_copy->data = dst;
+	mp_copy->sz = mp->sz;
+	memcpy(dst, mp->data, mp->sz);
+	dst += SHM_ALIGN(mp->sz);
+
+	(*copy)->posting = mp_copy;
+	return dst;
+}
+
+int postcache_share(struct postcache_pool *pool)
+{
+	struct list_node *ln;
+	struct postcache_item *item, *copy, **bucket;
+	size_t bucket_sz = POSTCACHE_HASH_BUCKETS * sizeof(struct postcache_item*);
+	size_t sz = SHM_ALIGN(bucket_sz);
+	uint32_t b;
+	char *map, *p;
+
+	if (pool->shm)
+		return 0;
+
+	ln = pool->ring.now;
+	if (ln) do {
+		item = MEMBER_2_STRUCT(ln, struct postcache_item, ln);
+		sz += shared_item_sz(item);
+		ln = ln->next;
+	} while (ln != pool->ring.now);
+
+	map = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+	           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap() function");
+		return 1;
+	}
+
+	/* anonymous map is zero-filled, i.e. empty buckets */
+	bucket = (struct postcache_item**)map;
+	p = map + SHM_ALIGN(bucket_sz);
+
+	ln = pool->ring.now;
+	if (ln) do {
+		item = MEMBER_2_STRUCT(ln, struct postcache_item, ln);
+		p = share_item(item, p, &copy);
+
+		b = copy->key % POSTCACHE_HASH_BUCKETS;
+		copy->hash_next = bucket[b];
+		bucket[b] = copy;
+
+		ln = ln->next;
+	} while (ln != pool->ring.now);
+
+	/* release private lists, shared copies take over their places
+	 * (and memory usage statistics) */
+	while (pool->ring.now) {
+		item = MEMBER_2_STRUCT(pool->ring.now, struct postcache_item, ln);
+		list_detach_one(&item->ln, &pool->ring, NULL, NULL);
+		free_item(item);
+	}
+
+	free(pool->bucket);
+	pool->bucket = bucket;
+
+	mprotect(map, sz, PROT_READ);
+	pool->shm = map;
+	pool->shm_sz = sz;
 
 	return 0;
 }
+
+void postcache_lock_shared(struct postcache_pool *pool)
+{
+	pthread_rwlock_rdlock(&pool->lock);
+}
+
+void postcache_unlock(struct postcache_pool *pool)
+{
+	pthread_rwlock_unlock(&pool->lock);
+}
@@ -1,35 +1,87 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
 
 #include "list/list.h"
-#include "tree/treap.h"
 #include "term-index/term-index.h"
+#include "math-index/math-index.h"
 
 #define POSTCACHE_POOL_LIMIT_1MB (1024 << 10)
 
 enum postcache_item_type {
-	POSTCACHE_TERM_POSTING /* currently only one type */
+	POSTCACHE_TERM_POSTING,
+	POSTCACHE_MATH_POSTING
 };
 
 enum postcache_err {
 	POSTCACHE_EXCEED_MEM_LIMIT,
 	POSTCACHE_SAME_KEY_EXISTS,
+	POSTCACHE_NOT_ADMITTED,
 	POSTCACHE_NO_ERR
 };
 
 struct postcache_item {
+	uint32_t                 key; /* term ID or math path hash */
+	enum postcache_item_type type;
 	void                    *posting;
+	bool                     ref; /* CLOCK reference bit */
+	struct postcache_item   *hash_next;
+	struct list_node         ln;  /* CLOCK ring */
+};
+
+/*
+ * cached math posting list, re-encoded into blocks with pathinfo
+ * inlined, so that a single memory area holds everything scorer
+ * needs.
+ */
+struct postcache_math_posting {
+	char     *path; /* relative to math index directory */
+	char     *data;
+	size_t    sz;
+};
+
+/*
+ * posting list missed in cache, its admission is deferred until
+ * the query is done (see postcache_admit_*() functions).
+ */
+struct postcache_cand {
 	enum postcache_item_type type;
-	struct treap_node        trp_nd;
+	uint32_t  key;
+	char     *path; /* math path, NULL for a term posting */
+};
+
+/* count-min sketch of posting list accesses (TinyLFU), counters
+ * are halved periodically so that the sketch follows recent queries. */
+struct postcache_sketch {
+	uint8_t  *cnt;
+	uint32_t  n_samples;
 };
 
 struct postcache_pool {
-	struct treap_node *trp_root;
+	struct postcache_item **bucket;
+	list     ring; /* ring.now is the CLOCK hand */
+	uint32_t n_items;
+
+	struct postcache_sketch sketch;
+	struct postcache_cand  *pending;
+	uint32_t                n_pending;
 
 	/* memory statics in bytes */
-	uint64_t trp_mem_usage;
+	uint64_t tab_mem_usage;
 	uint64_t pos_mem_usage;
 	uint64_t tot_mem_limit;
+
+	/* concurrent queries hold the pool shared while using cached lists,
+	 * cached lists are added or evicted only under exclusive lock.
+	 * Access statistics (reference bits, sketch and pending candidates)
+	 * are updated by find functions under stat_lock. */
+	pthread_rwlock_t lock;
+	pthread_mutex_t  stat_lock;
+
+	/* memory map of shared cached lists, see postcache_share() */
+	char            *shm;
+	size_t           shm_sz;
 };
 
 int postcache_init(struct postcache_pool*, uint64_t);
@@ -38,11 +90,66 @@ int postcache_free(struct postcache_pool*);
 
 void postcache_print_mem_usage(struct postcache_pool*);
 
+/* add posting list only if it fits in the memory limit */
 enum postcache_err
 postcache_add_term_posting(struct postcache_pool*, term_id_t, void*);
 
-struct postcache_item* postcache_find(struct postcache_pool*, bintr_key_t);
+/* find cached posting list and count this access, a missed list is
+ * recorded as pending candidate for admission. A pool which has not
+ * been initialized (or has been freed) always misses. */
+struct postcache_item* postcache_find(struct postcache_pool*, term_id_t);
 
+/* set memory limit, cached lists are evicted (under exclusive lock) to
+ * meet a lower limit. */
 int postcache_set_mem_limit(struct postcache_pool*, uint64_t);
 
 struct mem_posting *postcache_fork_term_posting(void*);
+
+/* fork math posting list (from any reader) into memory, return NULL
+ * if the list is empty or cannot be read. */
+struct postcache_math_posting *
+postcache_fork_math_posting(math_posting_t, const char*);
+
+void postcache_free_math_posting(struct postcache_math_posting*);
+
+enum postcache_err
+postcache_add_math_posting(struct postcache_pool*, const char*,
+                           math_posting_t);
+
+struct postcache_math_posting *
+postcache_find_math(struct postcache_pool*, const char*);
+
+/*
+ * admit a (pending) posting list: a list is forked only if it has been
+ * accessed frequently enough, and it replaces CLOCK victims only if
+ * its estimated access frequency times size is greater than theirs.
+ * Lists are forked without holding the pool, which is then locked
+ * exclusively to cache them, so caller must not hold the pool.
+ */
+enum postcache_err
+postcache_admit_term_posting(struct postcache_pool*, term_id_t, void*);
+
+enum postcache_err
+postcache_admit_math_posting(struct postcache_pool*, const char*,
+                             math_posting_t);
+
+/* take the pending candidate of the highest access frequency, return
+ * false if there is none worth admission (the rest are dropped then).
+ * Path of the taken candidate should be freed by caller. */
+bool postcache_take_pending(struct postcache_pool*, struct postcache_cand*);
+
+void postcache_clear_pending(struct postcache_pool*);
+
+/*
+ * move cached lists into a read-only memory map shared with processes
+ * forked afterwards, so that they do not each hold a private copy.
+ * Lists of a shared pool are fixed: no access statistics are kept and
+ * no list is admitted or evicted. Return 0 on success.
+ */
+int postcache_share(struct postcache_pool*);
+
+/* lock pool shared (for using cached lists) */
+void postcache_lock_shared(struct postcache_pool*);
+
+
+void postcache_unlock(struct postcache_pool*);
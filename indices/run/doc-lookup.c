@@ -10,7 +10,6 @@
 
 int main(int argc, char* argv[])
 {
-	struct codec   codec = {CODEC_GZ, NULL};
 	struct indices indices;
 	char  *index_path = NULL;
 
@@ -80,7 +79,7 @@ int main(int argc, char* argv[])
 	blob_sz = blob_index_read(indices.txt_bi, docID, (void **)&blob_out);
 
 	if (blob_out) {
-		text_sz = codec_decompress(&codec, blob_out, blob_sz,
+		text_sz = codec_decompress(indices.txt_codec, blob_out, blob_sz,
 		                           text, MAX_CORPUS_FILE_SZ);
 		text[text_sz] = '\0';
 		blob_free(blob_out);
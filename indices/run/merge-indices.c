@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "mhook/mhook.h"
+#include "timer/timer.h"
+#include "indices.h"
+
+int main(int argc, char* argv[])
+{
+	struct indices indices, shard;
+	enum indices_open_mode open_mode = INDICES_OPEN_RW;
+	char          *output_path = NULL;
+	struct timer   timer;
+	int            opt, i;
+
+	while ((opt = getopt(argc, argv, "ho:b")) != -1) {
+		switch (opt) {
+		case 'h':
+			printf("DESCRIPTION:\n");
+			printf("Merge indices (e.g. shards indexed in parallel) "
+			       "into one. \n");
+			printf("\n");
+			printf("USAGE:\n");
+			printf("%s -h | -o <output path> [-b (bulk build math index)]"
+			       " <shard path> ...\n", argv[0]);
+			printf("\n");
+			printf("EXAMPLE:\n");
+			printf("%s -o ./tmp ./shard-1 ./shard-2\n", argv[0]);
+			goto exit;
+
+		case 'o':
+			output_path = strdup(optarg);
+			break;
+
+		case 'b':
+			open_mode = INDICES_OPEN_RW_BULK;
+			break;
+
+		default:
+			printf("bad argument(s). \n");
+			goto exit;
+		}
+	}
+
+	if (output_path == NULL || optind >= argc) {
+		printf("output or shard path not specified.\n");
+		goto exit;
+	}
+
+	printf("opening output indices...\n");
+	if (indices_open(&indices, output_path, open_mode)) {
+		fprintf(stderr, "indices open failed.\n");
+		goto close;
+	}
+
+	timer_reset(&timer);
+
+	/* shards are merged in argument order */
+	for (i = optind; i < argc; i++) {
+		printf("[shard] %s\n", argv[i]);
+
+		indices_init(&shard);
+		if (indices_open(&shard, argv[i], INDICES_OPEN_RD)) {
+			fprintf(stderr, "cannot open shard `%s'.\n", argv[i]);
+			indices_close(&shard);
+			break;
+		}
+
+		/* an empty output index adopts the text blob dictionary of
+		 * its first shard, so that blobs are simply copied */
+		if (blob_index_empty(indices.txt_bi) &&
+		    shard.txt_codec->method == CODEC_GZ_DICT) {
+			struct gz_dict_args *args = shard.txt_codec->args;
+			indices_set_txt_dict(&indices, output_path,
+			                     args->dict, args->dict_sz);
+		}
+
+		if (indices_merge(&indices, &shard)) {
+			fprintf(stderr, "merge aborted @ `%s'.\n", argv[i]);
+			indices_close(&shard);
+			break;
+		}
+
+		indices_close(&shard);
+		printf("done, %ld msec.\n", timer_last_msec(&timer));
+	}
+
+close:
+	printf("closing output indices...\n");
+	indices_close(&indices);
+
+exit:
+	free(output_path);
+
+	mhook_print_unfree();
+	return 0;
+}
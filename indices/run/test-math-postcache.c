@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mhook/mhook.h"
+#include "dir-util/dir-util.h"
+#include "math-index/head.h"
+#include "postcache.h"
+
+/*
+ * write random math posting lists, cache them and check the cached
+ * lists read the same as on-disk ones.
+ */
+static void gen_path(char *path, const char *root, uint32_t j)
+{
+	sprintf(path, "%s/" TOKEN_PATH_NAME "/VAR/P%u", root, j);
+}
+
+static int cmp_postings(math_posting_t po1, math_posting_t po2)
+{
+	int res = 0;
+	bool more1, more2;
+	struct math_posting_item *item1, *item2;
+	struct math_pathinfo_pack *pack1, *pack2;
+
+	more1 = math_posting_start(po1);
+	more2 = math_posting_start(po2);
+
+	while (more1 && more2) {
+		item1 = math_posting_current(po1);
+		item2 = math_posting_current(po2);
+		if (*(uint64_t*)item1 != *(uint64_t*)item2) {
+			res = 1;
+			break;
+		}
+
+		pack1 = math_posting_pathinfo(po1, item1->pathinfo_pos);
+		pack2 = math_posting_pathinfo(po2, item2->pathinfo_pos);
+		if (pack1 == NULL || pack2 == NULL ||
+		    memcmp(pack1, pack2, math_posting_blk_pack_sz(pack1))) {
+			res = 1;
+			break;
+		}
+
+		more1 = math_posting_next(po1);
+		more2 = math_posting_next(po2);
+	}
+
+	if (more1 != more2)
+		res = 1;
+
+	math_posting_finish(po1);
+	math_posting_finish(po2);
+	return res;
+}
+
+static uint32_t admit_pending(struct postcache_pool *pool)
+{
+	uint32_t n_admitted = 0;
+	char path[MAX_DIR_PATH_NAME_LEN];
+	struct postcache_cand cand;
+	math_posting_t po;
+
+	/* candidates are taken in order of access frequency */
+	while (postcache_take_pending(pool, &cand)) {
+		sprintf(path, "./tmp/%s", cand.path);
+		po = math_posting_new_reader(NULL, path);
+
+		if (POSTCACHE_NO_ERR ==
+		    postcache_admit_math_posting(pool, cand.path, po))
+			n_admitted ++;
+
+		math_posting_free_reader(po);
+		free(cand.path);
+	}
+
+	return n_admitted;
+}
+
+static bool within_limit(struct postcache_pool *pool)
+{
+	return (pool->tab_mem_usage + pool->pos_mem_usage <=
+	        pool->tot_mem_limit);
+}
+
+int main()
+{
+	char path[MAX_DIR_PATH_NAME_LEN];
+	uint32_t i, j, k, n_paths = 16, n_items = 20000, n_diff = 0;
+	struct math_posting_item item;
+	struct math_pathinfo_pack head;
+	struct math_pathinfo info;
+	struct math_wr_cache *cache = math_wr_cache_new();
+	struct postcache_pool pool;
+	struct postcache_math_posting *mp;
+	math_posting_t po1, po2;
+
+	srand(1);
+
+	for (i = 0; i < n_items; i++) {
+		j = rand() % n_paths;
+		head.n_paths = 1 + rand() % 3;
+		head.n_lr_paths = 4;
+		item.doc_id = i / 10;
+		item.exp_id = i;
+
+		gen_path(path, "./tmp", j);
+		item.pathinfo_pos = math_wr_cache_file_sz(cache, path,
+		                                          MATH_WR_FILE_PATHINFO);
+		math_wr_cache_append(cache, path, MATH_WR_FILE_POSTING,
+		                     &item, sizeof(item));
+		math_wr_cache_append(cache, path, MATH_WR_FILE_PATHINFO,
+		                     &head, sizeof(head));
+
+		for (k = 0; k < head.n_paths; k++) {
+			info.path_id = k + 1;
+			info.lf_symb = rand();
+			info.fr_hash = rand();
+			math_wr_cache_append(cache, path, MATH_WR_FILE_PATHINFO,
+			                     &info, sizeof(info));
+		}
+	}
+
+	math_wr_cache_free(cache);
+
+	postcache_init(&pool, 2 * POSTCACHE_POOL_LIMIT_1MB);
+
+	for (j = 0; j < n_paths; j++) {
+		gen_path(path, "./tmp", j);
+		po1 = math_posting_new_reader(NULL, path);
+		postcache_add_math_posting(&pool, path + strlen("./tmp/"), po1);
+		math_posting_free_reader(po1);
+	}
+
+	postcache_print_mem_usage(&pool);
+
+	for (j = 0; j < n_paths; j++) {
+		gen_path(path, "./tmp", j);
+		mp = postcache_find_math(&pool, path + strlen("./tmp/"));
+
+		if (mp == NULL) {
+			printf("not cached: %s\n", path);
+			n_diff ++;
+			continue;
+		}
+
+		po1 = math_posting_new_reader(NULL, path);
+		po2 = math_posting_new_reader(NULL, path);
+		math_posting_set_mem(po2, 1, mp->data, mp->sz, NULL, 0);
+
+		if (cmp_postings(po1, po2)) {
+			printf("cached posting differs @ %s\n", path);
+			n_diff ++;
+		}
+
+		math_posting_free_reader(po1);
+		math_posting_free_reader(po2);
+	}
+
+	if (NULL != postcache_find_math(&pool, TOKEN_PATH_NAME "/VAR"))
+		n_diff ++;
+
+	/* shrink cache, lists are evicted to meet the lower limit */
+	postcache_set_mem_limit(&pool, POSTCACHE_POOL_LIMIT_1MB / 4);
+	postcache_print_mem_usage(&pool);
+	if (!within_limit(&pool) || pool.n_items == 0)
+		n_diff ++;
+
+	/* make cached lists popular, and find a list not cached */
+	postcache_clear_pending(&pool);
+	for (j = 0, k = n_paths; j < n_paths; j++) {
+		gen_path(path, ".", j);
+		if (NULL == postcache_find_math(&pool, path + 2))
+			k = j;
+		else
+			for (i = 0; i < 8; i++)
+				postcache_find_math(&pool, path + 2);
+	}
+
+	/* a cold list can not replace popular ones */
+	if (k == n_paths || 0 != admit_pending(&pool)) {
+		n_diff ++;
+	} else {
+		/* until it gets more popular */
+		gen_path(path, ".", k);
+		for (i = 0; i < 40; i++)
+			postcache_find_math(&pool, path + 2);
+
+		printf("admitted %u list(s) accessed frequently.\n",
+		       admit_pending(&pool));
+		if (NULL == postcache_find_math(&pool, path + 2) ||
+		    !within_limit(&pool))
+			n_diff ++;
+	}
+
+	postcache_set_mem_limit(&pool, 0);
+	if (pool.n_items != 0)
+		n_diff ++;
+
+	postcache_free(&pool);
+
+	if (n_diff == 0)
+		printf("identical output.\n");
+	else
+		printf("outputs differ!\n");
+
+	mhook_print_unfree();
+	return n_diff;
+}
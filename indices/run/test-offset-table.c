@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "mhook/mhook.h"
+#include "offset-table.h"
+
+#define TEST_TEXT_SZ 100000
+#define TEST_N_TERMS 1000
+
+int main(void)
+{
+	struct offset_table tab;
+	struct pos_range    ranges[TEST_N_TERMS];
+	struct pos_range    expect[TEST_N_TERMS];
+	position_t          pos[TEST_N_TERMS];
+	uint32_t            i, n = 0, offset = 0;
+	int                 found;
+
+	offset_table_init(&tab, TEST_TEXT_SZ);
+
+	for (i = 0; i < TEST_N_TERMS; i++) {
+		/* every third term overlaps its previous one, like those
+		 * segmented words of a longer word. */
+		if (i % 3 == 2)
+			offset -= 4;
+		else
+			offset += (i * 7) % 300;
+
+		expect[i].offset = offset;
+		expect[i].len = 1 + i % 13;
+		offset_table_add(&tab, expect[i].offset, expect[i].len);
+	}
+
+	printf("%u terms encoded into %lu bytes.\n", TEST_N_TERMS, tab.sz);
+
+	for (i = 0; i < TEST_N_TERMS; i += 1 + i % 5)
+		pos[n++] = i;
+
+	found = offset_table_lookup(tab.buf, tab.sz, TEST_TEXT_SZ,
+	                            pos, n, ranges);
+	printf("%d/%u positions found.\n", found, n);
+	assert(found == (int)n);
+
+	for (i = 0; i < n; i++) {
+		assert(ranges[i].offset == expect[pos[i]].offset);
+		assert(ranges[i].len == expect[pos[i]].len);
+	}
+
+	/* positions out of table are not found */
+	pos[0] = TEST_N_TERMS;
+	found = offset_table_lookup(tab.buf, tab.sz, TEST_TEXT_SZ,
+	                            pos, 1, ranges);
+	assert(found == 0);
+
+	/* table of another document text */
+	found = offset_table_lookup(tab.buf, tab.sz, TEST_TEXT_SZ + 1,
+	                            pos, 1, ranges);
+	assert(found == -1);
+
+	offset_table_free(&tab);
+
+	mhook_print_unfree();
+	return 0;
+}
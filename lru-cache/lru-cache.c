@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wstring/wstring.h"
+
+#include "lru-cache.h"
+
+int lru_cache_init(struct lru_cache *cache, uint32_t n_buckets,
+                   uint64_t mem_limit, lru_cache_free_callbk free_ent)
+{
+	cache->bucket = calloc(n_buckets, sizeof(struct lru_cache_ent*));
+	if (cache->bucket == NULL) {
+		fprintf(stderr, "cannot allocate %u cache buckets.\n", n_buckets);
+		return 1;
+	}
+
+	cache->n_buckets = n_buckets;
+	LIST_CONS(cache->lru);
+	cache->n_ents = 0;
+	cache->mem_usage = 0;
+	cache->mem_limit = mem_limit;
+	cache->free_ent = free_ent;
+	pthread_mutex_init(&cache->mutex, NULL);
+
+	return 0;
+}
+
+static void free_ent(struct lru_cache *cache, struct lru_cache_ent *ent)
+{
+	free(ent->key);
+	cache->free_ent(ent);
+}
+
+static void
+evict_ent(struct lru_cache *cache, struct lru_cache_ent *ent)
+{
+	struct lru_cache_ent **p;
+	uint32_t b = ent->hash % cache->n_buckets;
+
+	/* unlink from hash bucket */
+	for (p = cache->bucket + b; *p != ent; p = &(*p)->hash_next);
+	*p = ent->hash_next;
+
+	list_detach_one(&ent->ln, &cache->lru, NULL, NULL);
+	cache->n_ents --;
+	cache->mem_usage -= ent->mem_usage;
+	ent->cached = 0;
+
+	/* otherwise, it is freed by its last user */
+	if (ent->n_refs == 0)
+		free_ent(cache, ent);
+}
+
+static void clear(struct lru_cache *cache)
+{
+	while (cache->lru.now)
+		evict_ent(cache, MEMBER_2_STRUCT(cache->lru.now,
+		                                 struct lru_cache_ent, ln));
+}
+
+void lru_cache_clear(struct lru_cache *cache)
+{
+	pthread_mutex_lock(&cache->mutex);
+	clear(cache);
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+void lru_cache_free(struct lru_cache *cache)
+{
+	if (cache->bucket == NULL)
+		return;
+
+	clear(cache);
+	free(cache->bucket);
+	cache->bucket = NULL;
+	pthread_mutex_destroy(&cache->mutex);
+}
+
+void lru_cache_ent_init(struct lru_cache_ent *ent, const char *key,
+                        uint64_t mem_usage)
+{
+	ent->key = strdup(key);
+	ent->hash = str_hash(key);
+	ent->mem_usage = mem_usage + strlen(key) + 1;
+	ent->n_refs = 1;
+	ent->cached = 0;
+	ent->hash_next = NULL;
+	LIST_NODE_CONS(ent->ln);
+}
+
+static struct lru_cache_ent *
+lookup(struct lru_cache *cache, const char *key, uint32_t h)
+{
+	struct lru_cache_ent *ent;
+
+	ent = cache->bucket[h % cache->n_buckets];
+	for (; ent != NULL; ent = ent->hash_next)
+		if (ent->hash == h && 0 == strcmp(ent->key, key))
+			return ent;
+
+	return NULL;
+}
+
+/* move an entry to the tail (most recently used) of LRU list */
+static void lru_touch(struct lru_cache *cache, struct lru_cache_ent *ent)
+{
+	list_detach_one(&ent->ln, &cache->lru, NULL, NULL);
+	LIST_NODE_CONS(ent->ln);
+	list_insert_one_at_tail(&ent->ln, &cache->lru, NULL, NULL);
+}
+
+struct lru_cache_ent *lru_cache_get(struct lru_cache *cache, const char *key)
+{
+	struct lru_cache_ent *ent;
+	uint32_t h = str_hash(key);
+
+	pthread_mutex_lock(&cache->mutex);
+	ent = lookup(cache, key, h);
+
+	if (ent) {
+		ent->n_refs ++;
+		lru_touch(cache, ent);
+	}
+	pthread_mutex_unlock(&cache->mutex);
+
+	return ent;
+}
+
+bool lru_cache_put(struct lru_cache *cache, struct lru_cache_ent *ent)
+{
+	uint32_t b = ent->hash % cache->n_buckets;
+	bool cached = 0;
+
+	pthread_mutex_lock(&cache->mutex);
+
+	/* another thread may have cached the same key */
+	if (ent->mem_usage > cache->mem_limit ||
+	    lookup(cache, ent->key, ent->hash))
+		goto unlock;
+
+	/* evict the least recently used entries until it fits */
+	while (cache->mem_usage + ent->mem_usage > cache->mem_limit)
+		evict_ent(cache, MEMBER_2_STRUCT(cache->lru.now,
+		                                 struct lru_cache_ent, ln));
+
+	ent->hash_next = cache->bucket[b];
+	cache->bucket[b] = ent;
+
+	list_insert_one_at_tail(&ent->ln, &cache->lru, NULL, NULL);
+	cache->n_ents ++;
+	cache->mem_usage += ent->mem_usage;
+	ent->cached = cached = 1;
+
+unlock:
+	pthread_mutex_unlock(&cache->mutex);
+	return cached;
+}
+
+void lru_cache_release(struct lru_cache *cache, struct lru_cache_ent *ent)
+{
+	bool last_user;
+
+	pthread_mutex_lock(&cache->mutex);
+	last_user = (-- ent->n_refs == 0 && !ent->cached);
+	pthread_mutex_unlock(&cache->mutex);
+
+	if (last_user)
+		free_ent(cache, ent);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "list/list.h"
+
+/*
+ * string-keyed cache bounded by bytes and evicted in LRU order. An entry
+ * is embedded in the structure of cached value, entries in use are pinned
+ * by reference count and an evicted entry is freed by its last user.
+ */
+struct lru_cache_ent {
+	char                 *key;
+	uint32_t              hash;
+	uint64_t              mem_usage; /* including key and entry itself */
+	uint32_t              n_refs;
+	bool                  cached; /* in hash table and LRU list */
+	struct lru_cache_ent *hash_next;
+	struct list_node      ln;
+};
+
+/* free the structure embedding an entry (except the key) */
+typedef void (*lru_cache_free_callbk)(struct lru_cache_ent*);
+
+struct lru_cache {
+	struct lru_cache_ent **bucket;
+	uint32_t        n_buckets;
+	list            lru; /* lru.now is the least recently used */
+	uint32_t        n_ents;
+	uint64_t        mem_usage, mem_limit;
+	lru_cache_free_callbk free_ent;
+	pthread_mutex_t mutex; /* shared by search threads */
+};
+
+int  lru_cache_init(struct lru_cache*, uint32_t, uint64_t,
+                    lru_cache_free_callbk);
+void lru_cache_free(struct lru_cache*); /* no entry should be pinned */
+
+/* drop all entries */
+void lru_cache_clear(struct lru_cache*);
+
+/* initialize a new entry of a key (copied) and the memory usage of its
+ * embedding structure, the entry is returned pinned by its creator. */
+void lru_cache_ent_init(struct lru_cache_ent*, const char*, uint64_t);
+
+/* return pinned cached entry of a key, NULL if not cached */
+struct lru_cache_ent *lru_cache_get(struct lru_cache*, const char*);
+
+/* cache a new entry if it fits in memory limit and its key is not cached,
+ * return true if it is cached. The entry stays pinned either way. */
+bool lru_cache_put(struct lru_cache*, struct lru_cache_ent*);
+
+/* unpin an entry, it is freed if not cached and it is the last user */
+void lru_cache_release(struct lru_cache*, struct lru_cache_ent*);
@@ -0,0 +1,588 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "dir-util/dir-util.h"
+#include "wstring/wstring.h"
+#include "head.h"
+
+static void run_file_path(struct math_bulk_builder *b, uint32_t n, char *dest)
+{
+	sprintf(dest, "%s/" MATH_BULK_RUN_FNAME ".%u", b->run_dir, n);
+}
+
+struct math_bulk_builder *math_bulk_new(const char *run_dir)
+{
+	struct math_bulk_builder *b = malloc(sizeof(struct math_bulk_builder));
+
+	sprintf(b->run_dir, "%s", run_dir);
+	b->n_runs = 0;
+
+	b->str_buf = NULL;
+	b->str_sz = b->str_cap = 0;
+	b->path_off = b->path_next = NULL;
+	b->n_paths = b->path_cap = 0;
+	b->bucket = calloc(MATH_BULK_BUCKETS, sizeof(uint32_t));
+
+	b->recs = NULL;
+	b->n_recs = b->rec_cap = 0;
+
+	return b;
+}
+
+void math_bulk_free(struct math_bulk_builder *b)
+{
+	free(b->str_buf);
+	free(b->path_off);
+	free(b->path_next);
+	free(b->bucket);
+	free(b->recs);
+	free(b);
+}
+
+/* memory allocated for run buffers (they are reused across runs) */
+static size_t mem_usage(struct math_bulk_builder *b)
+{
+	return b->str_cap +
+	       (size_t)b->path_cap * 2 * sizeof(uint32_t) +
+	       (size_t)b->rec_cap * sizeof(struct math_bulk_rec);
+}
+
+/* capacity (doubled from init) to hold at least `need' units */
+static size_t next_cap(size_t cap, size_t init, size_t need)
+{
+	cap = (cap) ? cap : init;
+	while (cap < need)
+		cap = cap << 1;
+	return cap;
+}
+
+/* extra memory to allocate for adding a record (of a new path) */
+static size_t grow_size(struct math_bulk_builder *b, bool new_path,
+                        size_t len)
+{
+	size_t sz = (next_cap(b->rec_cap, 4096, b->n_recs + 1) - b->rec_cap) *
+	            sizeof(struct math_bulk_rec);
+
+	if (new_path) {
+		sz += next_cap(b->str_cap, 4096, b->str_sz + len) - b->str_cap;
+		sz += (next_cap(b->path_cap, 1024, b->n_paths + 1) - b->path_cap) *
+		      2 * sizeof(uint32_t);
+	}
+
+	return sz;
+}
+
+static void grow(struct math_bulk_builder *b, bool new_path, size_t len)
+{
+	if (b->n_recs == b->rec_cap) {
+		b->rec_cap = next_cap(b->rec_cap, 4096, b->n_recs + 1);
+		b->recs = realloc(b->recs,
+		                  b->rec_cap * sizeof(struct math_bulk_rec));
+	}
+
+	if (!new_path)
+		return;
+
+	if (b->str_sz + len > b->str_cap) {
+		b->str_cap = next_cap(b->str_cap, 4096, b->str_sz + len);
+		b->str_buf = realloc(b->str_buf, b->str_cap);
+	}
+
+	if (b->n_paths == b->path_cap) {
+		b->path_cap = next_cap(b->path_cap, 1024, b->n_paths + 1);
+		b->path_off = realloc(b->path_off, b->path_cap * sizeof(uint32_t));
+		b->path_next = realloc(b->path_next, b->path_cap * sizeof(uint32_t));
+	}
+}
+
+#define MATH_BULK_NO_PATH UINT32_MAX
+
+/* return the path ID within current run, or MATH_BULK_NO_PATH */
+static uint32_t path_lookup(struct math_bulk_builder *b, const char *path,
+                            uint32_t h)
+{
+	uint32_t id;
+
+	for (id = b->bucket[h]; id != 0; id = b->path_next[id - 1])
+		if (0 == strcmp(b->str_buf + b->path_off[id - 1], path))
+			return id - 1;
+
+	return MATH_BULK_NO_PATH;
+}
+
+/* add a new path to current run (buffers are grown in advance) */
+static uint32_t path_insert(struct math_bulk_builder *b, const char *path,
+                            uint32_t h, size_t len)
+{
+	uint32_t id = b->n_paths ++;
+
+	memcpy(b->str_buf + b->str_sz, path, len);
+	b->path_off[id] = b->str_sz;
+	b->str_sz += len;
+
+	b->path_next[id] = b->bucket[h];
+	b->bucket[h] = id + 1;
+
+	return id;
+}
+
+/*
+ * spill a sorted run to disk
+ */
+struct path_rank {
+	const char *str;
+	uint32_t    id;
+};
+
+static int path_rank_cmp(const void *a, const void *b)
+{
+	const struct path_rank *x = a, *y = b;
+	return strcmp(x->str, y->str);
+}
+
+static int rec_cmp(const void *a, const void *b)
+{
+	const struct math_bulk_rec *x = a, *y = b;
+
+	if (x->path_id != y->path_id)
+		return (x->path_id < y->path_id) ? -1 : 1;
+	else
+		return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+static int spill_run(struct math_bulk_builder *b)
+{
+	FILE *fh;
+	char run_path[MAX_DIR_PATH_NAME_LEN];
+	struct path_rank *sorted;
+	uint32_t *rank;
+	uint32_t i, j, len, n;
+	int ret = 0;
+
+	if (b->n_recs == 0)
+		return 0;
+
+	run_file_path(b, b->n_runs, run_path);
+	fh = fopen(run_path, "w");
+	if (fh == NULL) {
+		fprintf(stderr, "cannot create run file %s\n", run_path);
+		return -1;
+	}
+
+	/* sort path strings and rank records by their path */
+	sorted = malloc(b->n_paths * sizeof(struct path_rank));
+	rank = malloc(b->n_paths * sizeof(uint32_t));
+
+	for (i = 0; i < b->n_paths; i++) {
+		sorted[i].str = b->str_buf + b->path_off[i];
+		sorted[i].id = i;
+	}
+	qsort(sorted, b->n_paths, sizeof(struct path_rank), &path_rank_cmp);
+
+	for (i = 0; i < b->n_paths; i++)
+		rank[sorted[i].id] = i;
+
+	for (i = 0; i < b->n_recs; i++)
+		b->recs[i].path_id = rank[b->recs[i].path_id];
+
+	qsort(b->recs, b->n_recs, sizeof(struct math_bulk_rec), &rec_cmp);
+
+#ifdef DEBUG_MATH_BULK
+	printf("spill run#%u: %u records of %u paths.\n",
+	       b->n_runs, b->n_recs, b->n_paths);
+#endif
+
+	/* write path groups: {path length, path, n, n * (file, len, data)} */
+	for (i = 0; i < b->n_recs; i = j) {
+		for (j = i; j < b->n_recs; j++)
+			if (b->recs[j].path_id != b->recs[i].path_id)
+				break;
+
+		len = strlen(sorted[b->recs[i].path_id].str);
+		n = j - i;
+		fwrite(&len, 1, sizeof(uint32_t), fh);
+		fwrite(sorted[b->recs[i].path_id].str, 1, len, fh);
+		fwrite(&n, 1, sizeof(uint32_t), fh);
+
+		for (n = i; n < j; n++) {
+			fwrite(&b->recs[n].file, 1, sizeof(uint8_t), fh);
+			fwrite(&b->recs[n].len, 1, sizeof(uint8_t), fh);
+			fwrite(b->recs[n].data, 1, b->recs[n].len, fh);
+		}
+	}
+
+	if (ferror(fh)) {
+		fprintf(stderr, "cannot write run file %s\n", run_path);
+		ret = -1;
+	}
+
+	fclose(fh);
+	free(sorted);
+	free(rank);
+
+	/* reset current run */
+	b->n_runs ++;
+	b->n_recs = 0;
+	b->n_paths = 0;
+	b->str_sz = 0;
+	memset(b->bucket, 0, MATH_BULK_BUCKETS * sizeof(uint32_t));
+
+	return ret;
+}
+
+int math_bulk_add(struct math_bulk_builder *b, const char *path,
+                  enum math_wr_file file, const void *data, size_t len)
+{
+	struct math_bulk_rec *rec;
+	uint32_t h = str_hash(path) % MATH_BULK_BUCKETS;
+	uint32_t id = path_lookup(b, path, h);
+	size_t path_len = strlen(path) + 1;
+
+	/* spill current run rather than doubling a buffer past the budget,
+	 * buffers are then emptied and need not grow for this record */
+	if (b->n_recs > 0 && mem_usage(b) +
+	    grow_size(b, id == MATH_BULK_NO_PATH, path_len) >
+	    MATH_BULK_MEM_BUDGET) {
+		if (spill_run(b))
+			return -1;
+		id = MATH_BULK_NO_PATH;
+	}
+
+	grow(b, id == MATH_BULK_NO_PATH, path_len);
+	if (id == MATH_BULK_NO_PATH)
+		id = path_insert(b, path, h, path_len);
+
+	rec = b->recs + b->n_recs;
+	rec->path_id = id;
+	rec->seq = b->n_recs ++;
+	rec->file = file;
+	rec->len = len;
+	memcpy(rec->data, data, len);
+
+	return 0;
+}
+
+/*
+ * merge runs
+ */
+struct bulk_run {
+	FILE     *fh;
+	uint32_t  idx;
+	uint32_t  n_left; /* records left in current path group */
+	char      path[MAX_DIR_PATH_NAME_LEN];
+};
+
+static bool run_next_group(struct bulk_run *r)
+{
+	uint32_t len;
+
+	if (1 != fread(&len, sizeof(uint32_t), 1, r->fh) ||
+	    len >= MAX_DIR_PATH_NAME_LEN)
+		return 0;
+
+	if (len != fread(r->path, 1, len, r->fh))
+		return 0;
+	r->path[len] = '\0';
+
+	if (1 != fread(&r->n_left, sizeof(uint32_t), 1, r->fh))
+		return 0;
+
+	return 1;
+}
+
+/* path groups of the same path are merged in order of runs */
+static bool run_less(struct bulk_run *a, struct bulk_run *b)
+{
+	int res = strcmp(a->path, b->path);
+	return (res < 0 || (res == 0 && a->idx < b->idx));
+}
+
+static void heap_sift_down(struct bulk_run **heap, uint32_t n, uint32_t i)
+{
+	uint32_t min, l, r;
+	struct bulk_run *tmp;
+
+	while (1) {
+		min = i;
+		l = 2 * i + 1;
+		r = 2 * i + 2;
+
+		if (l < n && run_less(heap[l], heap[min]))
+			min = l;
+		if (r < n && run_less(heap[r], heap[min]))
+			min = r;
+
+		if (min == i)
+			break;
+
+		tmp = heap[i];
+		heap[i] = heap[min];
+		heap[min] = tmp;
+		i = min;
+	}
+}
+
+struct bulk_out {
+	FILE     *fh[MATH_WR_FILES];
+	char     *buf[MATH_WR_FILES];
+	uint64_t  pathinfo_pos;
+	uint64_t  posting_off;
+
+	/* pending items of a block-compressed posting */
+	bool      blk;
+	uint32_t  n_blk_items;
+	struct math_posting_item blk_items[MATH_POSTING_BLK_ITEMS];
+
+	/* pathinfo of pending items, if they are inlined into blocks */
+	bool      inl;
+	char     *pinfo;
+	size_t    pinfo_cap;
+};
+
+static int out_open(struct bulk_out *out, const char *path)
+{
+	int i;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	const char *fname[MATH_WR_FILES] = {
+		MATH_POSTING_FNAME,
+		PATH_INFO_FNAME,
+		MATH_POSTING_SKP_FNAME
+	};
+
+	mkdir_p(path);
+
+	out->blk = math_posting_blk_writable(path);
+	out->n_blk_items = 0;
+	if (out->blk)
+		fname[MATH_WR_FILE_POSTING] = MATH_POSTING_BLK_FNAME;
+
+#ifdef MATH_POSTING_BLK_INLINE
+	out->inl = out->blk;
+#else
+	out->inl = 0;
+#endif
+
+	for (i = 0; i < MATH_WR_FILES; i++) {
+		if (i == MATH_WR_FILE_SKIP &&
+		    !math_posting_skip_writable(path, out->blk))
+			continue;
+		else if (i == MATH_WR_FILE_PATHINFO && out->inl)
+			continue;
+
+		sprintf(file_path, "%s/%s", path, fname[i]);
+		out->fh[i] = fopen(file_path, "a");
+
+		if (out->fh[i] == NULL) {
+			fprintf(stderr, "cannot open %s\n", file_path);
+			return -1;
+		}
+
+		setvbuf(out->fh[i], out->buf[i], _IOFBF, MATH_BULK_OUT_BUF_SZ);
+	}
+
+	/* positions are relative to existing pathinfo file, or to
+	 * the pathinfo buffer of pending items if they are inlined */
+	if (out->inl) {
+		out->pathinfo_pos = 0;
+	} else {
+		fseek(out->fh[MATH_WR_FILE_PATHINFO], 0, SEEK_END);
+		out->pathinfo_pos = ftell(out->fh[MATH_WR_FILE_PATHINFO]);
+	}
+
+	fseek(out->fh[MATH_WR_FILE_POSTING], 0, SEEK_END);
+	out->posting_off = ftell(out->fh[MATH_WR_FILE_POSTING]);
+
+	return 0;
+}
+
+static void out_flush_blk(struct bulk_out *out)
+{
+	FILE *fh = out->fh[MATH_WR_FILE_POSTING];
+
+	if (fh && out->n_blk_items)
+		math_posting_blk_write(fh, out->fh[MATH_WR_FILE_SKIP],
+		                       out->blk_items, out->n_blk_items,
+		                       (out->inl) ? out->pinfo : NULL,
+		                       &out->posting_off);
+
+	out->n_blk_items = 0;
+
+	if (out->inl)
+		out->pathinfo_pos = 0;
+}
+
+static void out_pinfo(struct bulk_out *out, const void *data, size_t len)
+{
+	if (out->pathinfo_pos + len > out->pinfo_cap) {
+		out->pinfo_cap = (out->pinfo_cap) ? out->pinfo_cap : 4096;
+		while (out->pathinfo_pos + len > out->pinfo_cap)
+			out->pinfo_cap = out->pinfo_cap << 1;
+		out->pinfo = realloc(out->pinfo, out->pinfo_cap);
+	}
+
+	memcpy(out->pinfo + out->pathinfo_pos, data, len);
+}
+
+/* add skip entry for every full read chunk of raw posting */
+static void out_skip_raw(struct bulk_out *out, struct math_posting_item *item)
+{
+	struct math_posting_skip skip;
+	out->posting_off += sizeof(struct math_posting_item);
+
+	if (out->fh[MATH_WR_FILE_SKIP] &&
+	    out->posting_off % MATH_POSTING_SKIP_RAW_BYTES == 0) {
+		skip.max_id = *(uint64_t*)item;
+		skip.offset = out->posting_off - MATH_POSTING_SKIP_RAW_BYTES;
+		fwrite(&skip, 1, sizeof(skip), out->fh[MATH_WR_FILE_SKIP]);
+	}
+}
+
+static void out_close(struct bulk_out *out)
+{
+	int i;
+
+	if (out->blk)
+		out_flush_blk(out);
+
+	for (i = 0; i < MATH_WR_FILES; i++) {
+		if (out->fh[i])
+			fclose(out->fh[i]);
+		out->fh[i] = NULL;
+	}
+}
+
+static int out_drain_group(struct bulk_out *out, struct bulk_run *r)
+{
+	uint8_t file, len;
+	char data[sizeof(struct math_posting_item)];
+	struct math_posting_item *item = (struct math_posting_item *)data;
+
+	for (; r->n_left != 0; r->n_left --) {
+		if (1 != fread(&file, sizeof(uint8_t), 1, r->fh) ||
+		    1 != fread(&len, sizeof(uint8_t), 1, r->fh) ||
+		    len > sizeof(data) || file >= MATH_WR_FILES ||
+		    len != fread(data, 1, len, r->fh)) {
+			fprintf(stderr, "corrupted run file #%u\n", r->idx);
+			return -1;
+		}
+
+		/* a full block is flushed only when next item comes, by
+		 * then all of its inlined pathinfo packs are complete. */
+		if (file == MATH_WR_FILE_POSTING && out->blk &&
+		    out->n_blk_items == MATH_POSTING_BLK_ITEMS)
+			out_flush_blk(out);
+
+		if (file == MATH_WR_FILE_POSTING) {
+			item->pathinfo_pos = (uint32_t)out->pathinfo_pos;
+		} else {
+			if (out->inl)
+				out_pinfo(out, data, len);
+			out->pathinfo_pos += len;
+		}
+
+		if (file == MATH_WR_FILE_POSTING && out->blk) {
+			out->blk_items[out->n_blk_items ++] = *item;
+		} else if (out->fh[file]) {
+			fwrite(data, 1, len, out->fh[file]);
+		}
+
+		if (file == MATH_WR_FILE_POSTING && !out->blk)
+			out_skip_raw(out, item);
+	}
+
+	return 0;
+}
+
+static int merge_runs(struct math_bulk_builder *b)
+{
+	int ret = 0;
+	uint32_t i, n_heap = 0;
+	char run_path[MAX_DIR_PATH_NAME_LEN];
+	char cur_path[MAX_DIR_PATH_NAME_LEN];
+	struct bulk_run *runs, **heap, *top;
+	struct bulk_out out;
+
+	runs = malloc(b->n_runs * sizeof(struct bulk_run));
+	heap = malloc(b->n_runs * sizeof(struct bulk_run *));
+
+	for (i = 0; i < MATH_WR_FILES; i++) {
+		out.fh[i] = NULL;
+		out.buf[i] = malloc(MATH_BULK_OUT_BUF_SZ);
+	}
+
+	out.pinfo = NULL;
+	out.pinfo_cap = 0;
+
+	for (i = 0; i < b->n_runs; i++) {
+		run_file_path(b, i, run_path);
+		runs[i].idx = i;
+		runs[i].fh = fopen(run_path, "r");
+
+		if (runs[i].fh == NULL) {
+			fprintf(stderr, "cannot open run file %s\n", run_path);
+			ret = -1;
+			continue;
+		}
+
+		if (run_next_group(runs + i))
+			heap[n_heap ++] = runs + i;
+	}
+
+	for (i = n_heap / 2; i > 0; i--)
+		heap_sift_down(heap, n_heap, i - 1);
+
+	while (n_heap) {
+		strcpy(cur_path, heap[0]->path);
+
+		if (out_open(&out, cur_path))
+			ret = -1;
+
+		/* append every group of this path, in order of runs */
+		while (n_heap && 0 == strcmp(heap[0]->path, cur_path)) {
+			top = heap[0];
+
+			if (out_drain_group(&out, top)) {
+				ret = -1;
+				heap[0] = heap[-- n_heap];
+			} else if (!run_next_group(top)) {
+				heap[0] = heap[-- n_heap];
+			}
+
+			heap_sift_down(heap, n_heap, 0);
+		}
+
+		out_close(&out);
+	}
+
+	for (i = 0; i < b->n_runs; i++) {
+		if (runs[i].fh)
+			fclose(runs[i].fh);
+
+		run_file_path(b, i, run_path);
+		unlink(run_path);
+	}
+
+	for (i = 0; i < MATH_WR_FILES; i++)
+		free(out.buf[i]);
+	free(out.pinfo);
+
+	free(heap);
+	free(runs);
+
+	b->n_runs = 0;
+	return ret;
+}
+
+int math_bulk_finish(struct math_bulk_builder *b)
+{
+	if (spill_run(b))
+		return -1;
+
+#ifdef DEBUG_MATH_BULK
+	printf("merging %u runs...\n", b->n_runs);
+#endif
+
+	return merge_runs(b);
+}
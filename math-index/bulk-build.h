@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "math-index.h" /* for math_posting_item */
+#include "wr-cache.h"   /* for enum math_wr_file */
+
+/*
+ * math index bulk builder: accumulates the records that would be
+ * appended to each path directory into a memory budget, spills
+ * them as sorted runs, and finally k-way merges all runs so that
+ * every posting/pathinfo file is written sequentially at once.
+ *
+ * Output postings carry the same items and pathinfo packs as what
+ * the append writer would produce, but not the same bytes: new
+ * postings are written in blocks with pathinfo inlined and no
+ * pathinfo file, while existing plain postings are appended with
+ * pathinfo positions fixed up upon merge (relative to the size of
+ * pre-existing pathinfo file).
+ *
+ * Memory budget covers the allocated capacity of run buffers, a
+ * run is spilled before any of them doubles past the budget.
+ */
+struct math_bulk_rec {
+	uint32_t path_id; /* index of path string (rank after sort) */
+	uint32_t seq;     /* order of addition within a run */
+	uint8_t  file;    /* enum math_wr_file */
+	uint8_t  len;
+	char     data[sizeof(struct math_posting_item)];
+};
+
+struct math_bulk_builder {
+	char      run_dir[MAX_DIR_PATH_NAME_LEN];
+	uint32_t  n_runs;
+
+	/* path string table of current run */
+	char     *str_buf;
+	size_t    str_sz, str_cap;
+	uint32_t *path_off, *path_next;
+	uint32_t  n_paths, path_cap;
+	uint32_t *bucket; /* path_id + 1, zero for empty */
+
+	/* records of current run */
+	struct math_bulk_rec *recs;
+	uint32_t  n_recs, rec_cap;
+};
+
+struct math_bulk_builder *math_bulk_new(const char*);
+void math_bulk_free(struct math_bulk_builder*);
+
+int math_bulk_add(struct math_bulk_builder*, const char*,
+                  enum math_wr_file, const void*, size_t);
+
+/* spill current run and merge all runs into path directories */
+int math_bulk_finish(struct math_bulk_builder*);
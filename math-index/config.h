@@ -18,3 +18,49 @@
 //#define DEBUG_MATH_POSTING
 
 //#define DEBUG_MATH_INDEX
+
+/* math index write cache (MATH_INDEX_WRITE_BUFFERED) */
+#define MATH_WR_CACHE_BUCKETS       (1 << 16)
+#define MATH_WR_CACHE_MAX_ENTS      (1 << 17)
+#define MATH_WR_CACHE_MAX_OPEN      128
+#define MATH_WR_CACHE_ENT_BUF_SZ    (DISK_BLCK_SIZE * DISK_RD_BLOCKS)
+#define MATH_WR_CACHE_MAX_BUF_BYTES (256 << 20)
+
+//#define DEBUG_MATH_WR_CACHE
+
+/* math index bulk builder (MATH_INDEX_WRITE_BULK) */
+#define MATH_BULK_BUCKETS       (1 << 16)
+#define MATH_BULK_MEM_BUDGET    (512 << 20)
+#define MATH_BULK_RUN_FNAME     "bulk-run"
+#define MATH_BULK_OUT_BUF_SZ    (DISK_BLCK_SIZE * 16)
+
+//#define DEBUG_MATH_BULK
+
+/* block-compressed math posting list */
+#define MATH_POSTING_BLK_FNAME "posting-blk.bin"
+#define MATH_POSTING_BLK_ITEMS 256
+
+/* math posting skip table (side file of posting lists) */
+#define MATH_POSTING_SKP_FNAME "posting.skp"
+
+/* let buffered/bulk writers create new posting lists in block format,
+ * existing posting.bin files are still appended in raw format. */
+#define MATH_POSTING_BLK_WRITE
+
+/* let bulk builder inline pathinfo packs into posting blocks, so
+ * that no pathinfo.bin is needed for new posting lists. */
+#define MATH_POSTING_BLK_INLINE
+
+/* read posting (and pathinfo) files through mmap() rather than
+ * stdio if they are at least MATH_POSTING_MMAP_MIN_SZ bytes, smaller
+ * files take only one read anyway. */
+#define MATH_POSTING_MMAP
+#define MATH_POSTING_MMAP_MIN_SZ (DISK_BLCK_SIZE * DISK_RD_BLOCKS)
+
+/* packed math index (path dictionary plus two data files), which is
+ * used instead of path directories if it exists at index root. */
+#define MATH_PACKED_DICT_FNAME     "packed.dict"
+#define MATH_PACKED_POSTING_FNAME  "packed-posting.bin"
+#define MATH_PACKED_PATHINFO_FNAME "packed-pathinfo.bin"
+
+//#define DEBUG_MATH_PACKED
@@ -0,0 +1,2 @@
+CFLAGS +=
+LDFLAGS +=
@@ -59,6 +59,25 @@ print_all_dir_strings(struct dir_merge_args *dm_args)
 	}
 }
 
+/*
+ * let reader use cached posting list if there is one, `suffix' is
+ * the path relative to base path of set element `i'.
+ */
+static bool
+use_cached(struct dir_merge_args *dm_args, uint32_t i, const char *suffix,
+           math_posting_t po)
+{
+	math_index_t index = dm_args->index;
+	char relpath[MAX_DIR_PATH_NAME_LEN];
+
+	if (index->cache_lookup == NULL)
+		return 0;
+
+	sprintf(relpath, "%s%s",
+	        dm_args->base_paths[i] + strlen(index->dir) + 1, suffix);
+	return index->cache_lookup(relpath, po, index->cache_arg);
+}
+
 /*
  * directory search callback function.
  */
@@ -78,6 +97,10 @@ dir_search_callbk(const char* path, const char *srchpath,
 		postings[i] = math_posting_new_reader(dm_args->eles[i],
 		                               dm_args->full_paths[i]);
 
+		/* a cached path exists, srchpath is "." or "./..." */
+		if (use_cached(dm_args, i, srchpath + 1, postings[i]))
+			continue;
+
 		if (!dir_exists(dm_args->full_paths[i])) {
 #ifdef DEBUG_DIR_MERGE
 			printf("stop subdir merging @ %s/%s.\n", path, srchpath);
@@ -107,6 +130,107 @@ free_postings:
 	return ret;
 }
 
+/*
+ * merge by walking path dictionary (of a packed index or in-memory
+ * path trie) instead of directories, so that no stat() is needed.
+ * Each BFS queue entry is {level, node IDs of set}.
+ */
+static void
+queue_push(uint32_t **Q, uint32_t *tail, uint32_t *cap, uint32_t ent_sz,
+           const uint32_t *ent)
+{
+	if (*tail == *cap) {
+		*cap = (*cap) ? *cap << 1 : 64;
+		*Q = realloc(*Q, *cap * ent_sz * sizeof(uint32_t));
+	}
+
+	memcpy(*Q + (*tail) * ent_sz, ent, ent_sz * sizeof(uint32_t));
+	(*tail) ++;
+}
+
+static void packed_dir_merge(struct dir_merge_args *dm_args)
+{
+	struct math_packed *packed = dm_args->index->packed;
+	size_t dir_len = strlen(dm_args->index->dir) + 1;
+	uint32_t i, c, n = dm_args->set_sz, ent_sz = n + 1;
+	uint32_t *Q = NULL, head = 0, tail = 0, cap = 0;
+	uint32_t cur[MAX_MATH_PATHS + 1], next[MAX_MATH_PATHS + 1];
+	uint32_t longnode;
+	const struct math_packed_node *lnode;
+	char suffix[MAX_DIR_PATH_NAME_LEN];
+	const char *name;
+	math_posting_t postings[MAX_MATH_PATHS];
+	enum dir_merge_ret res;
+
+	/* root entry */
+	cur[0] = 0;
+	for (i = 0; i < n; i++) {
+		cur[1 + i] = math_packed_lookup(packed,
+		                                dm_args->base_paths[i] + dir_len);
+		if (cur[1 + i] == MATH_PACKED_NONE)
+			return;
+	}
+
+	queue_push(&Q, &tail, &cap, ent_sz, cur);
+	longnode = cur[1 + dm_args->longpath];
+
+	while (head < tail) {
+		memcpy(cur, Q + head * ent_sz, ent_sz * sizeof(uint32_t));
+		head ++;
+
+		/* relative path is the same for every base path */
+		math_packed_path(packed, longnode, cur[1 + dm_args->longpath],
+		                 suffix);
+
+		for (i = 0; i < n; i++) {
+			sprintf(dm_args->full_paths[i], "%s%s",
+			        dm_args->base_paths[i], suffix);
+
+			postings[i] = math_posting_new_reader(dm_args->eles[i],
+			                               dm_args->full_paths[i]);
+			math_packed_set_reader(packed, cur[1 + i], postings[i]);
+			use_cached(dm_args, i, suffix, postings[i]);
+		}
+
+#ifdef DEBUG_DIR_MERGE
+		printf("post merging at packed paths:\n");
+		print_all_dir_strings(dm_args);
+		printf("\n");
+#endif
+		res = dm_args->fun(postings, n, cur[0], dm_args->args);
+
+		for (i = 0; i < n; i++)
+			math_posting_free_reader(postings[i]);
+
+		if (res == DIR_MERGE_RET_STOP)
+			break;
+
+		/* push children which exist under every base path */
+		lnode = packed->nodes + cur[1 + dm_args->longpath];
+		for (c = lnode->child_begin;
+		     c < lnode->child_begin + lnode->n_children; c++) {
+			name = math_packed_name(packed, c);
+			next[0] = cur[0] + 1;
+
+			for (i = 0; i < n; i++) {
+				if (i == dm_args->longpath)
+					next[1 + i] = c;
+				else
+					next[1 + i] = math_packed_child(packed, cur[1 + i],
+					                                name);
+
+				if (next[1 + i] == MATH_PACKED_NONE)
+					break;
+			}
+
+			if (i == n)
+				queue_push(&Q, &tail, &cap, ent_sz, next);
+		}
+	}
+
+	free(Q);
+}
+
 /*
  * dir-merge initialization related functions.
  */
@@ -216,7 +340,9 @@ int math_index_dir_merge(math_index_t index, enum dir_merge_type type,
 #endif
 
 	/* now we can start merge path directories */
-	if (type == DIR_MERGE_DEPTH_FIRST) {
+	if (type == DIR_MERGE_DEPTH_FIRST && index->packed) {
+		packed_dir_merge(&dm_args);
+	} else if (type == DIR_MERGE_DEPTH_FIRST) {
 		dir_search_bfs(dm_args.base_paths[dm_args.longpath],
 		               &dir_search_callbk, &dm_args);
 	} else {
@@ -4,3 +4,8 @@
 #include "math-index.h"
 #include "subpath-set.h"
 #include "math-posting.h"
+#include "math-posting-blk.h"
+#include "math-posting-skip.h"
+#include "wr-cache.h"
+#include "bulk-build.h"
+#include "packed.h"
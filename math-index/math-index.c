@@ -26,22 +26,86 @@ math_index_open(const char *path, enum math_index_open_opt open_opt)
 	sprintf(index->dir, "%s", path);
 
 	index->open_opt = open_opt;
+	index->wr_cache = NULL;
+	index->bulk = NULL;
+	index->packed = NULL;
+	index->cache_lookup = NULL;
+	index->cache_arg = NULL;
 
 	if (open_opt == MATH_INDEX_WRITE) {
 		mkdir_p(path);
 		return index;
 
-	} else if (open_opt == MATH_INDEX_READ_ONLY) {
-		if (dir_exists(path))
+	} else if (open_opt == MATH_INDEX_WRITE_BUFFERED) {
+		mkdir_p(path);
+		index->wr_cache = math_wr_cache_new();
+		return index;
+
+	} else if (open_opt == MATH_INDEX_WRITE_BULK) {
+		mkdir_p(path);
+		index->bulk = math_bulk_new(path);
+		return index;
+
+	} else if (open_opt == MATH_INDEX_READ_ONLY ||
+	           open_opt == MATH_INDEX_READ_TRIE) {
+		if (dir_exists(path)) {
+			/* use packed index if there is one */
+			index->packed = math_packed_open(path);
+
+			if (open_opt == MATH_INDEX_READ_TRIE)
+				math_index_scan_trie(index);
 			return index;
+		}
 	}
 
 	free(index);
 	return NULL;
 }
 
+int math_index_scan_trie(math_index_t index)
+{
+	if (index->open_opt != MATH_INDEX_READ_ONLY &&
+	    index->open_opt != MATH_INDEX_READ_TRIE)
+		return 1;
+
+	/* directory merge then walks the trie instead of directories,
+	 * paths added after scanning are not seen */
+	if (index->packed == NULL)
+		index->packed = math_packed_scan(index->dir);
+
+	return (index->packed == NULL);
+}
+
+void math_index_set_cache(math_index_t index, math_cache_lookup_fn fun,
+                          void *arg)
+{
+	index->cache_lookup = fun;
+	index->cache_arg = arg;
+}
+
+int math_index_flush(math_index_t index)
+{
+	if (index->wr_cache)
+		return math_wr_cache_flush(index->wr_cache);
+	else if (index->bulk)
+		return math_bulk_finish(index->bulk);
+
+	return 0;
+}
+
 void math_index_close(math_index_t index)
 {
+	if (index->wr_cache)
+		math_wr_cache_free(index->wr_cache);
+
+	if (index->bulk) {
+		math_bulk_finish(index->bulk);
+		math_bulk_free(index->bulk);
+	}
+
+	if (index->packed)
+		math_packed_close(index->packed);
+
 	free(index);
 }
 
@@ -101,12 +165,21 @@ math_index_mk_path_str(struct subpath *sp, char *dest_path)
  * ================ */
 
 static int
-write_pathinfo_payload(const char *path, struct math_pathinfo *pathinfo)
+write_pathinfo_payload(math_index_t index, const char *path,
+                       struct math_pathinfo *pathinfo)
 {
 	FILE *fh;
 	char file_path[MAX_DIR_PATH_NAME_LEN];
 	sprintf(file_path, "%s/" PATH_INFO_FNAME, path);
 
+	if (index->wr_cache)
+		return math_wr_cache_append(index->wr_cache, path,
+		                            MATH_WR_FILE_PATHINFO, pathinfo,
+		                            sizeof(struct math_pathinfo));
+	else if (index->bulk)
+		return math_bulk_add(index->bulk, path, MATH_WR_FILE_PATHINFO,
+		                     pathinfo, sizeof(struct math_pathinfo));
+
 	fh = fopen(file_path, "a");
 	if (fh == NULL)
 		return -1;
@@ -118,12 +191,23 @@ write_pathinfo_payload(const char *path, struct math_pathinfo *pathinfo)
 }
 
 static void
-write_pathinfo_head(const char *path, struct math_pathinfo_pack* pack)
+write_pathinfo_head(math_index_t index, const char *path,
+                    struct math_pathinfo_pack* pack)
 {
 	FILE *fh;
 	char file_path[MAX_DIR_PATH_NAME_LEN];
 	sprintf(file_path, "%s/" PATH_INFO_FNAME, path);
 
+	if (index->wr_cache) {
+		math_wr_cache_append(index->wr_cache, path, MATH_WR_FILE_PATHINFO,
+		                     pack, sizeof(struct math_pathinfo_pack));
+		return;
+	} else if (index->bulk) {
+		math_bulk_add(index->bulk, path, MATH_WR_FILE_PATHINFO,
+		              pack, sizeof(struct math_pathinfo_pack));
+		return;
+	}
+
 	fh = fopen(file_path, "a");
 	if (fh == NULL)
 		return;
@@ -133,12 +217,32 @@ write_pathinfo_head(const char *path, struct math_pathinfo_pack* pack)
 }
 
 static int
-wirte_posting_item(const char *path, struct math_posting_item *po_item)
+wirte_posting_item(math_index_t index, const char *path,
+                   struct math_posting_item *po_item)
 {
 	FILE *fh;
 	char file_path[MAX_DIR_PATH_NAME_LEN];
+	char blk_path[MAX_DIR_PATH_NAME_LEN];
 	sprintf(file_path, "%s/" MATH_POSTING_FNAME, path);
 
+	if (index->wr_cache)
+		return math_wr_cache_append(index->wr_cache, path,
+		                            MATH_WR_FILE_POSTING, po_item,
+		                            sizeof(struct math_posting_item));
+	else if (index->bulk)
+		/* pathinfo_pos is fixed up when runs are merged */
+		return math_bulk_add(index->bulk, path, MATH_WR_FILE_POSTING,
+		                     po_item, sizeof(struct math_posting_item));
+
+	/* plain writer only appends raw items, which must not be mixed
+	 * with a block posting file (readers would ignore the blocks) */
+	sprintf(blk_path, "%s/" MATH_POSTING_BLK_FNAME, path);
+	if (file_exists(blk_path)) {
+		fprintf(stderr, "cannot append raw posting item to %s\n",
+		        blk_path);
+		return -1;
+	}
+
 	fh = fopen(file_path, "a");
 	if (fh == NULL)
 		return -1;
@@ -173,20 +277,31 @@ static LIST_IT_CALLBK(path_index_step1)
 		LIST_GO_OVER;
 	}
 
-	mkdir_p(path);
+	if (arg->index->wr_cache)
+		/* creates directory for new entry */
+		math_wr_cache_get(arg->index->wr_cache, path);
+	else if (arg->index->bulk == NULL)
+		/* bulk builder creates directories upon merge */
+		mkdir_p(path);
 
 	subpath_set_add(&arg->subpath_set, sp);
 
 	LIST_GO_OVER;
 }
 
-static uint32_t pathinfo_len(const char *path)
+static uint32_t pathinfo_len(math_index_t index, const char *path)
 {
 	FILE *fh;
 	uint64_t ret;
 	char file_path[MAX_DIR_PATH_NAME_LEN];
 	sprintf(file_path, "%s/" PATH_INFO_FNAME, path);
 
+	if (index->wr_cache)
+		return (uint32_t)math_wr_cache_file_sz(index->wr_cache, path,
+		                                       MATH_WR_FILE_PATHINFO);
+	else if (index->bulk)
+		return 0; /* not known until merge */
+
 	fh = fopen(file_path, "r");
 	if (fh == NULL)
 		return 0;
@@ -217,12 +332,15 @@ static LIST_IT_CALLBK(path_index_step2)
 		/* wirte posting item */
 		po_item.doc_id = arg->docID;
 		po_item.exp_id = arg->expID;
-		po_item.pathinfo_pos = pathinfo_len(path);
+		po_item.pathinfo_pos = pathinfo_len(arg->index, path);
 #ifdef DEBUG_MATH_INDEX
 		printf("write item(docID=%u, expID=%u, pos=%u) @ %s.\n",
 		       po_item.doc_id, po_item.exp_id, po_item.pathinfo_pos, path);
 #endif
-		wirte_posting_item(path, &po_item);
+		if (0 != wirte_posting_item(arg->index, path, &po_item)) {
+			fprintf(stderr, "cannot write posting item @%s\n", path);
+			LIST_GO_OVER;
+		}
 
 		/* wirte pathinfo head */
 		pathinfo_hd.n_paths = ele->dup_cnt + 1;
@@ -231,7 +349,7 @@ static LIST_IT_CALLBK(path_index_step2)
 		printf("write pathinfo head(n_paths=%u, n_lr_paths=%u) @ %s.\n",
 		       pathinfo_hd.n_paths, pathinfo_hd.n_lr_paths, path);
 #endif
-		write_pathinfo_head(path, &pathinfo_hd);
+		write_pathinfo_head(arg->index, path, &pathinfo_hd);
 	}
 
 	LIST_GO_OVER;
@@ -254,7 +372,7 @@ static LIST_IT_CALLBK(path_index_step3)
 	printf("write pathinfo item(pathID=%u, ge_hash/symbol=%x) @ %s.\n",
 	       info.path_id, info.lf_symb, path);
 #endif
-	if (0 != write_pathinfo_payload(path, &info)) {
+	if (0 != write_pathinfo_payload(arg->index, path, &info)) {
 		fprintf(stderr, "cannot write path info @%s\n", path);
 		LIST_GO_OVER;
 	}
@@ -312,6 +430,111 @@ math_index_add_tex(math_index_t index, doc_id_t docID,
 	return 0;
 }
 
+/* ============================
+ * append another math index
+ * ============================ */
+
+static int
+append_posting(math_index_t index, const char *path, math_posting_t po,
+               const doc_id_t *doc_map, uint32_t docN)
+{
+	struct math_posting_item  *item, new_item;
+	struct math_pathinfo_pack *pack;
+	uint32_t i;
+
+	if (!math_posting_start(po)) {
+		math_posting_finish(po);
+		return 0; /* empty list */
+	}
+
+	if (index->wr_cache)
+		math_wr_cache_get(index->wr_cache, path);
+	else if (index->bulk == NULL)
+		mkdir_p(path);
+
+	do {
+		item = math_posting_current(po);
+		pack = math_posting_pathinfo(po, item->pathinfo_pos);
+		if (pack == NULL) {
+			fprintf(stderr, "cannot read path info @%s\n", path);
+			math_posting_finish(po);
+			return 1;
+		}
+
+		if (item->doc_id > docN) {
+			fprintf(stderr, "doc#%u out of range (docN=%u) @%s\n",
+			        item->doc_id, docN, path);
+			math_posting_finish(po);
+			return 1;
+		}
+
+		new_item = *item;
+		new_item.doc_id = doc_map[item->doc_id];
+		new_item.pathinfo_pos = pathinfo_len(index, path);
+
+		if (0 != wirte_posting_item(index, path, &new_item)) {
+			fprintf(stderr, "cannot write posting item @%s\n", path);
+			math_posting_finish(po);
+			return 1;
+		}
+
+		write_pathinfo_head(index, path, pack);
+
+		for (i = 0; i < pack->n_paths; i++)
+			write_pathinfo_payload(index, path, pack->pathinfo + i);
+
+	} while (math_posting_next(po));
+
+	math_posting_finish(po);
+	return 0;
+}
+
+int
+math_index_append_index(math_index_t index, math_index_t src,
+                        const doc_id_t *doc_map, uint32_t docN)
+{
+	struct math_packed *dict = src->packed;
+	char relpath[MAX_DIR_PATH_NAME_LEN];
+	char src_path[MAX_DIR_PATH_NAME_LEN];
+	char dst_path[MAX_DIR_PATH_NAME_LEN];
+	math_posting_t po;
+	uint32_t id;
+	int ret = 0;
+
+	/* lists to append are found by a path dictionary */
+	if (dict == NULL) {
+		if (math_index_scan_trie(src)) {
+			fprintf(stderr, "no path dictionary @%s\n", src->dir);
+			return 1;
+		}
+		dict = src->packed;
+	}
+
+	/* posting lists are visited in BFS order of path dictionary */
+	for (id = 0; id < dict->n_nodes && ret == 0; id++) {
+		if (dict->nodes[id].posting_sz == 0)
+			continue;
+
+		math_packed_path(dict, 0, id, relpath);
+		if (sizeof(src_path) <= snprintf(src_path, sizeof(src_path),
+		                                 "%s%s", src->dir, relpath) ||
+		    sizeof(dst_path) <= snprintf(dst_path, sizeof(dst_path),
+		                                 "%s%s", index->dir, relpath)) {
+			fprintf(stderr, "path too long: %s\n", relpath);
+			ret = 1;
+			break;
+		}
+
+		po = math_posting_new_reader(NULL, src_path);
+		math_packed_set_reader(dict, id, po);
+
+		ret = append_posting(index, dst_path, po, doc_map, docN);
+		math_posting_free_reader(po);
+	}
+
+	return ret;
+}
+
 /* ===============================
  * probe math index posting list
  * =============================== */
@@ -20,12 +20,31 @@ typedef position_t exp_id_t;
  * =================== */
 enum math_index_open_opt {
 	MATH_INDEX_READ_ONLY,
-	MATH_INDEX_WRITE
+	MATH_INDEX_READ_TRIE,      /* read-only, scan path directories
+	                            * (if not packed) into a path trie */
+	MATH_INDEX_WRITE,
+	MATH_INDEX_WRITE_BUFFERED, /* write through math_wr_cache */
+	MATH_INDEX_WRITE_BULK      /* sort-based rebuild, see bulk-build.h */
 };
 
+struct math_wr_cache;
+struct math_bulk_builder;
+struct math_packed;
+
+/* posting cache look-up hook: given a path relative to math index
+ * directory, let the reader (second argument) read the cached list
+ * and return true, or return false if the path is not cached. */
+typedef bool (*math_cache_lookup_fn)(const char*, void*, void*);
+
 typedef struct math_index {
 	enum math_index_open_opt open_opt;
 	char dir[MAX_DIR_PATH_NAME_LEN];
+	struct math_wr_cache *wr_cache; /* NULL if not buffered */
+	struct math_bulk_builder *bulk; /* NULL if not bulk */
+	struct math_packed *packed;     /* path dictionary, packed index
+	                                 * or in-memory path trie */
+	math_cache_lookup_fn cache_lookup; /* NULL if no cache */
+	void                *cache_arg;
 } *math_index_t;
 
 math_index_t
@@ -37,6 +56,25 @@ bool math_index_mk_path_str(struct subpath*, char*);
 
 int math_inex_probe(const char*, bool, FILE*); /* mainly for debug */
 
+/* scan path directories of a read-only math index (if not packed) into
+ * a path trie, as MATH_INDEX_READ_TRIE does. Return 0 on success. */
+int math_index_scan_trie(math_index_t);
+
+/* append all posting lists of another (read-only) math index, doc IDs
+ * are mapped by an array indexed by source doc ID (up to the last
+ * argument, greater IDs fail the append). Return 0 on success.
+ * Lists of the source are appended after existing items, so mapped doc
+ * IDs should be greater than those already indexed. */
+int math_index_append_index(math_index_t, math_index_t, const doc_id_t*,
+                            uint32_t);
+
+/* set posting cache look-up hook used by directory merge */
+void math_index_set_cache(math_index_t, math_cache_lookup_fn, void*);
+
+/* write out buffered data (for buffered and bulk write modes), return
+ * non-zero on write failure. */
+int math_index_flush(math_index_t);
+
 void math_index_close(math_index_t);
 
 /* ==================
@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec/codec.h"
+#include "dir-util/dir-util.h"
+#include "head.h"
+
+size_t math_posting_blk_pack_sz(const void *pack_)
+{
+	const struct math_pathinfo_pack *pack = pack_;
+
+	if (pack->n_paths > MAX_MATH_PATHS)
+		return 0;
+
+	return sizeof(struct math_pathinfo_pack) +
+	       pack->n_paths * sizeof(struct math_pathinfo);
+}
+
+size_t
+math_posting_blk_encode(const struct math_posting_item *items, uint32_t n,
+                        const char *pinfo, void *out)
+{
+	uint32_t i;
+	size_t pack_sz;
+	uint32_t doc[MATH_POSTING_BLK_ITEMS];
+	uint32_t exp[MATH_POSTING_BLK_ITEMS];
+	uint32_t pos[MATH_POSTING_BLK_ITEMS];
+
+	struct for_delta_args args;
+	struct codec delta_codec = {CODEC_FOR_DELTA, &args};
+	struct codec for_codec = {CODEC_FOR, &args};
+
+	struct math_posting_blk_head *head = out;
+	char *payload = (char*)(head + 1);
+
+	if (n == 0 || n > MATH_POSTING_BLK_ITEMS)
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		doc[i] = items[i].doc_id;
+		pos[i] = items[i].pathinfo_pos;
+
+		if (i != 0 && items[i].doc_id == items[i - 1].doc_id)
+			exp[i] = items[i].exp_id - items[i - 1].exp_id;
+		else
+			exp[i] = items[i].exp_id;
+	}
+
+	head->n_items = n;
+	head->flags = 0;
+	head->max_id = *(uint64_t*)(items + n - 1);
+
+	head->sz = codec_compress_ints(&delta_codec, doc, n, payload);
+	head->sz += codec_compress_ints(&for_codec, exp, n, payload + head->sz);
+
+	if (pinfo == NULL) {
+		head->sz += codec_compress_ints(&delta_codec, pos, n,
+		                                payload + head->sz);
+		return sizeof(struct math_posting_blk_head) + head->sz;
+	}
+
+	/* inline pathinfo packs in place of pathinfo_pos stream */
+	head->flags |= MATH_POSTING_BLK_INLINE_PATHINFO;
+
+	for (i = 0; i < n; i++) {
+		pack_sz = math_posting_blk_pack_sz(pinfo + pos[i]);
+		if (pack_sz == 0)
+			return 0;
+
+		memcpy(payload + head->sz, pinfo + pos[i], pack_sz);
+		head->sz += pack_sz;
+	}
+
+	return sizeof(struct math_posting_blk_head) + head->sz;
+}
+
+size_t
+math_posting_blk_decode(const struct math_posting_blk_head *head,
+                        const void *payload, struct math_posting_item *items)
+{
+	uint32_t i, n = head->n_items;
+	uint32_t doc[MATH_POSTING_BLK_ITEMS];
+	uint32_t exp[MATH_POSTING_BLK_ITEMS];
+	uint32_t pos[MATH_POSTING_BLK_ITEMS];
+	size_t sz, pack_sz;
+
+	struct for_delta_args args;
+	struct codec delta_codec = {CODEC_FOR_DELTA, &args};
+	struct codec for_codec = {CODEC_FOR, &args};
+	const char *p = payload;
+
+	if (n == 0 || n > MATH_POSTING_BLK_ITEMS)
+		return 0;
+
+	sz = codec_decompress_ints(&delta_codec, p, doc, n);
+	sz += codec_decompress_ints(&for_codec, p + sz, exp, n);
+
+	if (head->flags & MATH_POSTING_BLK_INLINE_PATHINFO) {
+		/* positions are pack offsets within payload */
+		for (i = 0; i < n; i++) {
+			if (sz + sizeof(struct math_pathinfo_pack) > head->sz)
+				return 0;
+
+			pack_sz = math_posting_blk_pack_sz(p + sz);
+			if (pack_sz == 0)
+				return 0;
+
+			pos[i] = sz;
+			sz += pack_sz;
+		}
+	} else {
+		sz += codec_decompress_ints(&delta_codec, p + sz, pos, n);
+	}
+
+	if (sz != head->sz)
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		items[i].doc_id = doc[i];
+		items[i].pathinfo_pos = pos[i];
+
+		if (i != 0 && doc[i] == doc[i - 1])
+			items[i].exp_id = items[i - 1].exp_id + exp[i];
+		else
+			items[i].exp_id = exp[i];
+	}
+
+	return sz;
+}
+
+int math_posting_blk_write(FILE *fh, FILE *skp_fh,
+                           const struct math_posting_item *items,
+                           uint32_t n, const char *pinfo, uint64_t *offset)
+{
+	int ret = 0;
+	uint32_t i, blk_n;
+	size_t sz;
+	char *blk = malloc(sizeof(struct math_posting_blk_head) +
+	                   MATH_POSTING_BLK_MAX_SZ);
+	struct math_posting_blk_head *head = (struct math_posting_blk_head*)blk;
+	struct math_posting_skip skip;
+
+	for (i = 0; i < n; i += blk_n) {
+		blk_n = n - i;
+		if (blk_n > MATH_POSTING_BLK_ITEMS)
+			blk_n = MATH_POSTING_BLK_ITEMS;
+
+		sz = math_posting_blk_encode(items + i, blk_n, pinfo, blk);
+		if (sz == 0 || sz != fwrite(blk, 1, sz, fh)) {
+			ret = -1;
+			break;
+		}
+
+		if (skp_fh) {
+			skip.max_id = head->max_id;
+			skip.offset = *offset;
+			fwrite(&skip, 1, sizeof(struct math_posting_skip), skp_fh);
+		}
+
+		*offset += sz;
+	}
+
+	free(blk);
+	return ret;
+}
+
+bool math_posting_blk_writable(const char *path)
+{
+#ifdef MATH_POSTING_BLK_WRITE
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	sprintf(file_path, "%s/" MATH_POSTING_FNAME, path);
+
+	/* do not mix formats, keep appending to a raw posting file */
+	return !file_exists(file_path);
+#else
+	return 0;
+#endif
+}
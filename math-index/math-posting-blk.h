@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/*
+ * block-compressed math posting list: a sequence of blocks, each is
+ * a head followed by `sz' bytes of payload, which is three codec
+ * streams of `n_items' integers:
+ *
+ * docIDs       (FOR delta),
+ * expIDs       (FOR, delta from previous item of the same doc),
+ * pathinfo_pos (FOR delta).
+ *
+ * If MATH_POSTING_BLK_INLINE_PATHINFO is set in flags, the third
+ * stream is replaced by the pathinfo packs of all items concatenated
+ * in order, so that scorer gets pathinfo in the same sequential read.
+ * Decoded pathinfo_pos is then the pack offset within the payload.
+ */
+#pragma pack(push, 1)
+struct math_posting_blk_head {
+	uint16_t n_items;
+	uint16_t flags;
+	uint32_t sz;     /* payload bytes following this head */
+	uint64_t max_id; /* 64-bit ID of the last item in this block */
+};
+#pragma pack(pop)
+
+#define MATH_POSTING_BLK_INLINE_PATHINFO 0x1
+
+/* worst-case payload size, see FOR/FOR-delta header sizes */
+#define MATH_POSTING_BLK_MAX_PACK_SZ \
+	(sizeof(struct math_pathinfo_pack) + \
+	 MAX_MATH_PATHS * sizeof(struct math_pathinfo))
+
+#define MATH_POSTING_BLK_MAX_SZ \
+	(3 * (sizeof(uint32_t) + sizeof(uint8_t) + \
+	      MATH_POSTING_BLK_ITEMS * sizeof(uint32_t)) + \
+	 MATH_POSTING_BLK_ITEMS * MATH_POSTING_BLK_MAX_PACK_SZ)
+
+/* encode `n' (at most MATH_POSTING_BLK_ITEMS) items into a block
+ * (head included), return the total block size in bytes. If pathinfo
+ * area (the third argument) is not NULL, pathinfo_pos of items are
+ * offsets of their packs in this area and packs are inlined. */
+size_t
+math_posting_blk_encode(const struct math_posting_item*, uint32_t,
+                        const char*, void*);
+
+/* decode block payload, return payload bytes consumed (0 on error) */
+size_t
+math_posting_blk_decode(const struct math_posting_blk_head*, const void*,
+                        struct math_posting_item*);
+
+/* write `n' items as blocks at file offset `*offset' (advanced after
+ * write), a skip entry for each block is written to the second file
+ * if it is not NULL. Pathinfo area is passed to encode function.
+ * Return 0 on success. */
+int math_posting_blk_write(FILE*, FILE*, const struct math_posting_item*,
+                           uint32_t, const char*, uint64_t*);
+
+/* whether writers should create block-compressed posting at a path */
+bool math_posting_blk_writable(const char*);
+
+/* size of a pathinfo pack, 0 if it is not sane */
+size_t math_posting_blk_pack_sz(const void*);
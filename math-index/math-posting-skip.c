@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "dir-util/dir-util.h"
+#include "head.h"
+
+static uint64_t file_size(const char *path, const char *fname)
+{
+	struct stat s;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	sprintf(file_path, "%s/%s", path, fname);
+
+	if (0 == stat(file_path, &s))
+		return (uint64_t)s.st_size;
+	else
+		return 0;
+}
+
+bool math_posting_skip_writable(const char *path, bool blk)
+{
+	uint64_t posting_sz, skip_sz;
+
+	skip_sz = file_size(path, MATH_POSTING_SKP_FNAME);
+	if (skip_sz % sizeof(struct math_posting_skip))
+		return 0;
+
+	if (blk) {
+		/* every block has an entry */
+		posting_sz = file_size(path, MATH_POSTING_BLK_FNAME);
+		return (posting_sz == 0) == (skip_sz == 0);
+	} else {
+		/* every full read chunk has an entry */
+		posting_sz = file_size(path, MATH_POSTING_FNAME);
+		return (posting_sz / MATH_POSTING_SKIP_RAW_BYTES ==
+		        skip_sz / sizeof(struct math_posting_skip));
+	}
+}
+
+struct math_posting_skip *
+math_posting_skip_load(const char *path, uint32_t *n)
+{
+	FILE *fh;
+	uint64_t sz;
+	struct math_posting_skip *skip;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	sprintf(file_path, "%s/" MATH_POSTING_SKP_FNAME, path);
+
+	sz = file_size(path, MATH_POSTING_SKP_FNAME);
+	*n = sz / sizeof(struct math_posting_skip);
+
+	if (*n == 0 || NULL == (fh = fopen(file_path, "r")))
+		return NULL;
+
+	skip = malloc(*n * sizeof(struct math_posting_skip));
+	if (*n != fread(skip, sizeof(struct math_posting_skip), *n, fh)) {
+		free(skip);
+		skip = NULL;
+	}
+
+	fclose(fh);
+	return skip;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * math posting skip table: a side file listing, for every read chunk
+ * of a raw posting file (or every block of a block-compressed one),
+ * the ID of its last item and its offset in posting file. It lets
+ * math_posting_jump() seek directly to the chunk containing target.
+ */
+#pragma pack(push, 1)
+struct math_posting_skip {
+	uint64_t max_id;
+	uint64_t offset;
+};
+#pragma pack(pop)
+
+/* items covered by one skip entry in raw posting file (a read chunk) */
+#define MATH_POSTING_SKIP_RAW_ITEMS \
+	((DISK_BLCK_SIZE * DISK_RD_BLOCKS) / sizeof(struct math_posting_item))
+
+#define MATH_POSTING_SKIP_RAW_BYTES \
+	(MATH_POSTING_SKIP_RAW_ITEMS * sizeof(struct math_posting_item))
+
+/* whether the skip table at a path is complete with respect to its
+ * posting file, so that writers can keep appending entries to it. */
+bool math_posting_skip_writable(const char*, bool /* block format */);
+
+/* load skip table of a path, return NULL if there is none */
+struct math_posting_skip *math_posting_skip_load(const char*, uint32_t*);
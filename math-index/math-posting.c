@@ -1,6 +1,11 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "head.h"
 
 #define DISK_RD_BUF_BYTES (DISK_BLCK_SIZE * DISK_RD_BLOCKS)
@@ -16,10 +21,47 @@ struct _math_posting {
 	const char *fullpath;
 	FILE  *fh_posting;
 	FILE  *fh_pathinfo;
+	bool   blk; /* block-compressed posting file */
 
 	/* read buffer */
 	uint32_t buf_idx, buf_end;
 	struct math_posting_item buf[DISK_RD_BUF_ITEMS];
+
+	/* items being iterated, points either to read buffer or
+	 * directly into a mapped raw posting file */
+	struct math_posting_item *items;
+
+	/* compressed block payload buffer (grows on demand) */
+	char    *blk_buf;
+	uint32_t blk_buf_sz;
+
+	/* payload of the buffered block (in blk_buf or mapped file),
+	 * and whether pathinfo is inlined in it */
+	const char *blk_payload;
+	uint32_t    blk_payload_sz;
+	bool        blk_inl;
+
+	/* memory-mapped files, NULL if they are read through stdio */
+	bool     mem; /* mapped by caller, see math_posting_set_mem() */
+	bool     fmt; /* format known, see math_posting_set_fmt() */
+	char    *map_posting;
+	char    *map_pathinfo;
+	size_t   map_posting_sz;
+	size_t   map_pathinfo_sz;
+	uint64_t map_off; /* read offset of mapped posting file */
+
+	/* pathinfo pack read from pathinfo file */
+#pragma pack(push, 1)
+	struct {
+		struct math_pathinfo_pack head;
+		struct math_pathinfo      info_arr[MAX_MATH_PATHS];
+	} pathinfo_buf;
+#pragma pack(pop)
+
+	/* skip table, loaded upon first jump */
+	bool     skip_loaded;
+	uint32_t n_skip;
+	struct math_posting_skip *skip;
 };
 
 static void print_cur_post_buf(struct _math_posting *po)
@@ -28,7 +70,7 @@ static void print_cur_post_buf(struct _math_posting *po)
 	struct math_posting_item *item;
 	printf("buf (idx=%u, end=%u): ", po->buf_idx, po->buf_end);
 	for (i = 0; i < po->buf_end; i++) {
-		item = po->buf + po->buf_idx;
+		item = po->items + po->buf_idx;
 		printf("[%u]", i);
 		if (i == po->buf_idx)
 			printf("{doc%u,exp%u} ", item->doc_id, item->exp_id);
@@ -48,6 +90,23 @@ math_posting_new_reader(struct subpath_ele *ele, const char *fullpath)
 	po->fullpath = fullpath;
 	po->fh_posting = NULL;
 	po->fh_pathinfo = NULL;
+	po->blk = 0;
+	po->items = po->buf;
+	po->blk_buf = NULL;
+	po->blk_buf_sz = 0;
+	po->blk_payload = NULL;
+	po->blk_payload_sz = 0;
+	po->blk_inl = 0;
+	po->mem = 0;
+	po->fmt = 0;
+	po->map_posting = NULL;
+	po->map_pathinfo = NULL;
+	po->map_posting_sz = 0;
+	po->map_pathinfo_sz = 0;
+	po->map_off = 0;
+	po->skip_loaded = 0;
+	po->n_skip = 0;
+	po->skip = NULL;
 	po->buf_idx = 0;
 	po->buf_end = 0;
 
@@ -63,6 +122,9 @@ math_posting_new_reader(struct subpath_ele *ele, const char *fullpath)
 	 * structure is a factor of DISK_BLCK_SIZE */
 	assert(DISK_RD_BUF_RMNDR == 0);
 
+	/* a decoded block must fit in read buffer */
+	assert(MATH_POSTING_BLK_ITEMS <= DISK_RD_BUF_ITEMS);
+
 	return po;
 }
 
@@ -80,6 +142,9 @@ const char *math_posting_get_pathstr(math_posting_t po_)
 
 void math_posting_free_reader(math_posting_t po_)
 {
+	struct _math_posting *po = (struct _math_posting*)po_;
+	free(po->skip);
+	free(po->blk_buf);
 	free(po_);
 }
 
@@ -92,6 +157,19 @@ void math_posting_finish(math_posting_t po_)
 
 	if (po->fh_pathinfo)
 		fclose(po->fh_pathinfo);
+
+	if (po->map_posting && !po->mem)
+		munmap(po->map_posting, po->map_posting_sz);
+
+	if (po->map_pathinfo && !po->mem)
+		munmap(po->map_pathinfo, po->map_pathinfo_sz);
+
+	po->fh_posting = po->fh_pathinfo = NULL;
+	po->map_posting = po->map_pathinfo = NULL;
+
+	free(po->skip);
+	po->skip = NULL;
+	po->skip_loaded = 0;
 }
 
 static __inline size_t
@@ -104,27 +182,249 @@ rebuf(void *buf, FILE *fh, uint32_t *idx, uint32_t *end)
 	return nread;
 }
 
+/* a mapped raw posting is viewed as a whole, no copy is made */
+static size_t map_rebuf(struct _math_posting *po)
+{
+	po->items = (struct math_posting_item*)(po->map_posting + po->map_off);
+	po->buf_idx = 0;
+	po->buf_end = (po->map_posting_sz - po->map_off) /
+	              sizeof(struct math_posting_item);
+	po->map_off += po->buf_end * sizeof(struct math_posting_item);
+	return po->buf_end;
+}
+
+static __inline uint64_t po_tell(struct _math_posting *po)
+{
+	if (po->map_posting)
+		return po->map_off;
+	else
+		return ftell(po->fh_posting);
+}
+
+static __inline void po_seek(struct _math_posting *po, uint64_t off)
+{
+	if (po->map_posting)
+		po->map_off = off;
+	else
+		fseek(po->fh_posting, off, SEEK_SET);
+}
+
+static bool blk_read_head(struct _math_posting *po,
+                          struct math_posting_blk_head *head)
+{
+	if (po->map_posting == NULL)
+		return (1 == fread(head, sizeof(*head), 1, po->fh_posting));
+
+	if (po->map_off + sizeof(*head) > po->map_posting_sz)
+		return 0;
+
+	memcpy(head, po->map_posting + po->map_off, sizeof(*head));
+	po->map_off += sizeof(*head);
+	return 1;
+}
+
+/* return block payload of `sz' bytes, NULL on failure */
+static const char *blk_read_payload(struct _math_posting *po, uint32_t sz)
+{
+	const char *payload;
+
+	if (po->map_posting) {
+		if (po->map_off + sz > po->map_posting_sz)
+			return NULL;
+
+		payload = po->map_posting + po->map_off;
+		po->map_off += sz;
+		return payload;
+	}
+
+	if (sz > po->blk_buf_sz) {
+		po->blk_buf = realloc(po->blk_buf, sz);
+		po->blk_buf_sz = sz;
+	}
+
+	if (sz != fread(po->blk_buf, 1, sz, po->fh_posting))
+		return NULL;
+
+	return po->blk_buf;
+}
+
+/*
+ * read and decode the next block whose max ID is not less than
+ * `target', blocks before it are skipped without decoding.
+ */
+static size_t blk_rebuf(struct _math_posting *po, uint64_t target)
+{
+	struct math_posting_blk_head head;
+	const char *payload;
+
+	po->buf_idx = 0;
+	po->buf_end = 0;
+	po->blk_inl = 0;
+
+	while (blk_read_head(po, &head)) {
+		if (head.n_items > MATH_POSTING_BLK_ITEMS ||
+		    head.sz > MATH_POSTING_BLK_MAX_SZ) {
+			fprintf(stderr, "corrupted posting block @ %s\n",
+			        po->fullpath);
+			break;
+		}
+
+		if (head.max_id < target) {
+			po_seek(po, po_tell(po) + head.sz);
+			continue;
+		}
+
+		payload = blk_read_payload(po, head.sz);
+		if (payload == NULL ||
+		    0 == math_posting_blk_decode(&head, payload, po->buf))
+			break;
+
+		po->buf_end = head.n_items;
+		po->blk_payload = payload;
+		po->blk_payload_sz = head.sz;
+		po->blk_inl = !!(head.flags & MATH_POSTING_BLK_INLINE_PATHINFO);
+		break;
+	}
+
+	return po->buf_end;
+}
+
+static __inline size_t po_rebuf(struct _math_posting *po, uint64_t target)
+{
+	if (po->blk)
+		return blk_rebuf(po, target);
+	else if (po->map_posting)
+		return map_rebuf(po);
+	else
+		return rebuf(po->buf, po->fh_posting, &po->buf_idx, &po->buf_end);
+}
+
+#ifdef MATH_POSTING_MMAP
+/* map a whole file read-only, NULL if it is missing, empty or too
+ * small to be worth mapping. */
+static char *map_file(const char *path, size_t *sz, int advice)
+{
+	int fd;
+	struct stat st;
+	char *p;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return NULL;
+
+	if (0 != fstat(fd, &st) || st.st_size == 0 ||
+	    st.st_size < MATH_POSTING_MMAP_MIN_SZ) {
+		close(fd);
+		return NULL;
+	}
+
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (p == MAP_FAILED)
+		return NULL;
+
+	madvise(p, st.st_size, advice);
+	*sz = st.st_size;
+	return p;
+}
+#endif
+
+static bool open_posting(struct _math_posting *po, const char *path)
+{
+#ifdef MATH_POSTING_MMAP
+	po->map_posting = map_file(path, &po->map_posting_sz, MADV_SEQUENTIAL);
+	if (po->map_posting) {
+		po->map_off = 0;
+		return 1;
+	}
+#endif
+	po->fh_posting = fopen(path, "r");
+	return (po->fh_posting != NULL);
+}
+
+static bool open_pathinfo(struct _math_posting *po, const char *path)
+{
+#ifdef MATH_POSTING_MMAP
+	po->map_pathinfo = map_file(path, &po->map_pathinfo_sz, MADV_WILLNEED);
+	if (po->map_pathinfo)
+		return 1;
+#endif
+	po->fh_pathinfo = fopen(path, "r");
+	return (po->fh_pathinfo != NULL);
+}
+
 bool math_posting_start(math_posting_t po_)
 {
 	struct _math_posting *po = (struct _math_posting*)po_;
 
+	bool has_posting, has_pathinfo;
 	char file_path[MAX_DIR_PATH_NAME_LEN];
 
-	sprintf(file_path, "%s/" MATH_POSTING_FNAME, po->fullpath);
-	po->fh_posting = fopen(file_path, "r");
+	if (po->mem) {
+		if (po->map_posting == NULL)
+			return 0;
+
+		po_rebuf(po, 0);
+		return 1;
+	}
+
+	if (po->fmt) {
+		/* only open the posting file of known format */
+		sprintf(file_path, "%s/%s", po->fullpath, (po->blk) ?
+		        MATH_POSTING_BLK_FNAME : MATH_POSTING_FNAME);
+		has_posting = open_posting(po, file_path);
+	} else {
+		sprintf(file_path, "%s/" MATH_POSTING_FNAME, po->fullpath);
+		has_posting = open_posting(po, file_path);
+
+		if (!has_posting) {
+			/* try block-compressed posting file */
+			sprintf(file_path, "%s/" MATH_POSTING_BLK_FNAME,
+			        po->fullpath);
+			has_posting = open_posting(po, file_path);
+			po->blk = 1;
+		}
+	}
 
 	sprintf(file_path, "%s/" PATH_INFO_FNAME, po->fullpath);
-	po->fh_pathinfo = fopen(file_path, "r");
+	has_pathinfo = open_pathinfo(po, file_path);
 
-	if (NULL == po->fh_posting || NULL == po->fh_pathinfo)
+	/* pathinfo file is optional if blocks have pathinfo inlined */
+	if (!has_posting || (!po->blk && !has_pathinfo))
 		return 0;
 
 	/* start function is required to read the first item */
-	rebuf(po->buf, po->fh_posting, &po->buf_idx, &po->buf_end);
+	po_rebuf(po, 0);
 
 	return 1;
 }
 
+void math_posting_set_fmt(math_posting_t po_, bool blk)
+{
+	struct _math_posting *po = (struct _math_posting*)po_;
+
+	po->fmt = 1;
+	po->blk = blk;
+}
+
+void math_posting_set_mem(math_posting_t po_, bool blk,
+                          const void *posting, size_t posting_sz,
+                          const void *pathinfo, size_t pathinfo_sz)
+{
+	struct _math_posting *po = (struct _math_posting*)po_;
+
+	po->mem = 1;
+	po->blk = blk;
+	po->map_posting = (posting_sz) ? (char*)posting : NULL;
+	po->map_posting_sz = posting_sz;
+	po->map_pathinfo = (pathinfo_sz) ? (char*)pathinfo : NULL;
+	po->map_pathinfo_sz = pathinfo_sz;
+	po->map_off = 0;
+
+	/* no skip table for in-memory lists */
+	po->skip_loaded = 1;
+}
+
 bool math_posting_next(math_posting_t po_)
 {
 	struct _math_posting *po = (struct _math_posting*)po_;
@@ -137,7 +437,7 @@ bool math_posting_next(math_posting_t po_)
 			return 1;
 		else
 			/* need one read to tell whether or not I can go further */
-			rebuf(po->buf, po->fh_posting, &po->buf_idx, &po->buf_end);
+			po_rebuf(po, 0);
 
 	} while (po->buf_end != 0);
 
@@ -145,85 +445,159 @@ bool math_posting_next(math_posting_t po_)
 	return 0;
 }
 
+/*
+ * use skip table to seek to the chunk (or block) which may contain
+ * target and read it into buffer. Return 0 if no read is performed,
+ * in which case caller should continue reading sequentially.
+ */
+static bool skip_to(struct _math_posting *po, uint64_t target)
+{
+	uint32_t lo, hi, mid;
+	uint64_t off;
+
+	if (!po->skip_loaded) {
+		po->skip = math_posting_skip_load(po->fullpath, &po->n_skip);
+		po->skip_loaded = 1;
+	}
+
+	if (po->skip == NULL)
+		return 0;
+
+	/* binary search the first chunk whose max ID >= target */
+	lo = 0;
+	hi = po->n_skip;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (po->skip[mid].max_id < target)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < po->n_skip)
+		off = po->skip[lo].offset;
+	else if (po->blk)
+		/* scan blocks following the last indexed one */
+		off = po->skip[po->n_skip - 1].offset;
+	else
+		/* scan the tail which is not a full chunk */
+		off = po->n_skip * MATH_POSTING_SKIP_RAW_BYTES;
+
+	/* never go backward */
+	if (off < po_tell(po))
+		return 0;
+
+	po_seek(po, off);
+	po_rebuf(po, target);
+	return 1;
+}
+
 bool math_posting_jump(math_posting_t po_, uint64_t target)
 {
 	uint32_t rightmost; /* right most of the buffer */
+	uint32_t lo, hi, mid;
 	uint64_t *id64;
 	struct _math_posting *po = (struct _math_posting*)po_;
 
 	do {
 		rightmost = po->buf_end - 1;
-		id64 = (uint64_t*)(po->buf + rightmost);
+		id64 = (uint64_t*)(po->items + rightmost);
 
 		if (po->buf_end == 0) {
 			return 0; /* no more to read, failed at finding target */
 		} else if (target <= *id64) {
 			/* find that target is in this buffer */
 			break;
-		} else if (po->buf_end != DISK_RD_BUF_ITEMS) {
+		} else if (!po->blk && (po->map_posting ||
+		           po->buf_end != DISK_RD_BUF_ITEMS)) {
 			/* cannot read again, we have examined entire file. */
 			return 0; /* failed at finding target */
 		}
 
 		/* read into buffer */
-		rebuf(po->buf, po->fh_posting, &po->buf_idx, &po->buf_end);
+		if (!skip_to(po, target))
+			po_rebuf(po, target);
 	} while (1);
 
-	/* go through the buffer to find the target */
-	while (po->buf_idx < po->buf_end) {
-		id64 = (uint64_t*)(po->buf + po->buf_idx);
+	/* binary search the buffer for the first ID >= target */
+	lo = po->buf_idx;
+	hi = po->buf_end;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		id64 = (uint64_t*)(po->items + mid);
 
 		if (*id64 < target)
-			po->buf_idx ++; /* step forward */
+			lo = mid + 1;
 		else
-			break; /* we find an ID >= target */
+			hi = mid;
 	}
 
+	po->buf_idx = lo;
 	return 1;
 }
 
 struct math_posting_item* math_posting_current(math_posting_t po_)
 {
 	struct _math_posting *po = (struct _math_posting*)po_;
-	struct math_posting_item *item = po->buf + po->buf_idx;
+	struct math_posting_item *item = po->items + po->buf_idx;
 	// printf("math disk-item docID: %u\n", item->doc_id);
 	return item;
 }
 
+/* return the pack at `pos' of an in-memory pathinfo area */
+static struct math_pathinfo_pack *
+pack_at(const char *area, size_t area_sz, uint32_t pos)
+{
+	const struct math_pathinfo_pack *pack;
+	size_t pack_sz;
+
+	if (pos + sizeof(struct math_pathinfo_pack) > area_sz)
+		return NULL;
+
+	pack = (const struct math_pathinfo_pack*)(area + pos);
+	pack_sz = math_posting_blk_pack_sz(pack);
+
+	if (pack_sz == 0 || pos + pack_sz > area_sz)
+		return NULL;
+
+	return (struct math_pathinfo_pack*)pack;
+}
+
 struct math_pathinfo_pack*
 math_posting_pathinfo(math_posting_t po_, uint32_t position)
 {
-	pathinfo_num_t i;
 	struct _math_posting *po = (struct _math_posting*)po_;
+	struct math_pathinfo_pack *pack;
 
-#pragma pack(push, 1)
-	static struct {
-		struct math_pathinfo_pack head;
-		struct math_pathinfo      info_arr[MAX_MATH_PATHS];
-	} ret;
-#pragma pack(pop)
+	if (po->blk_inl)
+		/* position is pack offset within the buffered block */
+		return pack_at(po->blk_payload, po->blk_payload_sz, position);
+	else if (po->map_pathinfo)
+		return pack_at(po->map_pathinfo, po->map_pathinfo_sz, position);
+
+	if (po->fh_pathinfo == NULL)
+		return NULL;
 
 	/* first go the specified file & position */
 	if (-1 == fseek(po->fh_pathinfo, position, SEEK_SET))
 		return NULL;
 
-	if (1 == fread(&ret.head, sizeof(struct math_pathinfo_pack),
-				   1, po->fh_pathinfo)) {
-		/* check the sanity of n_paths */
-		if (ret.head.n_paths > MAX_MATH_PATHS)
-			return NULL;
+	pack = &po->pathinfo_buf.head;
+	if (1 != fread(pack, sizeof(struct math_pathinfo_pack),
+	               1, po->fh_pathinfo))
+		return NULL;
 
-		/* now, read all the path info items */
-		for (i = 0; i < ret.head.n_paths; i++) {
-			if (1 != fread(ret.info_arr + i, sizeof(struct math_pathinfo),
-				   1, po->fh_pathinfo))
-				return NULL;
-		}
-	} else {
+	/* check the sanity of n_paths */
+	if (pack->n_paths > MAX_MATH_PATHS)
+		return NULL;
+
+	/* now, read all the path info items at once */
+	if (pack->n_paths != fread(po->pathinfo_buf.info_arr,
+	                           sizeof(struct math_pathinfo),
+	                           pack->n_paths, po->fh_pathinfo))
 		return NULL;
-	}
 
-	return (struct math_pathinfo_pack*)&ret;
+	return pack;
 }
 
 void math_posting_print_info(math_posting_t po_)
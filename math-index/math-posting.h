@@ -1,5 +1,6 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef void* math_posting_t;
 
@@ -41,6 +42,17 @@ void math_posting_free_reader(math_posting_t);
 struct subpath_ele *math_posting_get_ele(math_posting_t);
 const char *math_posting_get_pathstr(math_posting_t);
 
+/* read posting list (raw or block-compressed) and pathinfo from
+ * memory given by caller instead of files under reader path, must be
+ * called before start function. Memory is not released by reader. */
+void math_posting_set_mem(math_posting_t, bool, const void*, size_t,
+                          const void*, size_t);
+
+/* posting file under reader path is known to be block-compressed
+ * or raw (e.g. recorded in a path dictionary), so that start function
+ * does not probe the other one. Must be called before start function. */
+void math_posting_set_fmt(math_posting_t, bool);
+
 bool math_posting_start(math_posting_t);
 bool math_posting_jump(math_posting_t, uint64_t);
 bool math_posting_next(math_posting_t);
@@ -0,0 +1,550 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dir-util/dir-util.h"
+#include "head.h"
+
+enum {
+	PACKED_DICT,
+	PACKED_POSTING,
+	PACKED_PATHINFO
+};
+
+static const char *packed_fname[3] = {
+	MATH_PACKED_DICT_FNAME,
+	MATH_PACKED_POSTING_FNAME,
+	MATH_PACKED_PATHINFO_FNAME
+};
+
+uint64_t math_packed_hash(uint64_t h, const char *name)
+{
+	/* FNV-1a of "/name" continued from parent hash */
+	h = (h ^ '/') * 0x100000001b3ULL;
+
+	while (*name)
+		h = (h ^ (unsigned char)(*name++)) * 0x100000001b3ULL;
+
+	return h;
+}
+
+/* write path of node `id' relative to its ancestor `from' (e.g. "/a/b")
+ * into dest, return the end of written string. */
+static char *
+node_path(const struct math_packed_node *nodes, const char *names,
+          uint32_t from, uint32_t id, char *dest)
+{
+	if (id == from || id == 0) {
+		*dest = '\0';
+		return dest;
+	}
+
+	dest = node_path(nodes, names, from, nodes[id].parent, dest);
+	return dest + sprintf(dest, "/%s", names + nodes[id].name);
+}
+
+/* ==================
+ * build packed files
+ * ================== */
+struct packed_builder {
+	struct math_packed_node *nodes;
+	uint32_t n_nodes, node_cap;
+
+	char    *names;
+	uint32_t names_sz, names_cap;
+
+	FILE    *fh[3];
+	uint64_t off[3];
+};
+
+static uint32_t
+add_node(struct packed_builder *b, uint32_t parent, const char *name)
+{
+	uint32_t id;
+	size_t len = strlen(name) + 1;
+	struct math_packed_node *node;
+
+	if (b->n_nodes == b->node_cap) {
+		b->node_cap = (b->node_cap) ? b->node_cap << 1 : 1024;
+		b->nodes = realloc(b->nodes,
+		                   b->node_cap * sizeof(struct math_packed_node));
+	}
+
+	if (b->names_sz + len > b->names_cap) {
+		b->names_cap = (b->names_cap) ? b->names_cap : 4096;
+		while (b->names_sz + len > b->names_cap)
+			b->names_cap = b->names_cap << 1;
+		b->names = realloc(b->names, b->names_cap);
+	}
+
+	id = b->n_nodes ++;
+	node = b->nodes + id;
+	memset(node, 0, sizeof(struct math_packed_node));
+
+	node->parent = parent;
+	node->name = b->names_sz;
+	node->hash = (id == 0) ? MATH_PACKED_ROOT_HASH :
+	             math_packed_hash(b->nodes[parent].hash, name);
+
+	memcpy(b->names + b->names_sz, name, len);
+	b->names_sz += len;
+
+	return id;
+}
+
+/* append a file to packed file `i', return bytes copied */
+static uint64_t
+append_file(struct packed_builder *b, int i, const char *path)
+{
+	FILE *fh;
+	size_t n;
+	uint64_t sz = 0;
+	char buf[DISK_BLCK_SIZE * 16];
+
+	if (NULL == (fh = fopen(path, "r")))
+		return 0;
+
+	while ((n = fread(buf, 1, sizeof(buf), fh)) > 0) {
+		fwrite(buf, 1, n, b->fh[i]);
+		sz += n;
+	}
+
+	fclose(fh);
+	b->off[i] += sz;
+	return sz;
+}
+
+static uint64_t file_size(const char *path)
+{
+	struct stat st;
+
+	if (0 == stat(path, &st))
+		return (uint64_t)st.st_size;
+	else
+		return 0;
+}
+
+/* only record list sizes when building in-memory dictionary */
+static void scan_node_files(struct packed_builder *b, uint32_t id,
+                            const char *dir)
+{
+	struct math_packed_node *node = b->nodes + id;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+
+	sprintf(file_path, "%s/" MATH_POSTING_FNAME, dir);
+	node->posting_sz = file_size(file_path);
+
+	if (node->posting_sz == 0) {
+		sprintf(file_path, "%s/" MATH_POSTING_BLK_FNAME, dir);
+		node->posting_sz = file_size(file_path);
+		if (node->posting_sz)
+			node->flags |= MATH_PACKED_NODE_BLK;
+	}
+
+	sprintf(file_path, "%s/" PATH_INFO_FNAME, dir);
+	node->pathinfo_sz = file_size(file_path);
+}
+
+static void pack_node_files(struct packed_builder *b, uint32_t id,
+                            const char *dir)
+{
+	struct math_packed_node *node = b->nodes + id;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+
+	node->posting_off = b->off[PACKED_POSTING];
+	sprintf(file_path, "%s/" MATH_POSTING_FNAME, dir);
+	node->posting_sz = append_file(b, PACKED_POSTING, file_path);
+
+	if (node->posting_sz == 0) {
+		sprintf(file_path, "%s/" MATH_POSTING_BLK_FNAME, dir);
+		node->posting_sz = append_file(b, PACKED_POSTING, file_path);
+		if (node->posting_sz)
+			node->flags |= MATH_PACKED_NODE_BLK;
+	}
+
+	node->pathinfo_off = b->off[PACKED_PATHINFO];
+	sprintf(file_path, "%s/" PATH_INFO_FNAME, dir);
+	node->pathinfo_sz = append_file(b, PACKED_PATHINFO, file_path);
+}
+
+static int name_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* add sub-directories of a node as its children, sorted by name */
+static void add_children(struct packed_builder *b, uint32_t id,
+                         const char *dir)
+{
+	DIR *d;
+	struct dirent *dent;
+	char **sub = NULL;
+	uint32_t i, n = 0, cap = 0;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+
+	if (NULL == (d = opendir(dir)))
+		return;
+
+	while (NULL != (dent = readdir(d))) {
+		if (dent->d_name[0] == '.')
+			continue;
+
+		/* only math paths are under index root */
+		if (id == 0 && strcmp(dent->d_name, TOKEN_PATH_NAME) != 0 &&
+		    strcmp(dent->d_name, GENER_PATH_NAME) != 0)
+			continue;
+
+		sprintf(file_path, "%s/%s", dir, dent->d_name);
+		if (!dir_exists(file_path))
+			continue;
+
+		if (n == cap) {
+			cap = (cap) ? cap << 1 : 16;
+			sub = realloc(sub, cap * sizeof(char*));
+		}
+		sub[n ++] = strdup(dent->d_name);
+	}
+	closedir(d);
+
+	qsort(sub, n, sizeof(char*), &name_cmp);
+
+	b->nodes[id].child_begin = b->n_nodes;
+	b->nodes[id].n_children = n;
+
+	for (i = 0; i < n; i++) {
+		add_node(b, id, sub[i]);
+		free(sub[i]);
+	}
+
+	free(sub);
+}
+
+static int hash_ent_cmp(const void *a, const void *b)
+{
+	const struct math_packed_hash_ent *x = a, *y = b;
+
+	if (x->hash != y->hash)
+		return (x->hash < y->hash) ? -1 : 1;
+	else
+		return (x->node < y->node) ? -1 : (x->node > y->node);
+}
+
+static struct math_packed_hash_ent *make_hash_idx(struct packed_builder *b)
+{
+	uint32_t i;
+	struct math_packed_hash_ent *hash_idx;
+
+	hash_idx = malloc(b->n_nodes * sizeof(struct math_packed_hash_ent));
+	for (i = 0; i < b->n_nodes; i++) {
+		hash_idx[i].hash = b->nodes[i].hash;
+		hash_idx[i].node = i;
+	}
+	qsort(hash_idx, b->n_nodes, sizeof(struct math_packed_hash_ent),
+	      &hash_ent_cmp);
+
+	return hash_idx;
+}
+
+/* add nodes in BFS order (the order they are added), data files are
+ * packed if they are opened, otherwise only list sizes are recorded. */
+static void build_tree(struct packed_builder *b, const char *index_dir)
+{
+	uint32_t id;
+	char *p, dir[MAX_DIR_PATH_NAME_LEN];
+
+	add_node(b, 0, "");
+
+	for (id = 0; id < b->n_nodes; id++) {
+		p = dir + sprintf(dir, "%s", index_dir);
+		node_path(b->nodes, b->names, 0, id, p);
+
+		if (b->fh[PACKED_POSTING])
+			pack_node_files(b, id, dir);
+		else
+			scan_node_files(b, id, dir);
+
+		add_children(b, id, dir);
+	}
+}
+
+static void write_dict(struct packed_builder *b)
+{
+	struct math_packed_hash_ent *hash_idx = make_hash_idx(b);
+	struct math_packed_head head = {MATH_PACKED_MAGIC, MATH_PACKED_VERSION,
+	                                b->n_nodes, b->names_sz};
+
+	fwrite(&head, 1, sizeof(head), b->fh[PACKED_DICT]);
+	fwrite(b->nodes, sizeof(struct math_packed_node), b->n_nodes,
+	       b->fh[PACKED_DICT]);
+	fwrite(hash_idx, sizeof(struct math_packed_hash_ent), b->n_nodes,
+	       b->fh[PACKED_DICT]);
+	fwrite(b->names, 1, b->names_sz, b->fh[PACKED_DICT]);
+
+	free(hash_idx);
+}
+
+int math_packed_build(const char *index_dir)
+{
+	int i, ret = 0;
+	char dir[MAX_DIR_PATH_NAME_LEN];
+	struct packed_builder b;
+
+	memset(&b, 0, sizeof(b));
+
+	for (i = 0; i < 3; i++) {
+		sprintf(dir, "%s/%s", index_dir, packed_fname[i]);
+		b.fh[i] = fopen(dir, "w");
+
+		if (b.fh[i] == NULL) {
+			fprintf(stderr, "cannot create %s\n", dir);
+			ret = -1;
+			goto free;
+		}
+	}
+
+	build_tree(&b, index_dir);
+	write_dict(&b);
+
+	for (i = 0; i < 3; i++)
+		if (ferror(b.fh[i]))
+			ret = -1;
+
+#ifdef DEBUG_MATH_PACKED
+	printf("packed %u paths: %lu posting bytes, %lu pathinfo bytes.\n",
+	       b.n_nodes, b.off[PACKED_POSTING], b.off[PACKED_PATHINFO]);
+#endif
+
+free:
+	for (i = 0; i < 3; i++)
+		if (b.fh[i])
+			fclose(b.fh[i]);
+
+	free(b.nodes);
+	free(b.names);
+	return ret;
+}
+
+/* ==================
+ * read packed files
+ * ================== */
+static char *map_file(const char *path, size_t *sz)
+{
+	int fd;
+	struct stat st;
+	char *p;
+
+	*sz = 0;
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return NULL;
+
+	if (0 != fstat(fd, &st) || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (p == MAP_FAILED)
+		return NULL;
+
+	*sz = st.st_size;
+	return p;
+}
+
+struct math_packed *math_packed_open(const char *index_dir)
+{
+	int i;
+	size_t sz;
+	const struct math_packed_head *head;
+	struct math_packed *p;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+
+	sprintf(file_path, "%s/" MATH_PACKED_DICT_FNAME, index_dir);
+	if (!file_exists(file_path))
+		return NULL;
+
+	p = calloc(1, sizeof(struct math_packed));
+
+	for (i = 0; i < 3; i++) {
+		sprintf(file_path, "%s/%s", index_dir, packed_fname[i]);
+		p->map[i] = map_file(file_path, &p->map_sz[i]);
+	}
+
+	/* check dictionary sanity */
+	head = (const struct math_packed_head*)p->map[PACKED_DICT];
+	if (head == NULL || p->map_sz[PACKED_DICT] < sizeof(*head) ||
+	    head->magic != MATH_PACKED_MAGIC ||
+	    head->version != MATH_PACKED_VERSION)
+		goto bad;
+
+	sz = sizeof(*head) + head->names_sz + (size_t)head->n_nodes *
+	     (sizeof(struct math_packed_node) +
+	      sizeof(struct math_packed_hash_ent));
+
+	if (head->n_nodes == 0 || sz != p->map_sz[PACKED_DICT])
+		goto bad;
+
+	madvise(p->map[PACKED_DICT], p->map_sz[PACKED_DICT], MADV_WILLNEED);
+
+	p->n_nodes = head->n_nodes;
+	p->nodes = (const struct math_packed_node*)(head + 1);
+	p->hash_idx = (const struct math_packed_hash_ent*)
+	              (p->nodes + p->n_nodes);
+	p->names = (const char*)(p->hash_idx + p->n_nodes);
+
+	return p;
+
+bad:
+	fprintf(stderr, "bad packed math index @ %s\n", index_dir);
+	math_packed_close(p);
+	return NULL;
+}
+
+struct math_packed *math_packed_scan(const char *index_dir)
+{
+	struct packed_builder b;
+	struct math_packed *p;
+
+	memset(&b, 0, sizeof(b));
+	build_tree(&b, index_dir);
+
+	p = calloc(1, sizeof(struct math_packed));
+	p->in_mem = 1;
+	p->n_nodes = b.n_nodes;
+	p->nodes = b.nodes;
+	p->hash_idx = make_hash_idx(&b);
+	p->names = b.names;
+
+#ifdef DEBUG_MATH_PACKED
+	printf("%u paths scanned into memory.\n", p->n_nodes);
+#endif
+	return p;
+}
+
+void math_packed_close(struct math_packed *p)
+{
+	int i;
+
+	if (p->in_mem) {
+		free((void*)p->nodes);
+		free((void*)p->hash_idx);
+		free((void*)p->names);
+	}
+
+	for (i = 0; i < 3; i++)
+		if (p->map[i])
+			munmap(p->map[i], p->map_sz[i]);
+
+	free(p);
+}
+
+const char *math_packed_name(struct math_packed *p, uint32_t id)
+{
+	return p->names + p->nodes[id].name;
+}
+
+uint32_t math_packed_lookup(struct math_packed *p, const char *relpath)
+{
+	uint32_t lo, hi, mid;
+	uint64_t h = MATH_PACKED_ROOT_HASH;
+	char path[MAX_DIR_PATH_NAME_LEN];
+	char node_str[MAX_DIR_PATH_NAME_LEN];
+	char *tok, *save;
+
+	/* canonical form "/a/b" is compared against found nodes */
+	sprintf(path, "%s", relpath);
+	node_str[0] = '\0';
+
+	for (tok = strtok_r(path, "/", &save); tok != NULL;
+	     tok = strtok_r(NULL, "/", &save)) {
+		h = math_packed_hash(h, tok);
+		strcat(node_str, "/");
+		strcat(node_str, tok);
+	}
+
+	/* binary search the first entry of hash */
+	lo = 0;
+	hi = p->n_nodes;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (p->hash_idx[mid].hash < h)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* resolve (very unlikely) hash collisions */
+	for (; lo < p->n_nodes && p->hash_idx[lo].hash == h; lo++) {
+		node_path(p->nodes, p->names, 0, p->hash_idx[lo].node, path);
+		if (0 == strcmp(path, node_str))
+			return p->hash_idx[lo].node;
+	}
+
+	return MATH_PACKED_NONE;
+}
+
+uint32_t
+math_packed_child(struct math_packed *p, uint32_t id, const char *name)
+{
+	int res;
+	uint32_t lo, hi, mid;
+	const struct math_packed_node *node = p->nodes + id;
+
+	/* children are sorted by name */
+	lo = node->child_begin;
+	hi = node->child_begin + node->n_children;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		res = strcmp(math_packed_name(p, mid), name);
+
+		if (res == 0)
+			return mid;
+		else if (res < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return MATH_PACKED_NONE;
+}
+
+char *math_packed_path(struct math_packed *p, uint32_t from, uint32_t id,
+                       char *dest)
+{
+	return node_path(p->nodes, p->names, from, id, dest);
+}
+
+void math_packed_set_reader(struct math_packed *p, uint32_t id,
+                            math_posting_t po)
+{
+	const struct math_packed_node *node = p->nodes + id;
+	const char *posting = NULL, *pathinfo = NULL;
+	size_t posting_sz = 0, pathinfo_sz = 0;
+
+	/* in-memory dictionary: reader opens files under its path in
+	 * recorded format, unless we already know there is no list. */
+	if (p->in_mem && node->posting_sz != 0) {
+		math_posting_set_fmt(po, !!(node->flags & MATH_PACKED_NODE_BLK));
+		return;
+	}
+
+	if (node->posting_sz &&
+	    node->posting_off + node->posting_sz <= p->map_sz[PACKED_POSTING]) {
+		posting = p->map[PACKED_POSTING] + node->posting_off;
+		posting_sz = node->posting_sz;
+	}
+
+	if (node->pathinfo_sz &&
+	    node->pathinfo_off + node->pathinfo_sz <= p->map_sz[PACKED_PATHINFO]) {
+		pathinfo = p->map[PACKED_PATHINFO] + node->pathinfo_off;
+		pathinfo_sz = node->pathinfo_sz;
+	}
+
+	math_posting_set_mem(po, !!(node->flags & MATH_PACKED_NODE_BLK),
+	                     posting, posting_sz, pathinfo, pathinfo_sz);
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * packed math index: the per-path directories of a math index are
+ * replaced by a path dictionary (a trie of path tokens) and two files
+ * holding all posting lists and all pathinfo packs respectively.
+ *
+ * dictionary file layout:
+ * head, nodes[n_nodes], hash index[n_nodes], names[names_sz]
+ *
+ * nodes are in BFS order, children of a node have consecutive IDs and
+ * are sorted by name, node 0 is the root (index directory itself).
+ */
+#define MATH_PACKED_MAGIC   0x4b50494d /* "MIPK" */
+#define MATH_PACKED_VERSION 1
+#define MATH_PACKED_NONE    UINT32_MAX
+
+#define MATH_PACKED_NODE_BLK 0x1 /* posting is block-compressed */
+
+#pragma pack(push, 1)
+struct math_packed_head {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n_nodes;
+	uint32_t names_sz;
+};
+
+struct math_packed_node {
+	uint64_t hash;        /* hash of path string relative to root */
+	uint32_t parent;      /* parent node ID (root is its own parent) */
+	uint32_t child_begin; /* ID of first child */
+	uint32_t n_children;
+	uint32_t name;        /* offset of name in names area */
+	uint32_t flags;
+	uint64_t posting_off, posting_sz;
+	uint64_t pathinfo_off, pathinfo_sz;
+};
+
+struct math_packed_hash_ent {
+	uint64_t hash;
+	uint32_t node;
+};
+#pragma pack(pop)
+
+struct math_packed {
+	char    *map[3]; /* mapped dictionary, posting and pathinfo */
+	size_t   map_sz[3];
+
+	/* dictionary scanned from path directories (no data files),
+	 * see math_packed_scan() */
+	bool     in_mem;
+
+	uint32_t n_nodes;
+	const struct math_packed_node     *nodes;
+	const struct math_packed_hash_ent *hash_idx;
+	const char                        *names;
+};
+
+/* convert directory layout under a math index directory into packed
+ * files (in the same directory), return 0 on success. */
+int math_packed_build(const char*);
+
+/* open packed files of a math index directory, NULL if not packed */
+struct math_packed *math_packed_open(const char*);
+
+/* scan path directories of a math index into an in-memory dictionary
+ * (with list sizes), so that directory merge needs no stat() calls.
+ * Posting readers still read lists from path directories. */
+struct math_packed *math_packed_scan(const char*);
+
+void math_packed_close(struct math_packed*);
+
+/* hash of a path string relative to index root, e.g. "token/VAR/ADD",
+ * a child hash is derived from its parent hash and name. */
+uint64_t math_packed_hash(uint64_t, const char*);
+
+#define MATH_PACKED_ROOT_HASH 0xcbf29ce484222325ULL
+
+/* return node ID of a relative path string, or MATH_PACKED_NONE */
+uint32_t math_packed_lookup(struct math_packed*, const char*);
+
+/* return child node ID of a given name, or MATH_PACKED_NONE */
+uint32_t math_packed_child(struct math_packed*, uint32_t, const char*);
+
+const char *math_packed_name(struct math_packed*, uint32_t);
+
+/* write path of a node relative to its ancestor (e.g. "/a/b"), return
+ * the end of written string. */
+char *math_packed_path(struct math_packed*, uint32_t, uint32_t, char*);
+
+/* let a posting reader read the lists of a node from packed files */
+void math_packed_set_reader(struct math_packed*, uint32_t, math_posting_t);
@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "head.h"
+
+/*
+ * convert path directories of a math index into a packed index,
+ * path directories are left untouched (and ignored by readers
+ * once the packed index exists).
+ */
+int main(int argc, char *argv[])
+{
+	int opt, ret = 0;
+	char *path = NULL;
+	struct math_packed *packed;
+
+	while ((opt = getopt(argc, argv, "hp:")) != -1) {
+		switch (opt) {
+		case 'h':
+			printf("DESCRIPTION:\n");
+			printf("pack math index path directories into"
+			       " a path dictionary and two data files. \n");
+			printf("\n");
+			printf("USAGE:\n");
+			printf("%s -h | -p <math index path>\n", argv[0]);
+			printf("\n");
+			printf("EXAMPLE:\n");
+			printf("%s -p ./tmp\n", argv[0]);
+			goto exit;
+
+		case 'p':
+			path = strdup(optarg);
+			break;
+
+		default:
+			printf("bad argument(s). \n");
+			goto exit;
+		}
+	}
+
+	if (path == NULL) {
+		printf("no path specified.\n");
+		goto exit;
+	}
+
+	if (math_packed_build(path)) {
+		fprintf(stderr, "fails to pack math index @ %s\n", path);
+		ret = 1;
+		goto free;
+	}
+
+	packed = math_packed_open(path);
+	if (packed == NULL) {
+		ret = 1;
+		goto free;
+	}
+
+	printf("%u paths packed.\n", packed->n_nodes);
+	math_packed_close(packed);
+
+free:
+	free(path);
+exit:
+	return ret;
+}
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "dir-util/dir-util.h"
+#include "head.h"
+
+/*
+ * convert raw posting.bin files under a math index directory
+ * into block-compressed posting files (optionally with pathinfo
+ * packs inlined, in which case pathinfo.bin is removed).
+ */
+struct compress_stats {
+	uint64_t n_files, raw_bytes, blk_bytes;
+	bool     inline_pathinfo;
+};
+
+/* load the whole pathinfo file and check every item refers to
+ * a complete pack in it, return NULL on failure. */
+static char *load_pathinfo(const char *path,
+                           struct math_posting_item *items, uint32_t n)
+{
+	FILE *fh;
+	long sz;
+	uint32_t i;
+	size_t pack_sz;
+	char *pinfo;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	sprintf(file_path, "%s/" PATH_INFO_FNAME, path);
+
+	if (NULL == (fh = fopen(file_path, "r")))
+		return NULL;
+
+	fseek(fh, 0, SEEK_END);
+	sz = ftell(fh);
+	rewind(fh);
+
+	pinfo = malloc(sz + 1);
+	if (sz != fread(pinfo, 1, sz, fh)) {
+		fclose(fh);
+		free(pinfo);
+		return NULL;
+	}
+	fclose(fh);
+
+	for (i = 0; i < n; i++) {
+		if (items[i].pathinfo_pos + sizeof(struct math_pathinfo_pack) > sz)
+			break;
+
+		pack_sz = math_posting_blk_pack_sz(pinfo + items[i].pathinfo_pos);
+		if (pack_sz == 0 || items[i].pathinfo_pos + pack_sz > sz)
+			break;
+	}
+
+	if (i != n) {
+		free(pinfo);
+		return NULL;
+	}
+
+	return pinfo;
+}
+
+static long compress_posting(const char *path, bool inline_pathinfo)
+{
+	FILE *fh, *skp_fh;
+	long sz;
+	uint32_t n;
+	uint64_t off = 0;
+	struct math_posting_item *items;
+	char *pinfo = NULL;
+	char raw_path[MAX_DIR_PATH_NAME_LEN];
+	char blk_path[MAX_DIR_PATH_NAME_LEN];
+	char skp_path[MAX_DIR_PATH_NAME_LEN];
+	char inf_path[MAX_DIR_PATH_NAME_LEN];
+
+	sprintf(raw_path, "%s/" MATH_POSTING_FNAME, path);
+	sprintf(blk_path, "%s/" MATH_POSTING_BLK_FNAME, path);
+	sprintf(skp_path, "%s/" MATH_POSTING_SKP_FNAME, path);
+	sprintf(inf_path, "%s/" PATH_INFO_FNAME, path);
+
+	if (NULL == (fh = fopen(raw_path, "r")))
+		return -1;
+
+	fseek(fh, 0, SEEK_END);
+	sz = ftell(fh);
+	rewind(fh);
+
+	n = sz / sizeof(struct math_posting_item);
+	items = malloc(n * sizeof(struct math_posting_item));
+
+	if (n != fread(items, sizeof(struct math_posting_item), n, fh)) {
+		fclose(fh);
+		free(items);
+		return -1;
+	}
+	fclose(fh);
+
+	if (inline_pathinfo) {
+		pinfo = load_pathinfo(path, items, n);
+		if (pinfo == NULL) {
+			fprintf(stderr, "bad pathinfo file @ %s\n", path);
+			free(items);
+			return -1;
+		}
+	}
+
+	if (NULL == (fh = fopen(blk_path, "w"))) {
+		free(pinfo);
+		free(items);
+		return -1;
+	}
+
+	/* skip table of raw posting is replaced by that of blocks */
+	skp_fh = fopen(skp_path, "w");
+
+	if (math_posting_blk_write(fh, skp_fh, items, n, pinfo, &off)) {
+		fprintf(stderr, "cannot write %s\n", blk_path);
+		fclose(fh);
+		unlink(blk_path);
+		if (skp_fh) {
+			fclose(skp_fh);
+			unlink(skp_path);
+		}
+		free(pinfo);
+		free(items);
+		return -1;
+	}
+
+	sz = ftell(fh);
+	fclose(fh);
+	if (skp_fh)
+		fclose(skp_fh);
+	free(items);
+
+	unlink(raw_path);
+	if (pinfo) {
+		/* all packs are inlined now */
+		unlink(inf_path);
+		free(pinfo);
+	}
+
+	return sz;
+}
+
+static enum ds_ret
+dir_search_callbk(const char* path, const char *srchpath,
+                  uint32_t level, void *arg)
+{
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	struct compress_stats *stats = (struct compress_stats*)arg;
+	long raw_sz, blk_sz;
+	FILE *fh;
+
+	sprintf(file_path, "%s/" MATH_POSTING_FNAME, path);
+	if (NULL == (fh = fopen(file_path, "r")))
+		return DS_RET_CONTINUE;
+
+	fseek(fh, 0, SEEK_END);
+	raw_sz = ftell(fh);
+	fclose(fh);
+
+	blk_sz = compress_posting(path, stats->inline_pathinfo);
+	if (blk_sz < 0) {
+		fprintf(stderr, "fails to compress posting @ %s\n", path);
+		return DS_RET_CONTINUE;
+	}
+
+	stats->n_files ++;
+	stats->raw_bytes += raw_sz;
+	stats->blk_bytes += blk_sz;
+
+	return DS_RET_CONTINUE;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+	char *path = NULL;
+	struct compress_stats stats = {0, 0, 0, 0};
+
+	while ((opt = getopt(argc, argv, "hip:")) != -1) {
+		switch (opt) {
+		case 'h':
+			printf("DESCRIPTION:\n");
+			printf("convert math index posting lists"
+			       " into block-compressed format. \n");
+			printf("\n");
+			printf("USAGE:\n");
+			printf("%s -h | -p <math index path> [-i]\n", argv[0]);
+			printf("\n");
+			printf("OPTIONS:\n");
+			printf("-i: inline pathinfo into posting blocks.\n");
+			printf("\n");
+			printf("EXAMPLE:\n");
+			printf("%s -p ./tmp\n", argv[0]);
+			goto exit;
+
+		case 'i':
+			stats.inline_pathinfo = 1;
+			break;
+
+		case 'p':
+			path = strdup(optarg);
+			break;
+
+		default:
+			printf("bad argument(s). \n");
+			goto exit;
+		}
+	}
+
+	if (path == NULL) {
+		printf("no path specified.\n");
+		goto exit;
+	}
+
+	dir_search_podfs(path, &dir_search_callbk, &stats);
+
+	printf("%lu posting files compressed: %lu => %lu bytes.\n",
+	       stats.n_files, stats.raw_bytes, stats.blk_bytes);
+
+	free(path);
+exit:
+	return 0;
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mhook/mhook.h"
+#include "dir-util/dir-util.h"
+#include "head.h"
+
+/*
+ * write two random math indices (shards), append them into a third
+ * one with doc IDs remapped, check every merged list equals the
+ * concatenation of shard lists.
+ */
+#define N_PATHS 16
+
+static void gen_path(char *path, const char *root, uint32_t j)
+{
+	sprintf(path, "%s/" TOKEN_PATH_NAME "/VAR/P%u", root, j);
+}
+
+static void gen_index(const char *root, uint32_t n_items)
+{
+	char path[MAX_DIR_PATH_NAME_LEN];
+	uint32_t i, k;
+	struct math_posting_item item;
+	struct math_pathinfo_pack head;
+	struct math_pathinfo info;
+	struct math_wr_cache *cache = math_wr_cache_new();
+
+	for (i = 0; i < n_items; i++) {
+		head.n_paths = 1 + rand() % 3;
+		head.n_lr_paths = 4;
+		item.doc_id = i / 10 + 1;
+		item.exp_id = i % 10;
+
+		gen_path(path, root, rand() % N_PATHS);
+		item.pathinfo_pos = math_wr_cache_file_sz(cache, path,
+		                                          MATH_WR_FILE_PATHINFO);
+		math_wr_cache_append(cache, path, MATH_WR_FILE_POSTING,
+		                     &item, sizeof(item));
+		math_wr_cache_append(cache, path, MATH_WR_FILE_PATHINFO,
+		                     &head, sizeof(head));
+
+		for (k = 0; k < head.n_paths; k++) {
+			info.path_id = k + 1;
+			info.lf_symb = rand();
+			info.fr_hash = rand();
+			math_wr_cache_append(cache, path, MATH_WR_FILE_PATHINFO,
+			                     &info, sizeof(info));
+		}
+	}
+
+	math_wr_cache_free(cache);
+}
+
+/* compare shard list (remapped) with the merged list from its
+ * current position, return 0 if identical. */
+static int cmp_shard(math_posting_t merged, bool *more, const char *path,
+                     const doc_id_t *doc_map)
+{
+	int res = 0;
+	math_posting_t po = math_posting_new_reader(NULL, path);
+	struct math_posting_item *item1, *item2;
+	struct math_pathinfo_pack *pack1, *pack2;
+	bool more_shard = math_posting_start(po);
+
+	while (more_shard) {
+		if (!*more) {
+			res = 1;
+			break;
+		}
+
+		item1 = math_posting_current(po);
+		item2 = math_posting_current(merged);
+		if (doc_map[item1->doc_id] != item2->doc_id ||
+		    item1->exp_id != item2->exp_id) {
+			res = 1;
+			break;
+		}
+
+		pack1 = math_posting_pathinfo(po, item1->pathinfo_pos);
+		pack2 = math_posting_pathinfo(merged, item2->pathinfo_pos);
+		if (pack1 == NULL || pack2 == NULL ||
+		    memcmp(pack1, pack2, math_posting_blk_pack_sz(pack1))) {
+			res = 1;
+			break;
+		}
+
+		more_shard = math_posting_next(po);
+		*more = math_posting_next(merged);
+	}
+
+	math_posting_finish(po);
+	math_posting_free_reader(po);
+	return res;
+}
+
+int main()
+{
+	char path[MAX_DIR_PATH_NAME_LEN];
+	uint32_t d, j, n_diff = 0, n_docs_a = 500, n_docs_b = 300;
+	doc_id_t *map_a, *map_b;
+	math_index_t dst, src;
+	math_posting_t po;
+	bool more;
+
+	srand(1);
+	gen_index("./tmp-a", n_docs_a * 10);
+	gen_index("./tmp-b", n_docs_b * 10);
+
+	/* shard B documents follow those of shard A */
+	map_a = malloc((n_docs_a + 1) * sizeof(doc_id_t));
+	map_b = malloc((n_docs_b + 1) * sizeof(doc_id_t));
+	for (d = 0; d <= n_docs_a; d++)
+		map_a[d] = d;
+	for (d = 0; d <= n_docs_b; d++)
+		map_b[d] = n_docs_a + d;
+
+	dst = math_index_open("./tmp-merge", MATH_INDEX_WRITE_BUFFERED);
+
+	src = math_index_open("./tmp-a", MATH_INDEX_READ_ONLY);
+	n_diff += math_index_append_index(dst, src, map_a, n_docs_a);
+	math_index_close(src);
+
+	src = math_index_open("./tmp-b", MATH_INDEX_READ_ONLY);
+	n_diff += math_index_append_index(dst, src, map_b, n_docs_b);
+	math_index_close(src);
+
+	math_index_close(dst);
+
+	/* doc IDs beyond the map are rejected */
+	dst = math_index_open("./tmp-reject", MATH_INDEX_WRITE_BUFFERED);
+	src = math_index_open("./tmp-b", MATH_INDEX_READ_ONLY);
+	if (0 == math_index_append_index(dst, src, map_b, n_docs_b / 2))
+		n_diff ++;
+	math_index_close(src);
+	math_index_close(dst);
+
+	for (j = 0; j < N_PATHS; j++) {
+		gen_path(path, "./tmp-merge", j);
+		po = math_posting_new_reader(NULL, path);
+		more = math_posting_start(po);
+
+		gen_path(path, "./tmp-a", j);
+		if (cmp_shard(po, &more, path, map_a))
+			n_diff ++;
+
+		gen_path(path, "./tmp-b", j);
+		if (cmp_shard(po, &more, path, map_b))
+			n_diff ++;
+
+		if (more) {
+			printf("merged list has extra items @ P%u\n", j);
+			n_diff ++;
+		}
+
+		math_posting_finish(po);
+		math_posting_free_reader(po);
+	}
+
+	free(map_a);
+	free(map_b);
+
+	if (n_diff == 0)
+		printf("identical output.\n");
+	else
+		printf("outputs differ!\n");
+
+	mhook_print_unfree();
+	return n_diff;
+}
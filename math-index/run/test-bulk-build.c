@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mhook/mhook.h"
+#include "dir-util/dir-util.h"
+#include "head.h"
+
+/*
+ * write the same random record sequence through math_wr_cache
+ * and through math_bulk_builder, decoded outputs should be identical
+ * (on-disk formats differ, see bulk-build.h).
+ */
+static void gen_path(char *path, const char *root, uint32_t j)
+{
+	sprintf(path, "%s/token/VAR/path%u", root, j);
+}
+
+/* posting files may be block-compressed (with pathinfo inlined),
+ * compare decoded IDs and the pathinfo packs they refer to */
+static int cmp_postings(const char *path1, const char *path2)
+{
+	int res = 0;
+	bool more1, more2;
+	struct math_posting_item *item1, *item2;
+	struct math_pathinfo_pack *pack1, *pack2;
+	math_posting_t po1 = math_posting_new_reader(NULL, path1);
+	math_posting_t po2 = math_posting_new_reader(NULL, path2);
+
+	more1 = math_posting_start(po1);
+	more2 = math_posting_start(po2);
+
+	while (more1 && more2) {
+		item1 = math_posting_current(po1);
+		item2 = math_posting_current(po2);
+		if (*(uint64_t*)item1 != *(uint64_t*)item2) {
+			res = 1;
+			break;
+		}
+
+		pack1 = math_posting_pathinfo(po1, item1->pathinfo_pos);
+		pack2 = math_posting_pathinfo(po2, item2->pathinfo_pos);
+		if (pack1 == NULL || pack2 == NULL ||
+		    memcmp(pack1, pack2, math_posting_blk_pack_sz(pack1))) {
+			res = 1;
+			break;
+		}
+
+		more1 = math_posting_next(po1);
+		more2 = math_posting_next(po2);
+	}
+
+	if (more1 != more2)
+		res = 1;
+
+	math_posting_finish(po1);
+	math_posting_finish(po2);
+	math_posting_free_reader(po1);
+	math_posting_free_reader(po2);
+	return res;
+}
+
+int main()
+{
+	char path[MAX_DIR_PATH_NAME_LEN];
+	char path2[MAX_DIR_PATH_NAME_LEN];
+	uint32_t i, j, k, n_paths = 64, n_items = 20000, n_diff = 0;
+	struct math_posting_item item;
+	struct math_pathinfo_pack head;
+	struct math_pathinfo info;
+	struct math_wr_cache *cache = math_wr_cache_new();
+	struct math_bulk_builder *bulk = math_bulk_new("./tmp/bulk");
+
+	mkdir_p("./tmp/bulk");
+	srand(1);
+
+	for (i = 0; i < n_items; i++) {
+		j = rand() % n_paths;
+		head.n_paths = 1 + rand() % 3;
+		head.n_lr_paths = 4;
+		item.doc_id = i / 10;
+		item.exp_id = i;
+
+		gen_path(path, "./tmp/buffered", j);
+		item.pathinfo_pos = math_wr_cache_file_sz(cache, path,
+		                                          MATH_WR_FILE_PATHINFO);
+		math_wr_cache_append(cache, path, MATH_WR_FILE_POSTING,
+		                     &item, sizeof(item));
+		math_wr_cache_append(cache, path, MATH_WR_FILE_PATHINFO,
+		                     &head, sizeof(head));
+
+		gen_path(path, "./tmp/bulk", j);
+		item.pathinfo_pos = 0;
+		math_bulk_add(bulk, path, MATH_WR_FILE_POSTING,
+		              &item, sizeof(item));
+		math_bulk_add(bulk, path, MATH_WR_FILE_PATHINFO,
+		              &head, sizeof(head));
+
+		for (k = 0; k < head.n_paths; k++) {
+			info.path_id = k + 1;
+			info.lf_symb = rand();
+			info.fr_hash = rand();
+
+			gen_path(path, "./tmp/buffered", j);
+			math_wr_cache_append(cache, path, MATH_WR_FILE_PATHINFO,
+			                     &info, sizeof(info));
+			gen_path(path, "./tmp/bulk", j);
+			math_bulk_add(bulk, path, MATH_WR_FILE_PATHINFO,
+			              &info, sizeof(info));
+		}
+	}
+
+	math_wr_cache_free(cache);
+
+	math_bulk_finish(bulk);
+	math_bulk_free(bulk);
+
+	for (j = 0; j < n_paths; j++) {
+		gen_path(path, "./tmp/buffered", j);
+		gen_path(path2, "./tmp/bulk", j);
+
+		if (cmp_postings(path, path2)) {
+			printf("posting differs @ %s\n", path2);
+			n_diff ++;
+		}
+	}
+
+	if (n_diff == 0)
+		printf("identical decoded output.\n");
+	else
+		printf("outputs differ!\n");
+
+	mhook_print_unfree();
+	return 0;
+}
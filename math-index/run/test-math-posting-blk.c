@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mhook/mhook.h"
+#include "dir-util/dir-util.h"
+#include "head.h"
+
+#define N_ITEMS 10000
+
+static struct math_posting_item items[N_ITEMS];
+
+/* pathinfo packs referred by items */
+static char pinfo[N_ITEMS * (sizeof(struct math_pathinfo_pack) +
+                             3 * sizeof(struct math_pathinfo))];
+static uint32_t pinfo_sz = 0;
+
+static void gen_pack(struct math_pathinfo_pack *pack)
+{
+	uint32_t i;
+	pack->n_paths = rand() % 4;
+	pack->n_lr_paths = rand() % 10;
+
+	for (i = 0; i < pack->n_paths; i++) {
+		pack->pathinfo[i].path_id = rand() % 64;
+		pack->pathinfo[i].lf_symb = rand();
+		pack->pathinfo[i].fr_hash = rand();
+	}
+}
+
+static void gen_items(void)
+{
+	uint32_t i, doc_id = 1, exp_id = 0;
+	struct math_pathinfo_pack *pack;
+
+	for (i = 0; i < N_ITEMS; i++) {
+		if (rand() % 3 == 0) {
+			doc_id += 1 + rand() % ((i % 100 == 0) ? 100000 : 10);
+			exp_id = rand() % 10;
+		} else {
+			exp_id += 1 + rand() % 20;
+		}
+
+		items[i].doc_id = doc_id;
+		items[i].exp_id = exp_id;
+		items[i].pathinfo_pos = pinfo_sz;
+
+		pack = (struct math_pathinfo_pack*)(pinfo + pinfo_sz);
+		gen_pack(pack);
+		pinfo_sz += math_posting_blk_pack_sz(pack);
+	}
+}
+
+static int write_postings(const char *path, bool blk, bool skp, bool inl)
+{
+	FILE *fh, *skp_fh = NULL;
+	uint32_t i;
+	uint64_t off = 0;
+	struct math_posting_skip skip;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+
+	mkdir_p(path);
+	sprintf(file_path, "%s/%s", path,
+	        blk ? MATH_POSTING_BLK_FNAME : MATH_POSTING_FNAME);
+
+	fh = fopen(file_path, "w");
+	if (fh == NULL)
+		return 1;
+
+	if (skp) {
+		sprintf(file_path, "%s/" MATH_POSTING_SKP_FNAME, path);
+		skp_fh = fopen(file_path, "w");
+	}
+
+	if (blk) {
+		math_posting_blk_write(fh, skp_fh, items, N_ITEMS,
+		                       inl ? pinfo : NULL, &off);
+	} else {
+		fwrite(items, sizeof(struct math_posting_item), N_ITEMS, fh);
+
+		for (i = MATH_POSTING_SKIP_RAW_ITEMS; skp_fh && i <= N_ITEMS;
+		     i += MATH_POSTING_SKIP_RAW_ITEMS) {
+			skip.max_id = *(uint64_t*)(items + i - 1);
+			skip.offset = off;
+			fwrite(&skip, sizeof(skip), 1, skp_fh);
+			off += MATH_POSTING_SKIP_RAW_BYTES;
+		}
+	}
+
+	if (skp_fh)
+		fclose(skp_fh);
+
+	fclose(fh);
+
+	/* pathinfo file is not needed when packs are inlined */
+	if (!inl) {
+		sprintf(file_path, "%s/" PATH_INFO_FNAME, path);
+		fh = fopen(file_path, "w");
+		fwrite(pinfo, 1, pinfo_sz, fh);
+		fclose(fh);
+	}
+
+	return 0;
+}
+
+/* read through a posting, jumping forward every now and then */
+static int check_postings(const char *path, bool inl)
+{
+	int res = 0;
+	uint32_t i = 0;
+	uint64_t id, target;
+	struct math_posting_item *item;
+	struct math_pathinfo_pack *pack;
+	math_posting_t po = math_posting_new_reader(NULL, path);
+
+	if (!math_posting_start(po)) {
+		res = 1;
+		goto free;
+	}
+
+	do {
+		if (rand() % 50 == 0) {
+			/* jump to somewhere ahead */
+			i += rand() % 1000;
+			if (i >= N_ITEMS)
+				break;
+
+			target = *(uint64_t*)(items + i);
+			if (!math_posting_jump(po, target)) {
+				printf("jump failed @ item#%u\n", i);
+				res = 1;
+				break;
+			}
+		}
+
+		item = math_posting_current(po);
+		id = *(uint64_t*)item;
+
+		if (i >= N_ITEMS || id != *(uint64_t*)(items + i) ||
+		    (!inl && item->pathinfo_pos != items[i].pathinfo_pos)) {
+			printf("item#%u mismatch.\n", i);
+			res = 1;
+			break;
+		}
+
+		pack = math_posting_pathinfo(po, item->pathinfo_pos);
+		if (pack == NULL ||
+		    memcmp(pack, pinfo + items[i].pathinfo_pos,
+		           math_posting_blk_pack_sz(pack))) {
+			printf("item#%u pathinfo mismatch.\n", i);
+			res = 1;
+			break;
+		}
+
+		i ++;
+	} while (math_posting_next(po));
+
+	/* jump beyond the last item should fail */
+	if (res == 0 && math_posting_jump(po, UINT64_MAX)) {
+		printf("jump beyond the end succeeds.\n");
+		res = 1;
+	}
+
+free:
+	math_posting_finish(po);
+	math_posting_free_reader(po);
+	return res;
+}
+
+int main()
+{
+	FILE *fh;
+	long sz[2];
+	int res = 0;
+
+	srand(1);
+	gen_items();
+
+	write_postings("./tmp/raw", 0, 0, 0);
+	write_postings("./tmp/blk", 1, 0, 0);
+	write_postings("./tmp/raw-skp", 0, 1, 0);
+	write_postings("./tmp/blk-skp", 1, 1, 0);
+	write_postings("./tmp/blk-inl", 1, 1, 1);
+
+	fh = fopen("./tmp/raw/" MATH_POSTING_FNAME, "r");
+	fseek(fh, 0, SEEK_END);
+	sz[0] = ftell(fh);
+	fclose(fh);
+
+	fh = fopen("./tmp/blk/" MATH_POSTING_BLK_FNAME, "r");
+	fseek(fh, 0, SEEK_END);
+	sz[1] = ftell(fh);
+	fclose(fh);
+
+	printf("%u items: raw %ld bytes, block-compressed %ld bytes (%.2fx)\n",
+	       N_ITEMS, sz[0], sz[1], (double)sz[0] / sz[1]);
+
+	res |= check_postings("./tmp/raw", 0);
+	res |= check_postings("./tmp/blk", 0);
+	res |= check_postings("./tmp/raw-skp", 0);
+	res |= check_postings("./tmp/blk-skp", 0);
+	res |= check_postings("./tmp/blk-inl", 1);
+
+	printf("%s\n", res ? "failed." : "passed.");
+
+	mhook_print_unfree();
+	return res;
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mhook/mhook.h"
+#include "dir-util/dir-util.h"
+#include "head.h"
+
+/*
+ * write random posting lists in directory layout, scan them into
+ * in-memory path trie and pack them, check every list read through
+ * the dictionary equals the directory one.
+ */
+static void gen_path(char *path, const char *root, uint32_t j)
+{
+	if (j % 4 == 0)
+		sprintf(path, "%s/" TOKEN_PATH_NAME "/VAR/P%u", root, j / 4);
+	else
+		sprintf(path, "%s/" TOKEN_PATH_NAME "/VAR/P%u/Q%u",
+		        root, j / 4, j % 4);
+}
+
+static int cmp_postings(math_posting_t po1, math_posting_t po2)
+{
+	int res = 0;
+	bool more1, more2;
+	struct math_posting_item *item1, *item2;
+	struct math_pathinfo_pack *pack1, *pack2;
+
+	more1 = math_posting_start(po1);
+	more2 = math_posting_start(po2);
+
+	while (more1 && more2) {
+		item1 = math_posting_current(po1);
+		item2 = math_posting_current(po2);
+		if (*(uint64_t*)item1 != *(uint64_t*)item2) {
+			res = 1;
+			break;
+		}
+
+		pack1 = math_posting_pathinfo(po1, item1->pathinfo_pos);
+		pack2 = math_posting_pathinfo(po2, item2->pathinfo_pos);
+		if (pack1 == NULL || pack2 == NULL ||
+		    memcmp(pack1, pack2, math_posting_blk_pack_sz(pack1))) {
+			res = 1;
+			break;
+		}
+
+		more1 = math_posting_next(po1);
+		more2 = math_posting_next(po2);
+	}
+
+	if (more1 != more2)
+		res = 1;
+
+	/* jump beyond the end should fail */
+	if (res == 0 && more1 && math_posting_jump(po2, UINT64_MAX))
+		res = 1;
+
+	math_posting_finish(po1);
+	math_posting_finish(po2);
+	return res;
+}
+
+static uint32_t check_dict(struct math_packed *packed, uint32_t n_paths)
+{
+	char path[MAX_DIR_PATH_NAME_LEN];
+	uint32_t j, id, n_diff = 0;
+	math_posting_t po1, po2;
+
+	/* root, token, VAR, P0..P15, Q1..Q3 of each P */
+	printf("%u nodes in dictionary.\n", packed->n_nodes);
+	if (packed->n_nodes != 3 + n_paths)
+		n_diff ++;
+
+	if (MATH_PACKED_NONE != math_packed_lookup(packed, "term/foo") ||
+	    MATH_PACKED_NONE != math_packed_lookup(packed, "token/VAR/X"))
+		n_diff ++;
+
+	for (j = 0; j < n_paths; j++) {
+		gen_path(path, "./tmp", j);
+		id = math_packed_lookup(packed, path + strlen("./tmp/"));
+
+		if (id == MATH_PACKED_NONE) {
+			printf("path not found: %s\n", path);
+			n_diff ++;
+			continue;
+		}
+
+		/* child look-up should agree with path look-up */
+		if (id != math_packed_child(packed, packed->nodes[id].parent,
+		                            math_packed_name(packed, id))) {
+			printf("bad child link @ %s\n", path);
+			n_diff ++;
+		}
+
+		po1 = math_posting_new_reader(NULL, path);
+		po2 = math_posting_new_reader(NULL, path);
+		math_packed_set_reader(packed, id, po2);
+
+		if (cmp_postings(po1, po2)) {
+			printf("posting differs @ %s\n", path);
+			n_diff ++;
+		}
+
+		math_posting_free_reader(po1);
+		math_posting_free_reader(po2);
+	}
+
+	/* intermediate path has no posting list */
+	id = math_packed_lookup(packed, TOKEN_PATH_NAME "/VAR");
+	if (id == MATH_PACKED_NONE || packed->nodes[id].posting_sz != 0)
+		n_diff ++;
+
+	return n_diff;
+}
+
+int main()
+{
+	char path[MAX_DIR_PATH_NAME_LEN];
+	uint32_t i, j, k, n_paths = 64, n_items = 50000, n_diff = 0;
+	struct math_posting_item item;
+	struct math_pathinfo_pack head;
+	struct math_pathinfo info;
+	struct math_wr_cache *cache = math_wr_cache_new();
+	struct math_packed *packed;
+
+	srand(1);
+
+	for (i = 0; i < n_items; i++) {
+		j = rand() % n_paths;
+		head.n_paths = 1 + rand() % 3;
+		head.n_lr_paths = 4;
+		item.doc_id = i / 10;
+		item.exp_id = i;
+
+		gen_path(path, "./tmp", j);
+		item.pathinfo_pos = math_wr_cache_file_sz(cache, path,
+		                                          MATH_WR_FILE_PATHINFO);
+		math_wr_cache_append(cache, path, MATH_WR_FILE_POSTING,
+		                     &item, sizeof(item));
+		math_wr_cache_append(cache, path, MATH_WR_FILE_PATHINFO,
+		                     &head, sizeof(head));
+
+		for (k = 0; k < head.n_paths; k++) {
+			info.path_id = k + 1;
+			info.lf_symb = rand();
+			info.fr_hash = rand();
+			math_wr_cache_append(cache, path, MATH_WR_FILE_PATHINFO,
+			                     &info, sizeof(info));
+		}
+	}
+
+	math_wr_cache_free(cache);
+
+	/* not a math path, should not be packed */
+	mkdir_p("./tmp/term/foo");
+
+	packed = math_packed_scan("./tmp");
+	n_diff += check_dict(packed, n_paths);
+	math_packed_close(packed);
+
+	if (math_packed_build("./tmp") ||
+	    NULL == (packed = math_packed_open("./tmp"))) {
+		printf("cannot pack.\n");
+		return 1;
+	}
+
+	n_diff += check_dict(packed, n_paths);
+	math_packed_close(packed);
+
+	if (n_diff == 0)
+		printf("identical output.\n");
+	else
+		printf("outputs differ!\n");
+
+	mhook_print_unfree();
+	return n_diff;
+}
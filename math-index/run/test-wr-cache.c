@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mhook/mhook.h"
+#include "dir-util/dir-util.h"
+#include "config.h"
+#include "head.h"
+
+static uint64_t disk_file_sz(const char *path, const char *fname)
+{
+	struct stat s;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	sprintf(file_path, "%s/%s", path, fname);
+
+	return (0 == stat(file_path, &s)) ? (uint64_t)s.st_size : 0;
+}
+
+static void remove_files(const char *path)
+{
+	const char *fname[] = {MATH_POSTING_FNAME, MATH_POSTING_BLK_FNAME,
+	                       MATH_POSTING_SKP_FNAME, PATH_INFO_FNAME};
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	int i;
+
+	for (i = 0; i < sizeof(fname) / sizeof(fname[0]); i++) {
+		sprintf(file_path, "%s/%s", path, fname[i]);
+		remove(file_path);
+	}
+}
+
+int main()
+{
+	char path[MAX_DIR_PATH_NAME_LEN], file_path[MAX_DIR_PATH_NAME_LEN];
+	uint32_t i, j, n_paths = 8, n_items = 10000;
+	uint64_t sz, disk_sz, pathinfo_sz = n_items * sizeof(uint32_t);
+	struct math_posting_item item;
+	struct math_wr_cache_ent *ent;
+	struct math_wr_cache *cache;
+	const char *posting_fname;
+
+	for (j = 0; j < n_paths; j++) {
+		sprintf(path, "./tmp/wr-cache/path%u", j);
+		remove_files(path);
+	}
+
+	cache = math_wr_cache_new();
+
+	/* interleave appends to different paths */
+	for (i = 0; i < n_items; i++) {
+		item.doc_id = i / 4 + 1;
+		item.exp_id = i % 4;
+		item.pathinfo_pos = i * sizeof(uint32_t);
+
+		for (j = 0; j < n_paths; j++) {
+			sprintf(path, "./tmp/wr-cache/path%u", j);
+			math_wr_cache_append(cache, path, MATH_WR_FILE_POSTING,
+			                     &item, sizeof(item));
+			math_wr_cache_append(cache, path, MATH_WR_FILE_PATHINFO,
+			                     &i, sizeof(uint32_t));
+		}
+	}
+
+	/* pathinfo size includes buffered bytes */
+	for (j = 0; j < n_paths; j++) {
+		sprintf(path, "./tmp/wr-cache/path%u", j);
+		sz = math_wr_cache_file_sz(cache, path, MATH_WR_FILE_PATHINFO);
+		printf("%s pathinfo: %lu bytes (expect %lu)\n", path, sz,
+		       pathinfo_sz);
+		assert(sz == pathinfo_sz);
+	}
+
+	math_wr_cache_flush(cache);
+
+	/* posting size is that on disk (block-compressed or raw) */
+	for (j = 0; j < n_paths; j++) {
+		sprintf(path, "./tmp/wr-cache/path%u", j);
+		ent = math_wr_cache_get(cache, path);
+		posting_fname = (ent->blk) ? MATH_POSTING_BLK_FNAME :
+		                             MATH_POSTING_FNAME;
+
+		sz = math_wr_cache_file_sz(cache, path, MATH_WR_FILE_POSTING);
+		disk_sz = disk_file_sz(path, posting_fname);
+		printf("%s %s: %lu bytes (on disk %lu)\n", path, posting_fname,
+		       sz, disk_sz);
+
+		assert(sz == disk_sz);
+		if (!ent->blk)
+			assert(sz == n_items * sizeof(item));
+	}
+
+	/* a buffer failed to be written out is kept for later */
+	sprintf(path, "./tmp/wr-cache/path-err");
+	remove_files(path);
+
+	ent = math_wr_cache_get(cache, path);
+	posting_fname = (ent->blk) ? MATH_POSTING_BLK_FNAME :
+	                             MATH_POSTING_FNAME;
+	sprintf(file_path, "%s/%s", path, posting_fname);
+	mkdir(file_path, 0755); /* cannot be opened as a file */
+
+	math_wr_cache_append(cache, path, MATH_WR_FILE_POSTING,
+	                     &item, sizeof(item));
+	assert(0 != math_wr_cache_flush(cache));
+	assert(ent->buf_sz[MATH_WR_FILE_POSTING] == sizeof(item));
+
+	rmdir(file_path);
+	assert(0 == math_wr_cache_flush(cache));
+	assert(ent->buf_sz[MATH_WR_FILE_POSTING] == 0);
+	assert(disk_file_sz(path, posting_fname) > 0);
+
+	printf("%u entries, %u open handles, %lu bytes buffered.\n",
+	       cache->n_ents, cache->n_open, cache->buf_bytes);
+
+	math_wr_cache_free(cache);
+
+	mhook_print_unfree();
+	return 0;
+}
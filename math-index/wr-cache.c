@@ -0,0 +1,399 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+#include "dir-util/dir-util.h"
+#include "wstring/wstring.h"
+#include "head.h"
+
+static const char *wr_file_name[MATH_WR_FILES] = {
+	MATH_POSTING_FNAME,
+	PATH_INFO_FNAME,
+	MATH_POSTING_SKP_FNAME
+};
+
+static const char *
+ent_file_name(struct math_wr_cache_ent *ent, enum math_wr_file i)
+{
+	if (ent->blk && i == MATH_WR_FILE_POSTING)
+		return MATH_POSTING_BLK_FNAME;
+	else
+		return wr_file_name[i];
+}
+
+static uint64_t file_size(const char *path, const char *fname)
+{
+	struct stat s;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	sprintf(file_path, "%s/%s", path, fname);
+
+	if (0 == stat(file_path, &s))
+		return (uint64_t)s.st_size;
+	else
+		return 0;
+}
+
+/* move a list node to the tail (most recently used) of LRU list */
+static void lru_touch(list *lru, struct list_node *ln)
+{
+	list_detach_one(ln, lru, NULL, NULL);
+	LIST_NODE_CONS(*ln);
+	list_insert_one_at_tail(ln, lru, NULL, NULL);
+}
+
+struct math_wr_cache *math_wr_cache_new(void)
+{
+	struct math_wr_cache *cache = malloc(sizeof(struct math_wr_cache));
+
+	cache->bucket = calloc(MATH_WR_CACHE_BUCKETS,
+	                       sizeof(struct math_wr_cache_ent*));
+	LIST_CONS(cache->ent_lru);
+	LIST_CONS(cache->fh_lru);
+	cache->n_ents = 0;
+	cache->n_open = 0;
+	cache->buf_bytes = 0;
+
+	return cache;
+}
+
+/*
+ * file handle functions
+ */
+static void
+close_ent_files(struct math_wr_cache *cache, struct math_wr_cache_ent *ent)
+{
+	int i;
+	bool opened = 0;
+
+	for (i = 0; i < MATH_WR_FILES; i++) {
+		if (ent->fh[i]) {
+			fclose(ent->fh[i]);
+			ent->fh[i] = NULL;
+			opened = 1;
+		}
+	}
+
+	if (opened) {
+		list_detach_one(&ent->fh_ln, &cache->fh_lru, NULL, NULL);
+		cache->n_open --;
+	}
+}
+
+static FILE *
+open_ent_file(struct math_wr_cache *cache, struct math_wr_cache_ent *ent,
+              enum math_wr_file i)
+{
+	int j;
+	struct math_wr_cache_ent *victim;
+	bool opened = 0;
+	char file_path[MAX_DIR_PATH_NAME_LEN];
+	sprintf(file_path, "%s/%s", ent->path, ent_file_name(ent, i));
+
+	for (j = 0; j < MATH_WR_FILES; j++)
+		if (ent->fh[j])
+			opened = 1;
+
+	if (!opened && cache->n_open >= MATH_WR_CACHE_MAX_OPEN) {
+		/* close the least recently used handles */
+		victim = MEMBER_2_STRUCT(cache->fh_lru.now,
+		                         struct math_wr_cache_ent, fh_ln);
+		close_ent_files(cache, victim);
+	}
+
+	ent->fh[i] = fopen(file_path, "a");
+	if (ent->fh[i] == NULL) {
+		fprintf(stderr, "math wr-cache: cannot open %s\n", file_path);
+		return NULL;
+	}
+
+	/* we have our own buffer, let fwrite() go to disk directly */
+	setvbuf(ent->fh[i], NULL, _IONBF, 0);
+
+	if (opened) {
+		lru_touch(&cache->fh_lru, &ent->fh_ln);
+	} else {
+		LIST_NODE_CONS(ent->fh_ln);
+		list_insert_one_at_tail(&ent->fh_ln, &cache->fh_lru, NULL, NULL);
+		cache->n_open ++;
+	}
+
+	return ent->fh[i];
+}
+
+/*
+ * buffer functions
+ */
+static int
+write_out(struct math_wr_cache *cache, struct math_wr_cache_ent *ent,
+          enum math_wr_file i)
+{
+	size_t wr, n = ent->buf_sz[i];
+	FILE *skp_fh = NULL;
+
+	if (n == 0)
+		return 0;
+
+	if (ent->fh[i] == NULL) {
+		if (NULL == open_ent_file(cache, ent, i))
+			return -1;
+	} else {
+		lru_touch(&cache->fh_lru, &ent->fh_ln);
+	}
+
+#ifdef DEBUG_MATH_WR_CACHE
+	printf("wr-cache: write out %lu bytes @ %s/%s\n", n,
+	       ent->path, ent_file_name(ent, i));
+#endif
+	if (ent->blk && i == MATH_WR_FILE_POSTING) {
+		/* skip entries of blocks go directly to skip file */
+		if (ent->skp) {
+			skp_fh = ent->fh[MATH_WR_FILE_SKIP];
+			if (skp_fh == NULL)
+				skp_fh = open_ent_file(cache, ent, MATH_WR_FILE_SKIP);
+		}
+
+		/* file_sz[i] is the offset of blocks to be written */
+		if (math_posting_blk_write(ent->fh[i], skp_fh,
+		        (struct math_posting_item*)ent->buf[i],
+		        n / sizeof(struct math_posting_item), NULL,
+		        ent->file_sz + i)) {
+			fprintf(stderr, "math wr-cache: write error @ %s\n", ent->path);
+			return -1;
+		}
+	} else if (n != (wr = fwrite(ent->buf[i], 1, n, ent->fh[i]))) {
+		/* keep the bytes not written */
+		memmove(ent->buf[i], ent->buf[i] + wr, n - wr);
+		ent->buf_sz[i] = n - wr;
+
+		fprintf(stderr, "math wr-cache: write error @ %s\n", ent->path);
+		return -1;
+	}
+
+	ent->buf_sz[i] = 0;
+	return 0;
+}
+
+/* release buffers written out, a buffer failed to be written is kept */
+static int
+release_bufs(struct math_wr_cache *cache, struct math_wr_cache_ent *ent)
+{
+	int i, ret = 0;
+	for (i = 0; i < MATH_WR_FILES; i++) {
+		if (write_out(cache, ent, i)) {
+			ret = -1;
+			continue;
+		}
+
+		free(ent->buf[i]);
+		cache->buf_bytes -= ent->buf_cap[i];
+
+		ent->buf[i] = NULL;
+		ent->buf_cap[i] = 0;
+	}
+
+	return ret;
+}
+
+static int relieve_mem_pressure(struct math_wr_cache *cache)
+{
+	struct list_node *ln = cache->ent_lru.now;
+	struct math_wr_cache_ent *ent;
+	int ret = 0;
+
+	/* release buffers from the least recently used entries */
+	while (cache->buf_bytes > MATH_WR_CACHE_MAX_BUF_BYTES / 2) {
+		ent = MEMBER_2_STRUCT(ln, struct math_wr_cache_ent, ent_ln);
+		if (release_bufs(cache, ent))
+			ret = -1;
+
+		ln = ln->next;
+		if (ln == cache->ent_lru.now)
+			break;
+	}
+
+	return ret;
+}
+
+/*
+ * entry functions
+ */
+static void
+free_ent(struct math_wr_cache *cache, struct math_wr_cache_ent *ent)
+{
+	struct math_wr_cache_ent **p;
+	uint32_t b = ent->hash % MATH_WR_CACHE_BUCKETS;
+	int i;
+
+	close_ent_files(cache, ent);
+
+	for (i = 0; i < MATH_WR_FILES; i++) {
+		free(ent->buf[i]);
+		cache->buf_bytes -= ent->buf_cap[i];
+	}
+
+	/* unlink from hash bucket */
+	for (p = cache->bucket + b; *p != ent; p = &(*p)->hash_next);
+	*p = ent->hash_next;
+
+	list_detach_one(&ent->ent_ln, &cache->ent_lru, NULL, NULL);
+	cache->n_ents --;
+
+	free(ent->path);
+	free(ent);
+}
+
+/* evict an entry, it is kept if its buffers cannot be written out */
+static int
+evict_ent(struct math_wr_cache *cache, struct math_wr_cache_ent *ent)
+{
+	if (release_bufs(cache, ent))
+		return -1;
+
+	free_ent(cache, ent);
+	return 0;
+}
+
+struct math_wr_cache_ent *
+math_wr_cache_get(struct math_wr_cache *cache, const char *path)
+{
+	int i;
+	struct math_wr_cache_ent *ent, *victim;
+	uint32_t h = str_hash(path);
+	uint32_t b = h % MATH_WR_CACHE_BUCKETS;
+
+	for (ent = cache->bucket[b]; ent != NULL; ent = ent->hash_next) {
+		if (ent->hash == h && 0 == strcmp(ent->path, path)) {
+			lru_touch(&cache->ent_lru, &ent->ent_ln);
+			return ent;
+		}
+	}
+
+	/* not cached, evict the least recently used entry if full (if it
+	 * fails to be written out, cache grows and it is retried later) */
+	if (cache->n_ents >= MATH_WR_CACHE_MAX_ENTS) {
+		victim = MEMBER_2_STRUCT(cache->ent_lru.now,
+		                         struct math_wr_cache_ent, ent_ln);
+		evict_ent(cache, victim);
+	}
+
+	/* make sure directory exists, only once for each new entry */
+	mkdir_p(path);
+
+	ent = malloc(sizeof(struct math_wr_cache_ent));
+	ent->path = strdup(path);
+	ent->hash = h;
+	ent->blk = math_posting_blk_writable(path);
+	ent->skp = math_posting_skip_writable(path, ent->blk);
+
+	for (i = 0; i < MATH_WR_FILES; i++) {
+		ent->buf[i] = NULL;
+		ent->buf_sz[i] = 0;
+		ent->buf_cap[i] = 0;
+		ent->fh[i] = NULL;
+		ent->file_sz[i] = file_size(path, ent_file_name(ent, i));
+	}
+
+	ent->hash_next = cache->bucket[b];
+	cache->bucket[b] = ent;
+
+	LIST_NODE_CONS(ent->ent_ln);
+	LIST_NODE_CONS(ent->fh_ln);
+	list_insert_one_at_tail(&ent->ent_ln, &cache->ent_lru, NULL, NULL);
+	cache->n_ents ++;
+
+	return ent;
+}
+
+int math_wr_cache_append(struct math_wr_cache *cache, const char *path,
+                         enum math_wr_file i, const void *data, size_t n)
+{
+	size_t new_cap;
+	struct math_posting_skip skip;
+	struct math_wr_cache_ent *ent = math_wr_cache_get(cache, path);
+
+	/* write out if this append overflows entry buffer */
+	if (ent->buf_sz[i] + n > MATH_WR_CACHE_ENT_BUF_SZ)
+		if (write_out(cache, ent, i))
+			return -1;
+
+	/* grow entry buffer if necessary */
+	if (ent->buf_sz[i] + n > ent->buf_cap[i]) {
+		new_cap = (ent->buf_cap[i]) ? ent->buf_cap[i] : 64;
+		while (new_cap < ent->buf_sz[i] + n)
+			new_cap = new_cap << 1;
+
+		ent->buf[i] = realloc(ent->buf[i], new_cap);
+		cache->buf_bytes += new_cap - ent->buf_cap[i];
+		ent->buf_cap[i] = new_cap;
+	}
+
+	memcpy(ent->buf[i] + ent->buf_sz[i], data, n);
+	ent->buf_sz[i] += n;
+
+	/* block sizes are only known upon write out */
+	if (!ent->blk || i != MATH_WR_FILE_POSTING)
+		ent->file_sz[i] += n;
+
+	/* add skip entry for every full read chunk of raw posting */
+	if (i == MATH_WR_FILE_POSTING && !ent->blk && ent->skp &&
+	    ent->file_sz[i] % MATH_POSTING_SKIP_RAW_BYTES == 0) {
+		skip.max_id = *(uint64_t*)data;
+		skip.offset = ent->file_sz[i] - MATH_POSTING_SKIP_RAW_BYTES;
+		math_wr_cache_append(cache, path, MATH_WR_FILE_SKIP,
+		                     &skip, sizeof(struct math_posting_skip));
+	}
+
+	if (cache->buf_bytes > MATH_WR_CACHE_MAX_BUF_BYTES)
+		return relieve_mem_pressure(cache);
+
+	return 0;
+}
+
+uint64_t math_wr_cache_file_sz(struct math_wr_cache *cache,
+                               const char *path, enum math_wr_file i)
+{
+	struct math_wr_cache_ent *ent = math_wr_cache_get(cache, path);
+	return ent->file_sz[i];
+}
+
+int math_wr_cache_flush(struct math_wr_cache *cache)
+{
+	int i, ret = 0;
+	struct list_node *ln = cache->ent_lru.now;
+	struct math_wr_cache_ent *ent;
+
+	if (ln == NULL)
+		return 0;
+
+	do {
+		ent = MEMBER_2_STRUCT(ln, struct math_wr_cache_ent, ent_ln);
+		for (i = 0; i < MATH_WR_FILES; i++)
+			if (write_out(cache, ent, i))
+				ret = -1;
+
+		ln = ln->next;
+	} while (ln != cache->ent_lru.now);
+
+	return ret;
+}
+
+int math_wr_cache_free(struct math_wr_cache *cache)
+{
+	struct math_wr_cache_ent *ent;
+	int ret = 0;
+
+	while (cache->ent_lru.now) {
+		ent = MEMBER_2_STRUCT(cache->ent_lru.now,
+		                      struct math_wr_cache_ent, ent_ln);
+		/* nothing else can be done with what is not written */
+		if (release_bufs(cache, ent))
+			ret = -1;
+
+		free_ent(cache, ent);
+	}
+
+	free(cache->bucket);
+	free(cache);
+	return ret;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "list/list.h"
+
+/*
+ * math index write cache: keeps per-path append buffers and
+ * a bounded LRU of open file handles, so that indexing does
+ * not open/close files for every single posting item.
+ */
+enum math_wr_file {
+	MATH_WR_FILE_POSTING,
+	MATH_WR_FILE_PATHINFO,
+	MATH_WR_FILE_SKIP,
+	MATH_WR_FILES
+};
+
+struct math_wr_cache_ent {
+	char            *path;
+	uint32_t         hash;
+
+	/* append buffers (not yet written to disk) */
+	char            *buf[MATH_WR_FILES];
+	size_t           buf_sz[MATH_WR_FILES];
+	size_t           buf_cap[MATH_WR_FILES];
+
+	/* file handles, opened lazily upon flush */
+	FILE            *fh[MATH_WR_FILES];
+
+	/* on-disk plus buffered sizes, tracked in memory
+	 * (on-disk size only for a block-compressed posting) */
+	uint64_t         file_sz[MATH_WR_FILES];
+
+	/* write posting in block-compressed format */
+	bool             blk;
+
+	/* maintain posting skip table */
+	bool             skp;
+
+	struct math_wr_cache_ent *hash_next;
+	struct list_node ent_ln; /* LRU of cached entries */
+	struct list_node fh_ln;  /* LRU of entries with open handles */
+};
+
+struct math_wr_cache {
+	struct math_wr_cache_ent **bucket;
+	list      ent_lru, fh_lru;
+	uint32_t  n_ents, n_open;
+	uint64_t  buf_bytes;
+};
+
+struct math_wr_cache *math_wr_cache_new(void);
+
+/* flush everything and release the cache, return -1 if anything failed
+ * to be written (it is dropped then). */
+int math_wr_cache_free(struct math_wr_cache*);
+
+/* get the cache entry of a path directory, the directory is
+ * created (if necessary) when the entry is first created. */
+struct math_wr_cache_ent *
+math_wr_cache_get(struct math_wr_cache*, const char*);
+
+/* buffer bytes to append to a path file, return -1 if buffers failed
+ * to be written out (they are kept and written out again later). */
+int math_wr_cache_append(struct math_wr_cache*, const char*,
+                         enum math_wr_file, const void*, size_t);
+
+/* return file size (including buffered bytes) of a path file */
+uint64_t math_wr_cache_file_sz(struct math_wr_cache*, const char*,
+                               enum math_wr_file);
+
+/* write all buffered bytes to disk, return -1 if any write fails (bytes
+ * not written are kept in buffers). */
+int math_wr_cache_flush(struct math_wr_cache*);
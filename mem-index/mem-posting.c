@@ -321,6 +321,27 @@ void mem_posting_finish(void *po_)
 	FREE_BUFFER(po);
 }
 
+struct mem_posting *mem_posting_iter_new(struct mem_posting *po)
+{
+	struct mem_posting *iter = malloc(sizeof(struct mem_posting));
+
+	/* shallow copy, with its own buffer and iterator position */
+	*iter = *po;
+	iter->buf = NULL;
+	iter->buf_end = 0;
+	iter->cur = NULL;
+	iter->buf_idx = 0;
+
+	return iter;
+}
+
+void mem_posting_iter_free(void *iter_)
+{
+	struct mem_posting *iter = (struct mem_posting*)iter_;
+	FREE_BUFFER(iter);
+	free(iter);
+}
+
 position_t *mem_posting_cur_pos_arr(void *po_)
 {
 	struct mem_posting *po = (struct mem_posting*)po_;
@@ -336,3 +357,55 @@ position_t *mem_posting_cur_pos_arr(void *po_)
 
 	return copy;
 }
+
+size_t mem_posting_pack_sz(struct mem_posting *po)
+{
+	struct skippy_node *cur, *save;
+	struct mem_posting_node *node;
+	size_t sz = sizeof(struct mem_posting);
+
+	skippy_foreach(cur, save, &po->skippy, 0) {
+		node = MEMBER_2_STRUCT(cur, struct mem_posting_node, sn);
+		sz += sizeof(struct mem_posting_node) + node->blk_sz;
+	}
+
+	return sz;
+}
+
+struct mem_posting *mem_posting_pack(struct mem_posting *po, char *dst)
+{
+	struct skippy_node *cur, *save;
+	struct mem_posting_node *node, *copy;
+	struct mem_posting *ret = (struct mem_posting*)dst;
+	char *blk;
+
+	/* area layout: posting structure, nodes, blocks */
+	copy = (struct mem_posting_node*)(ret + 1);
+	blk = (char*)(copy + po->n_blk);
+
+	*ret = *po;
+	ret->head = ret->tail = NULL;
+	ret->n_blk = 0;
+	ret->tot_sz = sizeof(struct mem_posting);
+	skippy_init(&ret->skippy, po->skippy.n_spans);
+	ret->buf = NULL;
+	ret->buf_end = 0;
+	ret->cur = NULL;
+	ret->buf_idx = 0;
+
+	/* append copied nodes, which rebuilds skip-list in the area */
+	skippy_foreach(cur, save, &po->skippy, 0) {
+		node = MEMBER_2_STRUCT(cur, struct mem_posting_node, sn);
+
+		skippy_node_init(&copy->sn, node->sn.key);
+		copy->blk = blk;
+		copy->blk_sz = node->blk_sz;
+		memcpy(blk, node->blk, node->blk_sz);
+
+		append_node(ret, copy);
+		blk += node->blk_sz;
+		copy ++;
+	}
+
+	return ret;
+}
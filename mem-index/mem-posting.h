@@ -64,4 +64,16 @@ uint64_t mem_posting_cur_item_id(void*);
 bool  mem_posting_jump(void*, uint64_t);
 void  mem_posting_finish(void*);
 
+/* a completed posting list can be iterated by concurrent readers,
+ * each through its own iterator (sharing blocks of the list) */
+struct mem_posting *mem_posting_iter_new(struct mem_posting*);
+void  mem_posting_iter_free(void*); /* finish and free an iterator */
+
+/* copy a completed posting list into a single memory area of the
+ * returned size, e.g. a shared memory map. The packed list must not be
+ * written or freed by mem_posting_free(), it is iterated through
+ * mem_posting_iter_new(). */
+size_t mem_posting_pack_sz(struct mem_posting*);
+struct mem_posting *mem_posting_pack(struct mem_posting*, char*);
+
 position_t *mem_posting_cur_pos_arr(void*);
@@ -123,7 +123,8 @@ print_current:
 
 static void run_testcase(enum test_option opt)
 {
-	struct mem_posting *po;
+	struct mem_posting *po, *iter;
+	char *area;
 	srand(time(NULL));
 
 	switch (opt) {
@@ -146,6 +147,15 @@ static void run_testcase(enum test_option opt)
 
 	test_iterator(po, opt);
 
+	/* iterate packed copy of the list */
+	printf("packed copy:\n");
+	area = malloc(mem_posting_pack_sz(po));
+	iter = mem_posting_iter_new(mem_posting_pack(po, area));
+	mem_posting_print_info(iter);
+	test_iterator(iter, opt);
+	mem_posting_iter_free(iter);
+	free(area);
+
 	mem_posting_free(po);
 	printf("\n");
 }
@@ -4,6 +4,14 @@
 static int64_t unfree = 0;
 static int64_t tot_allocs = 0;
 
+/* counters are updated atomically for multi-threaded programs */
+#define COUNT_ALLOC() \
+	__sync_add_and_fetch(&unfree, 1); \
+	__sync_add_and_fetch(&tot_allocs, 1)
+
+#define COUNT_FREE() \
+	__sync_sub_and_fetch(&unfree, 1)
+
 int64_t mhook_unfree()
 {
 	return unfree;
@@ -28,8 +36,7 @@ void *__wrap_malloc(size_t c)
 	void *p = __real_malloc(c);
 
 	if (p) {
-		unfree++;
-		tot_allocs++;
+		COUNT_ALLOC();
 	}
 
 	return p;
@@ -43,8 +50,7 @@ void *__wrap_calloc(size_t nmemb, size_t size)
 	void *p = __real_calloc(nmemb, size);
 
 	if (p) {
-		unfree++;
-		tot_allocs++;
+		COUNT_ALLOC();
 	}
 
 	return p;
@@ -56,10 +62,9 @@ void *__real_realloc(void *, size_t);
 void *__wrap_realloc(void *ptr, size_t sz)
 {
 	if (ptr == NULL) {
-		unfree++;
-		tot_allocs++;
+		COUNT_ALLOC();
 	} else if (sz == 0) {
-		unfree--;
+		COUNT_FREE();
 	}
 
 	return __real_realloc(ptr, sz);
@@ -73,8 +78,7 @@ void *__wrap_strdup(const char *s)
 	void *p = __real_strdup(s);
 
 	if (p) {
-		unfree++;
-		tot_allocs++;
+		COUNT_ALLOC();
 	}
 
 	return p;
@@ -86,7 +90,7 @@ void __real_free(void*);
 void __wrap_free(void *p)
 {
 	if (p)
-		unfree--;
+		COUNT_FREE();
 
 	__real_free(p);
 }
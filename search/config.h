@@ -12,6 +12,9 @@
 #define SNIPPET_PADDING    320
 #define MAX_SNIPPET_SZ     8192
 
+/* initial text buffer of a compressed blob, in times of blob size */
+#define BLOB_TEXT_INFLATE_RATIO 8
+
 //#define DEBUG_SNIPPET
 
 //#define DEBUG_POST_MERGE
@@ -24,6 +27,9 @@
 #define MNC_SMALL_BITMAP
 */
 
+/* use AVX2 mark-and-cross kernel when CPU supports it */
+#define MNC_ENABLE_AVX2
+
 //#define DEBUG_MATH_EXPR_SEARCH
 
 #define RANK_SET_DEFAULT_VOL 155
@@ -71,7 +71,7 @@ static LIST_IT_CALLBK(assign_path_id_in_order)
 	LIST_OBJ(struct subpath, sp, ln);
 	P_CAST(new_path_id, uint32_t, pa_extra);
 
-	/* assign path_id in order, from 1 to maximum 64. */
+	/* assign path_id in order, from 1 to maximum MAX_SUBPATH_ID. */
 	sp->path_id = ++(*new_path_id);
 
 	LIST_GO_OVER;
@@ -80,24 +80,26 @@ static LIST_IT_CALLBK(assign_path_id_in_order)
 static LIST_IT_CALLBK(push_query_path)
 {
 	LIST_OBJ(struct subpath, sp, ln);
+	P_CAST(mnc, struct mnc_ctx, pa_extra);
 	struct mnc_ref mnc_ref;
 
 	mnc_ref.sym = sp->lf_symbol_id;
-	mnc_push_qry(mnc_ref);
+	mnc_push_qry(mnc, mnc_ref);
 
 	LIST_GO_OVER;
 }
 
-static void prepare_score_struct(struct subpaths *subpaths)
+static void
+prepare_score_struct(struct mnc_ctx *mnc, struct subpaths *subpaths)
 {
 	/* initialize 'mark and cross' query dimension */
-	mnc_reset_qry();
+	mnc_reset_qry(mnc);
 
 	/* push queries to MNC stack for future scoring */
-	list_foreach(&subpaths->li, &push_query_path, NULL);
+	list_foreach(&subpaths->li, &push_query_path, mnc);
 }
 
-static int prepare_math_qry(struct subpaths *subpaths)
+static int prepare_math_qry(struct mnc_ctx *mnc, struct subpaths *subpaths)
 {
 	struct list_sort_arg sort_arg;
 	uint32_t new_path_id = 0;
@@ -118,7 +120,7 @@ static int prepare_math_qry(struct subpaths *subpaths)
 	list_foreach(&subpaths->li, &assign_path_id_in_order, &new_path_id);
 
 	/* prepare score structure for query subpaths */
-	prepare_score_struct(subpaths);
+	prepare_score_struct(mnc, subpaths);
 
 	return 0;
 }
@@ -144,6 +146,7 @@ struct on_dir_merge_args {
 	struct postmerge_callbks   *calls;
 	uint32_t                    n_dir_visits;
 	void                       *expr_srch_arg;
+	struct mnc_ctx             *mnc;
 	int64_t                     n_tot_rd_items;
 };
 
@@ -182,6 +185,7 @@ on_dir_merge(math_posting_t postings[MAX_MATH_PATHS], uint32_t n_postings,
 	mes_arg.n_dir_visits    = on_dm_args->n_dir_visits;
 	mes_arg.stop_dir_search = 0;
 	mes_arg.expr_srch_arg   = on_dm_args->expr_srch_arg;
+	mes_arg.mnc             = on_dm_args->mnc;
 
 	res = posting_merge(pm, POSTMERGE_OP_AND,
 	                    on_dm_args->post_on_merge, &mes_arg);
@@ -212,6 +216,8 @@ int64_t math_expr_search(math_index_t mi, char *tex,
 	struct postmerge         pm;
 	struct on_dir_merge_args on_dm_args;
 	struct postmerge_callbks calls;
+	struct mnc_ctx          *mnc;
+	int64_t                  n_tot_rd_items;
 
 	calls.start = &math_posting_start;
 	calls.finish = &math_posting_finish;
@@ -228,8 +234,9 @@ int64_t math_expr_search(math_index_t mi, char *tex,
 		printf("before prepare_math_qry():\n");
 		subpaths_print(&parse_ret.subpaths, stdout);
 #endif
-		/* prepare math query */
-		prepare_math_qry(&parse_ret.subpaths);
+		/* prepare math query and its scoring context */
+		mnc = mnc_ctx_new();
+		prepare_math_qry(mnc, &parse_ret.subpaths);
 
 #ifdef DEBUG_MATH_EXPR_SEARCH
 		printf("after prepare_math_qry():\n");
@@ -247,14 +254,18 @@ int64_t math_expr_search(math_index_t mi, char *tex,
 		on_dm_args.calls = &calls;
 		on_dm_args.n_dir_visits = 0;
 		on_dm_args.expr_srch_arg = args;
+		on_dm_args.mnc = mnc;
 		on_dm_args.n_tot_rd_items = 0;
 
 		math_index_dir_merge(mi, dir_merge_type, &parse_ret.subpaths,
 		                     &on_dir_merge, &on_dm_args);
 
+		n_tot_rd_items = on_dm_args.n_tot_rd_items;
+
 		subpaths_release(&parse_ret.subpaths);
+		mnc_ctx_free(mnc);
 
-		return on_dm_args.n_tot_rd_items;
+		return n_tot_rd_items;
 	} else {
 #ifdef DEBUG_MATH_EXPR_SEARCH
 		printf("parser error: %s\n", parse_ret.msg);
@@ -277,7 +288,7 @@ math_expr_sim(mnc_score_t mnc_score,
 }
 
 struct math_expr_score_res
-math_expr_score_on_merge(struct postmerge* pm,
+math_expr_score_on_merge(struct mnc_ctx *mnc, struct postmerge* pm,
                          uint32_t level, uint32_t n_qry_lr_paths)
 {
 	uint32_t                    i, j, k;
@@ -293,7 +304,7 @@ math_expr_score_on_merge(struct postmerge* pm,
 	/* reset mnc for scoring new document */
 	uint32_t slot;
 	struct mnc_ref mnc_ref;
-	mnc_reset_docs();
+	mnc_reset_docs(mnc);
 
 	for (i = 0; i < pm->n_postings; i++) {
 		/* for each merged posting item from posting lists */
@@ -333,14 +344,14 @@ math_expr_score_on_merge(struct postmerge* pm,
 
 			/* preparing to score corresponding document subpaths */
 			mnc_ref.sym = pathinfo->lf_symb;
-			slot = mnc_map_slot(mnc_ref);
+			slot = mnc_map_slot(mnc, mnc_ref);
 
 			for (k = 0; k <= subpath_ele->dup_cnt; k++) {
 				/*
 				 * add this document subpath for scoring.
-				 * (path_id [1, 64] is mapped to [0, 63])
+				 * (path_id [1, 255] is mapped to [0, 254])
 				 */
-				mnc_doc_add_rele(slot, pathinfo->path_id - 1,
+				mnc_doc_add_rele(mnc, slot, pathinfo->path_id - 1,
 				                 subpath_ele->dup[k]->path_id - 1);
 			}
 		}
@@ -355,7 +366,7 @@ math_expr_score_on_merge(struct postmerge* pm,
 	/* finally calculate expression similarity score */
 	if (!skipped && pm->n_postings != 0) {
 		ret.score = math_expr_sim(
-		                mnc_score(), level,
+		                mnc_score(mnc), level,
 		                pathinfo_pack->n_lr_paths - n_qry_lr_paths
 		            );
 		ret.doc_id = po_item->doc_id;
@@ -11,6 +11,7 @@ struct math_extra_score_arg {
 	uint32_t n_dir_visits;
 	bool     stop_dir_search;
 	void    *expr_srch_arg;
+	struct mnc_ctx *mnc; /* scoring context of this query */
 };
 
 #pragma pack(push, 1)
@@ -29,4 +30,5 @@ int64_t math_expr_search(math_index_t, char*, enum dir_merge_type,
 /* call this function in posting merge callback to score merged item
  * similarity compared with math query. */
 struct math_expr_score_res
-math_expr_score_on_merge(struct postmerge*, uint32_t, uint32_t);
+math_expr_score_on_merge(struct mnc_ctx*, struct postmerge*,
+                         uint32_t, uint32_t);
@@ -123,7 +123,7 @@ math_posting_on_merge(uint64_t cur_min, struct postmerge* pm,
 	P_CAST(msca, math_score_combine_args_t, mesa->expr_srch_arg);
 
 	/* calculate expression similarity on merge */
-	res = math_expr_score_on_merge(pm, mesa->dir_merge_level,
+	res = math_expr_score_on_merge(mesa->mnc, pm, mesa->dir_merge_level,
 	                               mesa->n_qry_lr_paths);
 
 	/* math expression with zero score is filtered. */
@@ -7,6 +7,7 @@
  * https://github.com/tkhost/tkhost.github.io/tree/master/opmes
  */
 
+#include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -23,6 +24,13 @@
 #include "config.h"
 #include "mnc-score.h"
 
+/* vectorized kernel requires 64-bit slots */
+#if defined(MNC_ENABLE_AVX2) && defined(__x86_64__) && \
+    defined(__GNUC__) && !defined(MNC_SMALL_BITMAP)
+#define MNC_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
 /* byte printing macros */
 #define BYTE_STR_FMT "%d%d%d%d%d%d%d%d"
 
@@ -36,38 +44,25 @@
 	(_byte & 0x02 ? 1 : 0), \
 	(_byte & 0x01 ? 1 : 0)
 
-/* define max number of slots (bound variables) */
-#define MAX_DOC_UNIQ_SYM MAX_SUBPATH_ID
-
-#ifdef MNC_SMALL_BITMAP
-/* for debug */
-typedef uint8_t  mnc_slot_t;
-#define MNC_SLOTS_BYTES 1
-#else
-/* for real */
-typedef uint64_t mnc_slot_t;
-#define MNC_SLOTS_BYTES 8
-#endif
-
 /*
- * statical local variables
+ * context functions
  */
+struct mnc_ctx *mnc_ctx_new(void)
+{
+	/* bitmaps and sub-scores are assumed to be zeros initially */
+	struct mnc_ctx *ctx = calloc(1, sizeof(struct mnc_ctx));
 
-/* query expression ordered subpaths/symbols list */
-symbol_id_t     qry_sym[MAX_SUBPATH_ID];
-uint32_t        n_qry_syms;
-
-/* document expression unique symbols list */
-symbol_id_t     doc_uniq_sym[MAX_DOC_UNIQ_SYM];
-uint32_t        n_doc_uniq_syms;
+	ctx->rele_stride = MNC_DEFAULT_SLOTS;
 
-/* query / document bitmaps (assume all zeros in BSS segment) */
-mnc_slot_t      doc_mark_bitmap[MAX_DOC_UNIQ_SYM];
-mnc_slot_t      doc_cross_bitmap[MAX_DOC_UNIQ_SYM];
-mnc_slot_t      relevance_bitmap[MAX_SUBPATH_ID][MAX_DOC_UNIQ_SYM];
+	/* select scoring kernel for this CPU */
+	ctx->use_avx2 = mnc_avx2_supported();
+	return ctx;
+}
 
-/* query / document slot sub-scores (assume all zero in BSS segment) */
-mnc_score_t     doc_uniq_sym_score[MAX_DOC_UNIQ_SYM];
+void mnc_ctx_free(struct mnc_ctx *ctx)
+{
+	free(ctx);
+}
 
 /*
  * implementation functions
@@ -75,24 +70,53 @@ mnc_score_t     doc_uniq_sym_score[MAX_DOC_UNIQ_SYM];
 
 /* push query (should be pushed in the order of query path symbol) */
 void
-mnc_push_qry(struct mnc_ref qry_path_ref)
+mnc_push_qry(struct mnc_ctx *ctx, struct mnc_ref qry_path_ref)
 {
-	qry_sym[n_qry_syms ++] = qry_path_ref.sym;
+	ctx->qry_sym[ctx->n_qry_syms ++] = qry_path_ref.sym;
+}
+
+/* re-layout relevance rows to hold MAX_DOC_UNIQ_SYM slots */
+static void widen_rele_rows(struct mnc_ctx *ctx)
+{
+	uint32_t w, i, old_stride = ctx->rele_stride;
+	size_t row_sz = sizeof(mnc_slot_t) * old_stride;
+	mnc_slot_t *rows = malloc(row_sz * ctx->n_slot_words * ctx->n_qry_syms);
+
+	/* save and clear rows in current layout */
+	for (w = 0; w < ctx->n_slot_words; w++) {
+		for (i = 0; i < ctx->n_qry_syms; i++) {
+			mnc_slot_t *row = MNC_RELE_ROW(ctx, w, i);
+			memcpy(rows + (w * ctx->n_qry_syms + i) * old_stride, row, row_sz);
+			memset(row, 0, row_sz);
+		}
+	}
+
+	ctx->rele_stride = MAX_DOC_UNIQ_SYM;
+
+	for (w = 0; w < ctx->n_slot_words; w++)
+		for (i = 0; i < ctx->n_qry_syms; i++)
+			memcpy(MNC_RELE_ROW(ctx, w, i),
+			       rows + (w * ctx->n_qry_syms + i) * old_stride, row_sz);
+
+	free(rows);
 }
 
 /* return slot index that this document path belongs */
-uint32_t mnc_map_slot(struct mnc_ref doc_path_ref)
+uint32_t mnc_map_slot(struct mnc_ctx *ctx, struct mnc_ref doc_path_ref)
 {
 	uint32_t i;
 	/* find the symbol slot to which doc_path belongs. */
-	for (i = 0; i < n_doc_uniq_syms; i++)
-		if (doc_uniq_sym[i] == doc_path_ref.sym)
+	for (i = 0; i < ctx->n_doc_uniq_syms; i++)
+		if (ctx->doc_uniq_sym[i] == doc_path_ref.sym)
 			break;
 
 	/* not found, append a new slot and add the doc_path */
-	if (i == n_doc_uniq_syms) {
-		doc_uniq_sym[i] = doc_path_ref.sym;
-		n_doc_uniq_syms ++;
+	if (i == ctx->n_doc_uniq_syms) {
+		if (i == ctx->rele_stride)
+			widen_rele_rows(ctx);
+
+		ctx->doc_uniq_sym[i] = doc_path_ref.sym;
+		ctx->n_doc_uniq_syms ++;
 	}
 
 	return i;
@@ -100,16 +124,34 @@ uint32_t mnc_map_slot(struct mnc_ref doc_path_ref)
 
 /* set the corresponding bit to indicate relevance between two paths */
 void
-mnc_doc_add_rele(uint32_t slot, uint32_t doc_path, uint32_t qry_path)
+mnc_doc_add_rele(struct mnc_ctx *ctx,
+                 uint32_t slot, uint32_t doc_path, uint32_t qry_path)
 {
+	uint32_t word = doc_path / MNC_SLOT_BITS;
 	mnc_slot_t bit = 1;
-	bit = bit << doc_path;
-	relevance_bitmap[qry_path][slot] |= bit;
+	bit = bit << (doc_path % MNC_SLOT_BITS);
+	MNC_RELE_ROW(ctx, word, qry_path)[slot] |= bit;
+	ctx->rele_dirty = 1;
+
+	/* bitmaps are only processed up to the highest plane in use */
+	if (word >= ctx->n_slot_words)
+		ctx->n_slot_words = word + 1;
 }
 
 /*
  * print functions for debug
  */
+static void print_slot(char *byte);
+
+/* print all word planes of a slot, highest plane first */
+static void
+print_wide_slot(struct mnc_ctx *ctx, mnc_slot_t *plane0, size_t stride)
+{
+	int w;
+	for (w = ctx->n_slot_words - 1; w >= 0; w--)
+		print_slot((char*)(plane0 + w * stride));
+}
+
 static void print_slot(char *byte)
 {
 	int i;
@@ -122,61 +164,64 @@ static void print_slot(char *byte)
 #define _MAX_SYMBOL_STR_LEN 7
 
 #define _PADDING_SPACE \
-	if (i != n_doc_uniq_syms - 1) \
+	if (i != ctx->n_doc_uniq_syms - 1) \
 		for (j = 1; j < MNC_SLOTS_BYTES; j++) \
 			printf("%*c ", 8, ' ');
 
 static void
-mnc_print(int highlight_qry_path, int max_subscore_idx)
+mnc_print(struct mnc_ctx *ctx, int highlight_qry_path, int max_subscore_idx)
 {
 	uint32_t i, j;
-	if (n_doc_uniq_syms == 0)
+	if (ctx->n_doc_uniq_syms == 0)
 		goto print_bitmap;
 
 	/* print scores */
 	printf("Max sub-score: %u from doc symbol `%s'\n",
-	       doc_uniq_sym_score[max_subscore_idx],
-	       trans_symbol(doc_uniq_sym[max_subscore_idx]));
+	       ctx->doc_uniq_sym_score[max_subscore_idx],
+	       trans_symbol(ctx->doc_uniq_sym[max_subscore_idx]));
 
 	printf("%*s", _MAX_SYMBOL_STR_LEN, "Score: ");
-	for (i = 0; i < n_doc_uniq_syms; i++) {
-		printf("%-*u ", 8, doc_uniq_sym_score[i]);
+	for (i = 0; i < ctx->n_doc_uniq_syms; i++) {
+		printf("%-*u ", 8, ctx->doc_uniq_sym_score[i]);
 		_PADDING_SPACE;
 	}
 	printf("\n");
 
 	/* print document symbol slots */
 	printf("%*c", _MAX_SYMBOL_STR_LEN, ' ');
-	for (i = 0; i < n_doc_uniq_syms; i++) {
-		printf("%-*s ", 8, trans_symbol(doc_uniq_sym[i]));
+	for (i = 0; i < ctx->n_doc_uniq_syms; i++) {
+		printf("%-*s ", 8, trans_symbol(ctx->doc_uniq_sym[i]));
 		_PADDING_SPACE;
 	}
 	printf("\n");
 
 	/* print mark and cross rows */
 	printf("Cross: ");
-	for (i = 0; i < n_doc_uniq_syms; i++)
-		print_slot((char*)&doc_cross_bitmap[i]);
+	for (i = 0; i < ctx->n_doc_uniq_syms; i++)
+		print_wide_slot(ctx, &ctx->doc_cross_bitmap[0][i],
+		                MAX_DOC_UNIQ_SYM);
 	printf("\n");
 
 	printf("Mark:  ");
-	for (i = 0; i < n_doc_uniq_syms; i++)
-		print_slot((char*)&doc_mark_bitmap[i]);
+	for (i = 0; i < ctx->n_doc_uniq_syms; i++)
+		print_wide_slot(ctx, &ctx->doc_mark_bitmap[0][i],
+		                MAX_DOC_UNIQ_SYM);
 	printf("\n");
 
 print_bitmap:
 
 	/* print main bitmaps */
-	for (i = 0; i < n_qry_syms; i++) {
+	for (i = 0; i < ctx->n_qry_syms; i++) {
 		if ((uint32_t)highlight_qry_path == i)
 			printf("-> %-*s", _MAX_SYMBOL_STR_LEN - 3,
-			       trans_symbol(qry_sym[i]));
+			       trans_symbol(ctx->qry_sym[i]));
 		else
 			printf("%-*s", _MAX_SYMBOL_STR_LEN,
-			       trans_symbol(qry_sym[i]));
+			       trans_symbol(ctx->qry_sym[i]));
 
-		for (j = 0; j < n_doc_uniq_syms; j++)
-			print_slot((char*)&relevance_bitmap[i][j]);
+		for (j = 0; j < ctx->n_doc_uniq_syms; j++)
+			print_wide_slot(ctx, MNC_RELE_ROW(ctx, 0, i) + j,
+			                MAX_SUBPATH_ID * ctx->rele_stride);
 
 		printf("\n");
 	}
@@ -186,33 +231,50 @@ print_bitmap:
  * cleaning functions.
  */
 
+static void clean_bitmaps(struct mnc_ctx*);
+
 /* reset query */
-void mnc_reset_qry()
+void mnc_reset_qry(struct mnc_ctx *ctx)
 {
-	n_qry_syms = 0;
+	/* relevance of a document which is not scored */
+	if (ctx->rele_dirty)
+		clean_bitmaps(ctx);
+
+	ctx->n_qry_syms = 0;
 }
 
 /* reset document */
-void mnc_reset_docs()
+void mnc_reset_docs(struct mnc_ctx *ctx)
 {
-	n_doc_uniq_syms = 0;
+	if (ctx->rele_dirty)
+		clean_bitmaps(ctx);
+
+	ctx->n_doc_uniq_syms = 0;
+	ctx->n_slot_words = 0;
+	ctx->rele_stride = MNC_DEFAULT_SLOTS;
 }
 
-/* clean bitmaps to the n_qry_syms, n_doc_uniq_syms dimension */
-static void clean_bitmaps(void)
+/* clean bitmaps to the n_slot_words, n_qry_syms, n_doc_uniq_syms
+ * dimension */
+static void clean_bitmaps(struct mnc_ctx *ctx)
 {
-	uint32_t i;
+	uint32_t i, w;
 
 	/* No need to clean 'mark bitmap' because cross() function
 	 * already ensures a clean 'mark bitmap' after main function. */
 	// memset(doc_mark_bitmap, 0, sizeof(mnc_slot_t) * n_doc_uniq_syms);
 
-	memset(doc_cross_bitmap, 0, sizeof(mnc_slot_t) * n_doc_uniq_syms);
+	for (w = 0; w < ctx->n_slot_words; w++) {
+		memset(ctx->doc_cross_bitmap[w], 0,
+		       sizeof(mnc_slot_t) * ctx->n_doc_uniq_syms);
 
-	for (i = 0; i < n_qry_syms; i++) {
-		memset(relevance_bitmap[i], 0,
-		       sizeof(mnc_slot_t) * n_doc_uniq_syms);
+		for (i = 0; i < ctx->n_qry_syms; i++) {
+			memset(MNC_RELE_ROW(ctx, w, i), 0,
+			       sizeof(mnc_slot_t) * ctx->n_doc_uniq_syms);
+		}
 	}
+
+	ctx->rele_dirty = 0;
 }
 
 /* return the index of least significant bit position */
@@ -228,14 +290,19 @@ int lsb_pos(uint64_t v)
 /*
  * mark and cross algorithm main functions.
  */
-static __inline mnc_score_t mark(int i, int j)
+static __inline mnc_score_t
+mark(struct mnc_ctx *ctx, int i, int j, const uint32_t n_words)
 {
+	uint32_t   w = 0;
 	mnc_slot_t unmark;
-	mnc_slot_t mark   = doc_mark_bitmap[j];
-	mnc_slot_t cross  = doc_cross_bitmap[j];
 
-	/* get relevance bitmap without marked or crossed bits */
-	unmark = relevance_bitmap[i][j] & ~(mark | cross);
+	do {
+		/* get relevance bitmap without marked or crossed bits */
+		unmark = MNC_RELE_ROW(ctx, w, i)[j] &
+		         ~(ctx->doc_mark_bitmap[w][j] | ctx->doc_cross_bitmap[w][j]);
+
+		/* search higher planes only for a wide slot */
+	} while (unmark == 0 && ++w < n_words);
 
 	/* no relevant bits now */
 	if (unmark == 0)
@@ -243,51 +310,202 @@ static __inline mnc_score_t mark(int i, int j)
 
 	/* extract the lowest set bit (only need to mark one),
 	 * write this mark bit on doc_mark_bitmap */
-	doc_mark_bitmap[j] |= unmark & ~(unmark - 1);
+	ctx->doc_mark_bitmap[w][j] |= unmark & ~(unmark - 1);
 
 	/* return score */
-	if (qry_sym[i] == doc_uniq_sym[j])
+	if (ctx->qry_sym[i] == ctx->doc_uniq_sym[j])
 		return MNC_MARK_SCORE + 1; /* bonus for exact match */
 	else
 		return MNC_MARK_SCORE; /* normal match */
 }
 
-static __inline void cross(int max_slot)
+static __inline void cross(struct mnc_ctx *ctx, int max_slot)
 {
-	/* rule out the document path in the "max" slot */
-	doc_cross_bitmap[max_slot] |= doc_mark_bitmap[max_slot];
+	uint32_t w;
 
-	/* clear 'mark' bitmap */
-	memset(doc_mark_bitmap, 0, sizeof(mnc_slot_t) * n_doc_uniq_syms);
+	for (w = 0; w < ctx->n_slot_words; w++) {
+		/* rule out the document path in the "max" slot */
+		ctx->doc_cross_bitmap[w][max_slot] |=
+			ctx->doc_mark_bitmap[w][max_slot];
+
+		/* clear 'mark' bitmap */
+		memset(ctx->doc_mark_bitmap[w], 0,
+		       sizeof(mnc_slot_t) * ctx->n_doc_uniq_syms);
+	}
 }
 
-mnc_score_t mnc_score()
+/* mark query path i in document slots starting from j, accumulate
+ * slot sub-scores, return false if no slot is marked. Row functions
+ * take the number of word planes, so that they are inlined with a
+ * constant single plane for the common (narrow) case. */
+static __inline __attribute__((always_inline)) bool
+mark_row_planes(struct mnc_ctx *ctx, uint32_t i, uint32_t j,
+                mnc_score_t *max_subscore, uint32_t *max_subscore_idx,
+                const uint32_t n_words)
 {
-	uint32_t i, j, max_subscore_idx = 0;
+	mnc_score_t mark_score;
+	bool marked = false;
+
+	for (; j < ctx->n_doc_uniq_syms; j++) {
+		mark_score = mark(ctx, i, j, n_words);
+
+		if (mark_score != 0) {
+			marked = true;
+			ctx->doc_uniq_sym_score[j] += mark_score;
+			if (ctx->doc_uniq_sym_score[j] > *max_subscore) {
+				*max_subscore = ctx->doc_uniq_sym_score[j];
+				*max_subscore_idx = j;
+			}
+		}
+	}
+
+	return marked;
+}
+
+static bool
+mark_row(struct mnc_ctx *ctx, uint32_t i, uint32_t j,
+         mnc_score_t *max_subscore, uint32_t *max_subscore_idx)
+{
+	if (ctx->n_slot_words <= 1)
+		return mark_row_planes(ctx, i, j, max_subscore,
+		                       max_subscore_idx, 1);
+	else
+		return mark_row_planes(ctx, i, j, max_subscore,
+		                       max_subscore_idx, ctx->n_slot_words);
+}
+
+#ifdef MNC_AVX2_KERNEL
+/* same as mark_row_planes(), but process 4 slots per AVX2 instruction */
+static __inline __attribute__((always_inline, target("avx2"))) bool
+mark_row_avx2_planes(struct mnc_ctx *ctx, uint32_t i,
+                     mnc_score_t *max_subscore, uint32_t *max_subscore_idx,
+                     const uint32_t n_words)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi64x(-1);
+	/* gather low 32 bits of each 64-bit lane */
+	const __m256i lo32 = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+	const __m128i qry_sym = _mm_set1_epi32(ctx->qry_sym[i]);
+	const __m128i mark_score = _mm_set1_epi32(MNC_MARK_SCORE);
+	mnc_score_t *score = ctx->doc_uniq_sym_score;
+	__m256i mark, unmark, nonzero, take, found;
+	__m128i doc_sym, inc, sub_score, blk_max;
+	uint32_t j, w, max;
+	bool marked = false;
+
+	for (j = 0; j + 4 <= ctx->n_doc_uniq_syms; j += 4) {
+		/* slots marked in a lower word plane */
+		found = zero;
+
+		for (w = 0; w < n_words; w++) {
+			mnc_slot_t *mark_bm = ctx->doc_mark_bitmap[w] + j;
+			mnc_slot_t *cross_bm = ctx->doc_cross_bitmap[w] + j;
+			mnc_slot_t *rele = MNC_RELE_ROW(ctx, w, i) + j;
+
+			mark = _mm256_loadu_si256((const __m256i*)mark_bm);
+			unmark = _mm256_andnot_si256(
+				_mm256_or_si256(mark,
+					_mm256_loadu_si256((const __m256i*)cross_bm)),
+				_mm256_loadu_si256((const __m256i*)rele)
+			);
+
+			nonzero = _mm256_xor_si256(
+				_mm256_cmpeq_epi64(unmark, zero), ones);
+			take = _mm256_andnot_si256(found, nonzero);
+			if (_mm256_testz_si256(take, take))
+				continue; /* no relevant bits to mark */
+
+			/* mark the lowest set bit, i.e. unmark & -unmark */
+			_mm256_storeu_si256((__m256i*)mark_bm, _mm256_or_si256(mark,
+				_mm256_and_si256(take, _mm256_and_si256(unmark,
+					_mm256_sub_epi64(zero, unmark)))));
+			found = _mm256_or_si256(found, take);
+		}
+
+		if (_mm256_testz_si256(found, found))
+			continue;
+
+		marked = true;
+
+		/* mark score of each slot, bonus for exact symbol match */
+		doc_sym = _mm_cvtepu16_epi32(
+			_mm_loadl_epi64((const __m128i*)(ctx->doc_uniq_sym + j)));
+		inc = _mm_sub_epi32(mark_score, _mm_cmpeq_epi32(doc_sym, qry_sym));
+		inc = _mm_and_si128(_mm256_castsi256_si128(
+			_mm256_permutevar8x32_epi32(found, lo32)), inc);
+
+		sub_score = _mm_add_epi32(
+			_mm_loadu_si128((const __m128i*)(score + j)), inc);
+		_mm_storeu_si128((__m128i*)(score + j), sub_score);
+
+		/* other slots never exceed max sub-score, so the first slot
+		 * having block maximum is where mark_row() would update. */
+		blk_max = _mm_max_epu32(sub_score,
+			_mm_shuffle_epi32(sub_score, _MM_SHUFFLE(1, 0, 3, 2)));
+		blk_max = _mm_max_epu32(blk_max,
+			_mm_shuffle_epi32(blk_max, _MM_SHUFFLE(2, 3, 0, 1)));
+		max = (uint32_t)_mm_cvtsi128_si32(blk_max);
+
+		if (max > *max_subscore) {
+			*max_subscore = max;
+			*max_subscore_idx = j + __builtin_ctz(_mm_movemask_ps(
+				_mm_castsi128_ps(_mm_cmpeq_epi32(sub_score, blk_max))));
+		}
+	}
+
+	/* remaining slots */
+	if (mark_row_planes(ctx, i, j, max_subscore, max_subscore_idx, n_words))
+		marked = true;
+
+	return marked;
+}
+
+__attribute__((target("avx2"))) static bool
+mark_row_avx2(struct mnc_ctx *ctx, uint32_t i,
+              mnc_score_t *max_subscore, uint32_t *max_subscore_idx)
+{
+	if (ctx->n_slot_words <= 1)
+		return mark_row_avx2_planes(ctx, i, max_subscore,
+		                            max_subscore_idx, 1);
+	else
+		return mark_row_avx2_planes(ctx, i, max_subscore,
+		                            max_subscore_idx, ctx->n_slot_words);
+}
+#endif
+
+bool mnc_avx2_supported(void)
+{
+#ifdef MNC_AVX2_KERNEL
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+mnc_score_t mnc_score(struct mnc_ctx *ctx)
+{
+	const uint32_t n_qry_syms = ctx->n_qry_syms;
+	const symbol_id_t *qry_sym = ctx->qry_sym;
+	uint32_t i, max_subscore_idx = 0;
 	bool early_termination = false;
 
-	mnc_score_t mark_score, total_score = 0;
+	mnc_score_t total_score = 0;
 	mnc_score_t max_subscore = 0;
 
 #ifdef MNC_DEBUG
 	/* print initial state */
-	mnc_print(-1, max_subscore_idx);
+	mnc_print(ctx, -1, max_subscore_idx);
 #endif
 
 	for (i = 0; i < n_qry_syms && !early_termination; i++) {
-		early_termination = true;
-		for (j = 0; j < n_doc_uniq_syms; j++) {
-			mark_score = mark(i, j);
-
-			if (mark_score != 0) {
-				early_termination = false;
-				doc_uniq_sym_score[j] += mark_score;
-				if (doc_uniq_sym_score[j] > max_subscore) {
-					max_subscore = doc_uniq_sym_score[j];
-					max_subscore_idx = j;
-				}
-			}
-		}
+#ifdef MNC_AVX2_KERNEL
+		if (ctx->use_avx2)
+			early_termination = !mark_row_avx2(ctx, i, &max_subscore,
+			                                   &max_subscore_idx);
+		else
+#endif
+			early_termination = !mark_row(ctx, i, 0, &max_subscore,
+			                              &max_subscore_idx);
 
 		if (early_termination || /* early termination */
 		    n_qry_syms == i + 1 || /* this is the final iteration */
@@ -295,10 +513,10 @@ mnc_score_t mnc_score()
 
 #ifdef MNC_DEBUG
 			/* print before cross */
-			mnc_print(i, max_subscore_idx);
+			mnc_print(ctx, i, max_subscore_idx);
 #endif
 
-			cross(max_subscore_idx);
+			cross(ctx, max_subscore_idx);
 
 			/* accumulate into total score */
 			if (early_termination)
@@ -316,20 +534,20 @@ mnc_score_t mnc_score()
 #endif
 
 			/* clean sub-scores */
-			memset(doc_uniq_sym_score, 0,
-			       sizeof(mnc_score_t) * n_doc_uniq_syms);
+			memset(ctx->doc_uniq_sym_score, 0,
+			       sizeof(mnc_score_t) * ctx->n_doc_uniq_syms);
 			max_subscore = 0;
 			max_subscore_idx = 0;
 		}
 #ifdef MNC_DEBUG
 		else {
 			/* print */
-			mnc_print(i, max_subscore_idx);
+			mnc_print(ctx, i, max_subscore_idx);
 			printf("~~~~~~~~~\n");
 		}
 #endif
 	}
 
-	clean_bitmaps();
+	clean_bitmaps(ctx);
 	return total_score;
 }
@@ -1,4 +1,6 @@
 #pragma once
+#include <stdint.h>
+#include <stdbool.h>
 
 /* factors in subpath that contribute to math score */
 struct mnc_ref {
@@ -8,10 +10,74 @@ struct mnc_ref {
 /* math score value type */
 typedef uint32_t mnc_score_t;
 
-void        mnc_reset_qry(void);
-void        mnc_reset_docs(void);
-void        mnc_push_qry(struct mnc_ref);
-uint32_t    mnc_map_slot(struct mnc_ref);
-void        mnc_doc_add_rele(uint32_t, uint32_t, uint32_t);
-mnc_score_t mnc_score(void);
+/* define max number of slots (bound variables) */
+#define MAX_DOC_UNIQ_SYM MAX_SUBPATH_ID
+
+#ifdef MNC_SMALL_BITMAP
+/* for debug */
+typedef uint8_t  mnc_slot_t;
+#define MNC_SLOTS_BYTES 1
+#else
+/* for real */
+typedef uint64_t mnc_slot_t;
+#define MNC_SLOTS_BYTES 8
+#endif
+
+/* a slot holds one bit per document path, wide slots (more than
+ * MNC_SLOT_BITS paths) are split into word planes. */
+#define MNC_SLOT_BITS  (MNC_SLOTS_BYTES * 8)
+#define MNC_SLOT_WORDS ((MAX_SUBPATH_ID + MNC_SLOT_BITS - 1) / MNC_SLOT_BITS)
+
+/* initial slots in a relevance bitmap row */
+#define MNC_DEFAULT_SLOTS 64
+
+/* mark-and-cross scoring state, one context should be used by one
+ * thread at a time (e.g. allocated per query). */
+struct mnc_ctx {
+	/* query expression ordered subpaths/symbols list */
+	symbol_id_t     qry_sym[MAX_SUBPATH_ID];
+	uint32_t        n_qry_syms;
+
+	/* document expression unique symbols list */
+	symbol_id_t     doc_uniq_sym[MAX_DOC_UNIQ_SYM];
+	uint32_t        n_doc_uniq_syms;
+
+	/* word planes in use, i.e. words to hold max document path */
+	uint32_t        n_slot_words;
+
+	/* document bitmaps, [word plane][slot] */
+	mnc_slot_t      doc_mark_bitmap[MNC_SLOT_WORDS][MAX_DOC_UNIQ_SYM];
+	mnc_slot_t      doc_cross_bitmap[MNC_SLOT_WORDS][MAX_DOC_UNIQ_SYM];
+
+	/* relevance bitmap, [word plane][query path][slot] where a row has
+	 * rele_stride slots, see MNC_RELE_ROW(). Rows are widened only for
+	 * documents having more than MNC_DEFAULT_SLOTS unique symbols, so
+	 * that small expressions are scored in a compact bitmap. */
+	uint32_t        rele_stride;
+	bool            rele_dirty; /* relevance added, not yet cleaned */
+	mnc_slot_t      relevance_bitmap[MNC_SLOT_WORDS * MAX_SUBPATH_ID *
+	                                 MAX_DOC_UNIQ_SYM];
+
+	/* query / document slot sub-scores */
+	mnc_score_t     doc_uniq_sym_score[MAX_DOC_UNIQ_SYM];
+
+	/* score by AVX2 kernel, set by mnc_ctx_new() if supported */
+	bool            use_avx2;
+};
+
+#define MNC_RELE_ROW(_ctx, _word, _qry_path) \
+	((_ctx)->relevance_bitmap + \
+	 ((_word) * MAX_SUBPATH_ID + (_qry_path)) * (_ctx)->rele_stride)
+
+/* return a zero-initialized context */
+struct mnc_ctx *mnc_ctx_new(void);
+void            mnc_ctx_free(struct mnc_ctx*);
+
+void        mnc_reset_qry(struct mnc_ctx*);
+void        mnc_reset_docs(struct mnc_ctx*);
+void        mnc_push_qry(struct mnc_ctx*, struct mnc_ref);
+uint32_t    mnc_map_slot(struct mnc_ctx*, struct mnc_ref);
+void        mnc_doc_add_rele(struct mnc_ctx*, uint32_t, uint32_t, uint32_t);
+mnc_score_t mnc_score(struct mnc_ctx*);
+bool        mnc_avx2_supported(void);
 int         lsb_pos(uint64_t);
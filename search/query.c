@@ -18,6 +18,7 @@ struct query query_new()
 	qry.len = 0;
 	qry.n_math = 0;
 	qry.n_term = 0;
+	qry.prepared = 0;
 
 	return qry;
 }
@@ -76,6 +77,9 @@ void query_push_keyword(struct query *qry, const struct query_keyword* kw)
 
 	list_insert_one_at_tail(&copy->ln, &qry->keywords, NULL, NULL);
 	copy->pos = (qry->len ++);
+
+	/* new keyword is not assigned values yet */
+	qry->prepared = 0;
 }
 
 static struct query *adding_qry = NULL;
@@ -98,6 +102,9 @@ void query_digest_utf8txt(struct query *qry, text_lexer lex,
 {
 	FILE *text_fh;
 
+	text_fh = fmemopen((void *)txt, strlen(txt), "r");
+	pthread_mutex_lock(&g_lex_mutex);
+
 	/* register lex handler  */
 	g_lex_handler = add_into_qry;
 
@@ -105,9 +112,11 @@ void query_digest_utf8txt(struct query *qry, text_lexer lex,
 	adding_qry = qry;
 
 	/* invoke lexer */
-	text_fh = fmemopen((void *)txt, strlen(txt), "r");
 	lex(text_fh);
 
+	adding_qry = NULL;
+	pthread_mutex_unlock(&g_lex_mutex);
+
 	/* close file handler */
 	fclose(text_fh);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "list/list.h"
 
 /*
@@ -29,6 +30,7 @@ struct query {
 	uint32_t len; /* in number of keywords */
 	uint32_t n_math; /* number of math keywords */
 	uint32_t n_term; /* number of term keywords */
+	bool     prepared; /* see indices_prepare_query() */
 };
 
 /* query methods */
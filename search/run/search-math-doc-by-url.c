@@ -57,7 +57,7 @@ static void math_posting_find_expr(char* path, char *url)
 		po_item = math_posting_current(po);
 		pathinfo_pos = po_item->pathinfo_pos;
 		doc_url = get_blob_string(indices.url_bi, po_item->doc_id,
-		                          false, &doc_url_sz);
+		                          NULL, &doc_url_sz);
 
 		if (0 == strcmp(doc_url, url) || url[0] == '*') {
 			printf("doc#%u, exp#%u;",
@@ -17,7 +17,7 @@ math_posting_on_merge(uint64_t cur_min, struct postmerge* pm,
 	P_CAST(mes_arg, struct math_extra_score_arg, extra_args);
 
 	/* calculate math similarity on merge */
-	res = math_expr_score_on_merge(pm, mes_arg->dir_merge_level,
+	res = math_expr_score_on_merge(mes_arg->mnc, pm, mes_arg->dir_merge_level,
 	                               mes_arg->n_qry_lr_paths);
 
 	if (res.score > 0.f) {
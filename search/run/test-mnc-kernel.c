@@ -0,0 +1,292 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "mhook/mhook.h"
+#include "tex-parser/tex-parser.h"
+#include "mnc-score.h"
+
+/*
+ * check the vectorized mnc_score() kernel produces identical scores
+ * to the scalar kernel, and wide bitmaps (document paths in higher
+ * word planes) produce identical scores, using math-rank test cases
+ * and random bitmaps.
+ */
+#define DEFAULT_CASES_DIR "../tests/cases/math-rank"
+#define N_RANDOM_TESTS    100000
+#define MAX_CASE_EXPRS    64
+
+static uint32_t n_compared = 0, n_differ = 0;
+
+/* scoring input, recorded so that it can be fed to several contexts */
+struct mnc_input {
+	uint32_t    n_qry;
+	symbol_id_t qry_sym[MAX_SUBPATH_ID];
+
+	/* document path (symbol, bit) and one of its relevant query paths,
+	 * qry_path < 0 for a document path without relevant query path */
+	uint32_t    n_ops;
+	struct {
+		symbol_id_t sym;
+		uint32_t    doc_path;
+		int         qry_path;
+	} op[MAX_SUBPATH_ID * MAX_SUBPATH_ID];
+};
+
+static mnc_score_t
+input_score(struct mnc_ctx *ctx, struct mnc_input *in, uint32_t shift)
+{
+	uint32_t i, slot;
+	struct mnc_ref ref = {0, 0};
+
+	mnc_reset_qry(ctx);
+	for (i = 0; i < in->n_qry; i++) {
+		ref.sym = in->qry_sym[i];
+		mnc_push_qry(ctx, ref);
+	}
+
+	mnc_reset_docs(ctx);
+	for (i = 0; i < in->n_ops; i++) {
+		ref.sym = in->op[i].sym;
+		slot = mnc_map_slot(ctx, ref);
+
+		if (in->op[i].qry_path >= 0)
+			mnc_doc_add_rele(ctx, slot, in->op[i].doc_path + shift,
+			                 in->op[i].qry_path);
+	}
+
+	return mnc_score(ctx);
+}
+
+/* score an input by both kernels and compare, also compare with the
+ * same input whose document path bits are shifted into higher word
+ * planes (which keeps bit order, thus the score). */
+static void compare_kernels(struct mnc_ctx *ctx_scalar,
+                            struct mnc_ctx *ctx_avx2,
+                            struct mnc_input *in, uint32_t max_doc_path)
+{
+	mnc_score_t score_scalar, score_avx2, score_shift;
+	uint32_t shift = MAX_SUBPATH_ID - 1 - max_doc_path;
+
+	score_scalar = input_score(ctx_scalar, in, 0);
+	score_avx2 = input_score(ctx_avx2, in, 0);
+	score_shift = input_score(ctx_avx2, in, shift);
+
+	if (score_scalar != score_avx2 || score_scalar != score_shift) {
+		printf("kernels differ: score %u (scalar) vs. %u (AVX2) "
+		       "vs. %u (AVX2, shifted by %u)\n", score_scalar,
+		       score_avx2, score_shift, shift);
+		n_differ ++;
+	}
+
+	n_compared ++;
+}
+
+/*
+ * math-rank test cases
+ */
+static bool same_token_path(struct subpath *sp0, struct subpath *sp1)
+{
+	struct list_node *ln0 = sp0->path_nodes.now;
+	struct list_node *ln1 = sp1->path_nodes.now;
+	struct subpath_node *nd0, *nd1;
+
+	do {
+		if (ln0 == NULL || ln1 == NULL)
+			return (ln0 == ln1);
+
+		nd0 = MEMBER_2_STRUCT(ln0, struct subpath_node, ln);
+		nd1 = MEMBER_2_STRUCT(ln1, struct subpath_node, ln);
+		if (nd0->token_id != nd1->token_id)
+			return 0;
+
+		ln0 = ln0->next;
+		ln1 = ln1->next;
+	} while (ln0 != sp0->path_nodes.now && ln1 != sp1->path_nodes.now);
+
+	return (ln0 == sp0->path_nodes.now && ln1 == sp1->path_nodes.now);
+}
+
+/* collect non-gener subpaths of a parsed expression */
+static uint32_t
+expr_paths(struct subpaths *subpaths, struct subpath **paths)
+{
+	uint32_t n = 0;
+	struct list_node *ln = subpaths->li.now;
+	struct subpath *sp;
+
+	while (ln && n < MAX_SUBPATH_ID) {
+		sp = MEMBER_2_STRUCT(ln, struct subpath, ln);
+		if (sp->type != SUBPATH_TYPE_GENERNODE &&
+		    sp->path_id >= 1 && sp->path_id <= MAX_SUBPATH_ID)
+			paths[n++] = sp;
+
+		ln = (ln->next == subpaths->li.now) ? NULL : ln->next;
+	}
+
+	return n;
+}
+
+static void score_expr_pair(struct mnc_ctx **ctx, struct mnc_input *in,
+                            struct subpaths *qry, struct subpaths *doc)
+{
+	struct subpath *qry_paths[MAX_SUBPATH_ID], *doc_paths[MAX_SUBPATH_ID];
+	uint32_t i, j, n_qry, n_doc, max_doc_path = 0;
+
+	n_qry = expr_paths(qry, qry_paths);
+	n_doc = expr_paths(doc, doc_paths);
+
+	in->n_qry = n_qry;
+	for (i = 0; i < n_qry; i++)
+		in->qry_sym[i] = qry_paths[i]->lf_symbol_id;
+
+	/* paths of the same token path are merged in search */
+	in->n_ops = 0;
+	for (j = 0; j < n_doc; j++) {
+		in->op[in->n_ops].sym = doc_paths[j]->lf_symbol_id;
+		in->op[in->n_ops].doc_path = doc_paths[j]->path_id - 1;
+		in->op[in->n_ops].qry_path = -1;
+		in->n_ops ++;
+
+		for (i = 0; i < n_qry; i++) {
+			if (!same_token_path(qry_paths[i], doc_paths[j]))
+				continue;
+
+			in->op[in->n_ops] = in->op[in->n_ops - 1];
+			in->op[in->n_ops].qry_path = i;
+			in->n_ops ++;
+		}
+
+		if (doc_paths[j]->path_id - 1 > max_doc_path)
+			max_doc_path = doc_paths[j]->path_id - 1;
+	}
+
+	compare_kernels(ctx[0], ctx[1], in, max_doc_path);
+}
+
+static void test_case_file(struct mnc_ctx **ctx, struct mnc_input *in,
+                           const char *path)
+{
+	static char line[4096];
+	struct tex_parse_ret ret[MAX_CASE_EXPRS];
+	uint32_t i, j, n = 0;
+	FILE *fh = fopen(path, "r");
+	char *tex;
+
+	if (fh == NULL)
+		return;
+
+	while (n < MAX_CASE_EXPRS && fgets(line, sizeof(line), fh)) {
+		line[strcspn(line, "\n")] = '\0';
+
+		/* query line or "HIT/NOT <tex>" line */
+		tex = line;
+		if (0 == strncmp(line, "HIT ", 4) || 0 == strncmp(line, "NOT ", 4))
+			tex = line + 4;
+
+		if (tex[0] == '\0')
+			continue;
+
+		ret[n] = tex_parse(tex, 0, false);
+		if (ret[n].code != PARSER_RETCODE_ERR)
+			n++;
+	}
+
+	fclose(fh);
+
+	/* score every expression against every other one */
+	for (i = 0; i < n; i++)
+		for (j = 0; j < n; j++)
+			score_expr_pair(ctx, in, &ret[i].subpaths, &ret[j].subpaths);
+
+	for (i = 0; i < n; i++)
+		subpaths_release(&ret[i].subpaths);
+
+	printf("%s: %u expressions\n", path, n);
+}
+
+static void test_case_dir(struct mnc_ctx **ctx, struct mnc_input *in,
+                          const char *dir)
+{
+	char path[1024];
+	struct dirent *ent;
+	DIR *dh = opendir(dir);
+
+	if (dh == NULL) {
+		printf("cannot open test case directory `%s'\n", dir);
+		return;
+	}
+
+	while ((ent = readdir(dh)) != NULL) {
+		if (ent->d_name[0] == '.')
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+		test_case_file(ctx, in, path);
+	}
+
+	closedir(dh);
+}
+
+/*
+ * random bitmaps
+ */
+static void test_random(struct mnc_ctx **ctx, struct mnc_input *in,
+                        uint32_t max_paths)
+{
+	uint32_t t, i, j, n_bits;
+
+	for (t = 0; t < N_RANDOM_TESTS; t++) {
+		/* small alphabets to have repeated symbols */
+		in->n_qry = 1 + rand() % max_paths;
+		for (i = 0; i < in->n_qry; i++)
+			in->qry_sym[i] = (t & 1) ? rand() % 4 : i * 4 / in->n_qry;
+
+		in->n_ops = 0;
+		n_bits = 1 + rand() % max_paths;
+		for (j = 0; j < n_bits; j++) {
+			/* also large alphabets to widen relevance rows */
+			in->op[in->n_ops].sym = rand() % ((t & 2) ? max_paths : 8);
+			in->op[in->n_ops].doc_path = rand() % max_paths;
+			in->op[in->n_ops].qry_path = rand() % in->n_qry;
+			in->n_ops ++;
+		}
+
+		compare_kernels(ctx[0], ctx[1], in, max_paths - 1);
+	}
+
+	printf("random bitmaps (%u paths): %u tests\n", max_paths,
+	       N_RANDOM_TESTS);
+}
+
+int main(int argc, char *argv[])
+{
+	struct mnc_ctx   *ctx[2];
+	struct mnc_input *in;
+	const char *dir = (argc > 1) ? argv[1] : DEFAULT_CASES_DIR;
+
+	if (!mnc_avx2_supported()) {
+		printf("AVX2 kernel is not supported, skip.\n");
+		return 0;
+	}
+
+	ctx[0] = mnc_ctx_new();
+	ctx[1] = mnc_ctx_new();
+	ctx[0]->use_avx2 = 0;
+	ctx[1]->use_avx2 = 1;
+	in = malloc(sizeof(struct mnc_input));
+
+	test_case_dir(ctx, in, dir);
+	test_random(ctx, in, 64);
+	test_random(ctx, in, MAX_SUBPATH_ID);
+
+	printf("%u compared, %u differ.\n", n_compared, n_differ);
+
+	free(in);
+	mnc_ctx_free(ctx[0]);
+	mnc_ctx_free(ctx[1]);
+
+	mhook_print_unfree();
+	return (n_differ != 0);
+}
@@ -22,7 +22,7 @@ void print_res_item(struct rank_hit* hit, uint32_t cnt, void* arg_)
 	printf("page result#%u: doc#%u score=%.3f\n", cnt, hit->docID, hit->score);
 
 	/* get URL */
-	str = get_blob_string(args->indices->url_bi, hit->docID, 0, &str_sz);
+	str = get_blob_string(args->indices->url_bi, hit->docID, NULL, &str_sz);
 	printf("URL: %s" "\n", str);
 	free(str);
 
@@ -36,18 +36,19 @@ void print_res_item(struct rank_hit* hit, uint32_t cnt, void* arg_)
 	printf("\n");
 
 	/* get document text */
-	str = get_blob_string(args->indices->txt_bi, hit->docID, 1, &str_sz);
+	str = get_blob_string(args->indices->txt_bi, hit->docID,
+	                      args->indices->txt_codec, &str_sz);
 
 	/* prepare highlighter arguments */
 	highlight_list = prepare_snippet(hit, str, str_sz, args->lex);
-	free(str);
 
 	/* print snippet */
-	snippet_hi_print(&highlight_list);
+	snippet_hi_print(&highlight_list, str);
 	printf("--------\n\n");
 
-	/* free highlight list */
+	/* free highlight list and text */
 	snippet_free_highlight_list(&highlight_list);
+	free(str);
 }
 
 void
@@ -10,28 +10,41 @@
 #include "snippet.h"
 
 #define ADD( _pos, _term) \
-	snippet_push_highlight(&hi_li, _term, _pos, strlen(_term));
+	snippet_push_highlight(&hi_li, _pos, strlen(_term));
 
 int main(void)
 {
 	list hi_li = LIST_NULL;
 	FILE *fh = fopen("test-snippet/sample.txt", "r");
+	char *text;
+	size_t text_sz;
 
 	if (fh == NULL) {
 		printf("cannot open file.\n");
 		return 1;
 	}
 
+	/* read source text */
+	fseek(fh, 0, SEEK_END);
+	text_sz = ftell(fh);
+	fseek(fh, 0, SEEK_SET);
+
+	text = malloc(text_sz + 1);
+	text_sz = fread(text, 1, text_sz, fh);
+	text[text_sz] = '\0';
+	fclose(fh);
+
 	ADD(363, "hello");
 	ADD(3908, "world");
 	ADD(4276, "world");
 	ADD(4313, "world");
 
-	snippet_read_file(fh, &hi_li);
-	snippet_hi_print(&hi_li);
+	snippet_align(&hi_li, text, text_sz);
+	snippet_pos_print(&hi_li);
+	snippet_hi_print(&hi_li, text);
 
 	snippet_free_highlight_list(&hi_li);
-	fclose(fh);
+	free(text);
 
 	mhook_print_unfree();
 	return 0;
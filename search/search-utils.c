@@ -46,26 +46,44 @@ static bool term_posting_jump_wrap(void *posting, uint64_t to_id)
 
 struct postmerge_callbks *get_memory_postmerge_callbks(void)
 {
-	static struct postmerge_callbks ret;
-	ret.start  = &mem_posting_start;
-	ret.finish = &mem_posting_finish;
-	ret.jump   = &mem_posting_jump;
-	ret.next   = &mem_posting_next;
-	ret.now    = &mem_posting_cur_item;
-	ret.now_id = &mem_posting_cur_item_id;
+	static struct postmerge_callbks ret = {
+		.start  = &mem_posting_start,
+		.finish = &mem_posting_finish,
+		.jump   = &mem_posting_jump,
+		.next   = &mem_posting_next,
+		.now    = &mem_posting_cur_item,
+		.now_id = &mem_posting_cur_item_id
+	};
+
+	return &ret;
+}
+
+/* iterate a shared (cached) in-memory posting list through its own
+ * iterator, see mem_posting_iter_new() */
+struct postmerge_callbks *get_memory_iter_postmerge_callbks(void)
+{
+	static struct postmerge_callbks ret = {
+		.start  = &mem_posting_start,
+		.finish = &mem_posting_iter_free,
+		.jump   = &mem_posting_jump,
+		.next   = &mem_posting_next,
+		.now    = &mem_posting_cur_item,
+		.now_id = &mem_posting_cur_item_id
+	};
 
 	return &ret;
 }
 
 struct postmerge_callbks *get_disk_postmerge_callbks(void)
 {
-	static struct postmerge_callbks ret;
-	ret.start  = &term_posting_start;
-	ret.finish = &term_posting_finish;
-	ret.jump   = &term_posting_jump_wrap;
-	ret.next   = &term_posting_next;
-	ret.now    = &term_posting_cur_item_wrap;
-	ret.now_id = &term_posting_cur_item_id_wrap;
+	static struct postmerge_callbks ret = {
+		.start  = &term_posting_start,
+		.finish = &term_posting_finish,
+		.jump   = &term_posting_jump_wrap,
+		.next   = &term_posting_next,
+		.now    = &term_posting_cur_item_wrap,
+		.now_id = &term_posting_cur_item_id_wrap
+	};
 
 	return &ret;
 }
@@ -125,29 +143,50 @@ struct rank_hit *new_hit(doc_id_t hitID, float score,
  * get blob string
  */
 char
-*get_blob_string(blob_index_t bi, doc_id_t docID, bool gz, size_t *str_len)
+*get_blob_string(blob_index_t bi, doc_id_t docID, struct codec *codec,
+                 size_t *str_len)
 {
-	struct codec   codec = {CODEC_GZ, NULL};
-	static char    text[MAX_CORPUS_FILE_SZ + 1];
-	size_t         blob_sz, text_sz;
-	char          *blob_out = NULL;
-
-	blob_sz = blob_index_read(bi, docID, (void **)&blob_out);
-
-	if (blob_out) {
-		if (gz) {
-			text_sz = codec_decompress(&codec, blob_out, blob_sz,
-					text, MAX_CORPUS_FILE_SZ);
-			text[text_sz] = '\0';
-			*str_len = text_sz;
+	size_t         blob_sz, text_sz, buf_sz;
+	const char    *blob;
+	char          *blob_out = NULL, *text;
+
+	/* read blob in place if index is mapped, otherwise a copy */
+	blob = blob_index_view(bi, docID, &blob_sz);
+	if (blob == NULL) {
+		blob_sz = blob_index_read(bi, docID, (void **)&blob_out);
+		blob = blob_out;
+	}
+
+	if (blob) {
+		if (codec) {
+			/* decompress into a buffer of a few times the blob size,
+			 * grow it (up to max corpus file size) if it is short */
+			buf_sz = (blob_sz + 1) * BLOB_TEXT_INFLATE_RATIO;
+			buf_sz = (buf_sz < MAX_CORPUS_FILE_SZ) ? buf_sz :
+			                                         MAX_CORPUS_FILE_SZ;
+			text = NULL;
+			while (1) {
+				text = realloc(text, buf_sz + 1);
+				text_sz = codec_decompress(codec, blob, blob_sz,
+				                           text, buf_sz);
+				if (text_sz != 0 || buf_sz >= MAX_CORPUS_FILE_SZ)
+					break;
+
+				buf_sz = (buf_sz << 1 < MAX_CORPUS_FILE_SZ) ?
+				         buf_sz << 1 : MAX_CORPUS_FILE_SZ;
+			}
+			text = realloc(text, text_sz + 1);
 		} else {
-			memcpy(text, blob_out, blob_sz);
-			text[blob_sz] = '\0';
-			*str_len = blob_sz;
+			text = malloc(blob_sz + 1);
+			memcpy(text, blob, blob_sz);
+			text_sz = blob_sz;
 		}
 
+		text[text_sz] = '\0';
+		*str_len = text_sz;
+
 		blob_free(blob_out);
-		return strdup(text);
+		return text;
 	}
 
 	fprintf(stderr, "error: get_blob_string().\n");
@@ -207,7 +246,7 @@ add_highlight_seg(char *mb_str, uint32_t offset, size_t sz, void *arg)
 	} else if (ha->cur_lex_pos == ha->pos_arr[ha->pos_arr_now]) {
 		/* this is the segment of current highlight position,
 		 * push it into snippet with offset information. */
-		snippet_push_highlight(&ha->hi_list, mb_str, offset, sz);
+		snippet_push_highlight(&ha->hi_list, offset, sz);
 		/* next highlight position */
 		ha->pos_arr_now ++;
 	}
@@ -268,7 +307,7 @@ foreach_seg(struct lex_slice *slice, seg_it_callbk fun, void *arg)
 	}
 }
 
-/* highlighter arguments */
+/* highlighter arguments (of g_lex_handler, guarded by g_lex_mutex) */
 static struct highlighter_arg hi_arg;
 
 static int highlighter_arg_lex_setter(struct lex_slice *slice)
@@ -290,6 +329,10 @@ list prepare_snippet(struct rank_hit* hit, const char *text,
                      size_t text_sz, text_lexer lex)
 {
 	FILE *text_fh;
+	list  hi_list;
+
+	text_fh = fmemopen((void *)text, text_sz, "r");
+	pthread_mutex_lock(&g_lex_mutex);
 
 	/* prepare highlighter arguments */
 	hi_arg.pos_arr = hit->occurs;
@@ -302,16 +345,57 @@ list prepare_snippet(struct rank_hit* hit, const char *text,
 	g_lex_handler = highlighter_arg_lex_setter;
 
 	/* invoke lexer */
-	text_fh = fmemopen((void *)text, text_sz, "r");
 	lex(text_fh);
 
-	/* print snippet */
-	snippet_read_file(text_fh, &hi_arg.hi_list);
+	hi_list = hi_arg.hi_list;
+	pthread_mutex_unlock(&g_lex_mutex);
 
 	/* close file handler */
 	fclose(text_fh);
 
-	return hi_arg.hi_list;
+	/* align snippet */
+	snippet_align(&hi_list, text, text_sz);
+
+	return hi_list;
+}
+
+list prepare_snippet_indexed(struct indices *indices, struct rank_hit* hit,
+                             const char *text, size_t text_sz, text_lexer lex)
+{
+	list   hi_list = LIST_NULL;
+	const void *tab = NULL;
+	void  *tab_out = NULL;
+	size_t tab_sz = 0;
+	int    i, n = -1;
+	struct pos_range ranges[MAX_HIGHLIGHT_OCCURS];
+
+	/* look up highlight positions in position-offset table */
+	if (indices->ofs_bi) {
+		tab = blob_index_view(indices->ofs_bi, hit->docID, &tab_sz);
+		if (tab == NULL) {
+			tab_sz = blob_index_read(indices->ofs_bi, hit->docID, &tab_out);
+			tab = tab_out;
+		}
+	}
+
+	if (tab) {
+		n = offset_table_lookup(tab, tab_sz, text_sz, hit->occurs,
+		                        hit->n_occurs, ranges);
+		blob_free(tab_out);
+	}
+
+	/* table is not indexed for this document */
+	if (n < 0)
+		return prepare_snippet(hit, text, text_sz, lex);
+
+	for (i = 0; i < n; i++)
+		snippet_push_highlight(&hi_list, ranges[i].offset,
+		                       ranges[i].len);
+
+	/* align snippet */
+	snippet_align(&hi_list, text, text_sz);
+
+	return hi_list;
 }
 
 /*
@@ -408,11 +492,12 @@ print_math_expr_at(struct indices *indices, doc_id_t docID, exp_id_t expID)
 
 	g_lex_handler = highlighter_arg_lex_setter;
 
-	str = get_blob_string(indices->txt_bi, docID, 1, &str_sz);
+	str = get_blob_string(indices->txt_bi, docID, indices->txt_codec,
+	                      &str_sz);
 	highlight_list = prepare_snippet(&mock_hit, str, str_sz,
 	                                 lex_eng_file);
-	free(str);
 
-	snippet_hi_print(&highlight_list);
+	snippet_hi_print(&highlight_list, str);
 	snippet_free_highlight_list(&highlight_list);
+	free(str);
 }
@@ -11,19 +11,25 @@ struct posting_merge_extra_args {
 
 /* get postmerge callback functions */
 struct postmerge_callbks *get_memory_postmerge_callbks();
+struct postmerge_callbks *get_memory_iter_postmerge_callbks();
 struct postmerge_callbks *get_disk_postmerge_callbks();
 
 /* new rank hit */
 struct rank_hit *new_hit(doc_id_t, float,
                          prox_input_t*, uint32_t);
 
-/* get blob string (allocated), decode blob if needed. */
-char *get_blob_string(blob_index_t, doc_id_t, bool, size_t*);
+/* get blob string (allocated), decode blob by codec if it is not NULL. */
+char *get_blob_string(blob_index_t, doc_id_t, struct codec*, size_t*);
 
 /* prepare snippet */
 list
 prepare_snippet(struct rank_hit*, const char*, size_t, text_lexer);
 
+/* prepare snippet using position-offset table of indices, or by lexing
+ * text if the table is not indexed for this document. */
+list prepare_snippet_indexed(struct indices*, struct rank_hit*,
+                             const char*, size_t, text_lexer);
+
 /* consider_top_K() */
 void consider_top_K(ranked_results_t*, doc_id_t, float,
                     prox_input_t*, uint32_t);
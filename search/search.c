@@ -61,12 +61,13 @@ add_term_postinglist(struct postmerge *pm, struct indices *indices,
 	} else {
 		/* otherwise, get on-disk or cached posting list */
 		struct postcache_item *cache_item =
-			postcache_find(&indices->postcache, term_id);
+			postcache_find(indices->cache, term_id);
 
 		if (NULL != cache_item) {
-			/* if this term is already cached */
-			post = cache_item->posting;
-			pm_calls = get_memory_postmerge_callbks();
+			/* if this term is already cached, iterate it through
+			 * our own iterator (cache is shared by queries) */
+			post = mem_posting_iter_new(cache_item->posting);
+			pm_calls = get_memory_iter_postmerge_callbks();
 
 #ifdef VERBOSE_SEARCH
 		printf("`%s' uses cached posting list.\n", kw_utf8);
@@ -295,6 +296,23 @@ static void free_math_postinglists(struct postmerge *pm)
 	}
 }
 
+void indices_prepare_query(struct indices *indices, struct query *qry)
+{
+	/* keyword look-ups and sorting are done only once */
+	if (qry->prepared)
+		return;
+
+	set_keywords_val(qry, indices);
+
+	/* sort query, to prioritize keywords in highlight stage */
+	query_sort_by_df(qry);
+
+	/* make query unique by post_id, avoid mem-posting overlap */
+	query_uniq_by_post_id(qry);
+
+	qry->prepared = 1;
+}
+
 ranked_results_t
 indices_run_query(struct indices *indices, struct query *qry)
 {
@@ -314,13 +332,7 @@ indices_run_query(struct indices *indices, struct query *qry)
 	/*
 	 * some query pre-merge process.
 	 */
-	set_keywords_val(qry, indices);
-
-	/* sort query, to prioritize keywords in highlight stage */
-	query_sort_by_df(qry);
-
-	/* make query unique by post_id, avoid mem-posting overlap */
-	query_uniq_by_post_id(qry);
+	indices_prepare_query(indices, qry);
 
 #ifdef VERBOSE_SEARCH
 	printf("\n");
@@ -332,6 +344,9 @@ indices_run_query(struct indices *indices, struct query *qry)
 	/* initialize postmerge */
 	postmerge_posts_clear(&pm);
 
+	/* cached lists stay in cache until merge is done */
+	postcache_lock_shared(indices->cache);
+
 	n_add = add_postinglists(indices, qry, &pm,
 	                         (float*)&bm25args.idf);
 #ifdef VERBOSE_SEARCH
@@ -387,6 +402,12 @@ indices_run_query(struct indices *indices, struct query *qry)
 	/* free temporal math posting lists */
 	free_math_postinglists(&pm);
 
+	postcache_unlock(indices->cache);
+
+	/* let posting lists missed in cache compete for admission (in
+	 * background, see indices_cache_admitter()) */
+	indices_cache_update(indices);
+
 	/* rank top K hits */
 	priority_Q_sort(&rk_res);
 
@@ -8,5 +8,10 @@ struct searcher_args {
 	text_lexer      lex;
 };
 
+/* assign keyword values (posting ID and DF), sort query by DF and make
+ * it unique by posting ID. Done by indices_run_query() unless the query
+ * has been prepared ahead (e.g. to get the normalized query). */
+void indices_prepare_query(struct indices*, struct query*);
+
 ranked_results_t
 indices_run_query(struct indices*, struct query*);
@@ -6,13 +6,6 @@
 #include "list/list.h"
 #include "snippet.h"
 
-/* for MAX_TXT_SEG_BYTES */
-#include "txt-seg/config.h"
-
-/* even a short query can get a long hilighted string, e.g.
- * in the case of math search */
-#define MAX_HIGHLIGHTED_BYTES (MAX_TXT_SEG_BYTES * 1024)
-
 /* for terminal colors */
 #include "tex-parser/vt100-color.h"
 #define SNIPPET_HL_COLOR C_RED
@@ -23,22 +16,19 @@
 
 #define _min(x, y) ((x) > (y) ? (y) : (x))
 
+/* a highlight is a byte range of source text, with paddings around it */
 struct snippet_hi {
 	/* position info */
 	uint32_t kw_pos, kw_end;
 	uint32_t pad_left, pad_right;
 	bool     joint_left, joint_right;
 
-	/* string buffers */
-	char     left_str[SNIPPET_PADDING + 1];
-	char     right_str[SNIPPET_PADDING + 1];
-	char     kw_str[MAX_HIGHLIGHTED_BYTES];
-
 	struct list_node ln;
 };
 
 struct write_snippet_arg {
-	char *wr_cur;
+	const char *text;
+	char       *wr_cur, *wr_end;
 	const char *open, *close;
 };
 
@@ -49,39 +39,43 @@ void snippet_free_highlight_list(list* hi_li)
 	free_hi_list(hi_li);
 }
 
-void snippet_push_highlight(list* hi_li, char* kw_str,
-                            uint32_t kw_pos, uint32_t kw_len)
+static LIST_CMP_CALLBK(compare_kw_pos)
+{
+	struct snippet_hi *h0 = MEMBER_2_STRUCT(pa_node0, struct snippet_hi, ln);
+	struct snippet_hi *h1 = MEMBER_2_STRUCT(pa_node1, struct snippet_hi, ln);
+
+	return h0->kw_pos < h1->kw_pos;
+}
+
+void snippet_push_highlight(list* hi_li, uint32_t kw_pos, uint32_t kw_len)
 {
 	struct snippet_hi *h = malloc(sizeof(struct snippet_hi));
+	struct snippet_hi *tail = MEMBER_2_STRUCT(hi_li->last,
+	                                          struct snippet_hi, ln);
+	struct list_sort_arg sort = {&compare_kw_pos, NULL};
+
 	h->kw_pos = kw_pos;
 	h->kw_end = kw_pos + kw_len;
 	h->pad_left = h->pad_right = SNIPPET_PADDING;
 	h->joint_left = h->joint_right = 0;
 
-	h->left_str[0]  = '\0';
-	h->right_str[0] = '\0';
-	h->kw_str[0]    = '\0';
-
+	/* keep highlights in text order, highlights in position order
+	 * are not necessarily so (e.g. segmented words of a word). */
 	LIST_NODE_CONS(h->ln);
-	list_insert_one_at_tail(&h->ln, hi_li, NULL, NULL);
+	if (tail == NULL || h->kw_pos >= tail->kw_pos)
+		list_insert_one_at_tail(&h->ln, hi_li, NULL, NULL);
+	else
+		list_sort_insert(&h->ln, hi_li, &sort);
 }
 
-static LIST_IT_CALLBK(print)
+static LIST_IT_CALLBK(print_pos)
 {
 	LIST_OBJ(struct snippet_hi, h, ln);
-	P_CAST(pos, bool, pa_extra);
 
-	if (*pos) {
-		printf("[%u]", h->pad_left);
-		printf("{%u,%u}", h->kw_pos, h->kw_end);
-		printf("[%u]", h->pad_right);
-		printf(" ");
-	} else {
-		printf("%s", h->left_str);
-		printf(SNIPPET_HL_COLOR "%s" SNIPPET_HL_RST,
-		       h->kw_str);
-		printf("%s", h->right_str);
-	}
+	printf("[%u]", h->pad_left);
+	printf("{%u,%u}", h->kw_pos, h->kw_end);
+	printf("[%u]", h->pad_right);
+	printf(" ");
 
 	if (!h->joint_right)
 		printf(" ... ");
@@ -91,16 +85,14 @@ static LIST_IT_CALLBK(print)
 
 void snippet_pos_print(list* hi_li)
 {
-	bool if_print_pos = 1;
-	list_foreach(hi_li, &print, &if_print_pos);
+	list_foreach(hi_li, &print_pos, NULL);
 	printf("\n");
 }
 
-void snippet_hi_print(list* hi_li)
+void snippet_hi_print(list* hi_li, const char *text)
 {
-	bool if_print_pos = 0;
-	list_foreach(hi_li, &print, &if_print_pos);
-	printf("\n");
+	printf("%s\n", snippet_highlighted(hi_li, text, SNIPPET_HL_COLOR,
+	                                   SNIPPET_HL_RST));
 }
 
 static LIST_IT_CALLBK(align)
@@ -152,36 +144,24 @@ static bool utf8_conti(char byte)
 		return 0;
 }
 
+/* number of leading continuation bytes in a range */
 static uint32_t
-strip_utf8conti_from_head(char *buf, size_t len)
+utf8conti_head(const char *buf, uint32_t len)
 {
-	size_t i, j;
-	/* go to the first byte that is utf8 start byte */
+	uint32_t i;
 	for (i = 0; i < len; i++)
 		if (!utf8_conti(buf[i]))
 			break;
 
-	/*
-	 * if there are non-start byte(s) in the head, cut them,
-	 * move right utf8 string ahead and overwrite the head.
-	 */
-	if (i != 0) {
-		for (j = 0; i < len; i++, j++) {
-			buf[j] = buf[i];
-		}
-
-		buf[j] = '\0';
-		return (uint32_t)j;
-	}
-
-	/* no need to cut, keep the original length */
-	return len;
+	return i;
 }
 
+/* length of a range with its last (maybe incomplete) UTF-8
+ * character cut */
 static uint32_t
-strip_utf8conti_from_tail(char *buf, size_t len)
+utf8conti_cut_tail(const char *buf, uint32_t len)
 {
-	size_t i = len;
+	uint32_t i;
 
 	/* safe guard */
 	if (len == 0)
@@ -193,105 +173,122 @@ strip_utf8conti_from_tail(char *buf, size_t len)
 		if (!utf8_conti(buf[i]))
 			break;
 
-	/* cut it and those follows */
-	buf[i] = '\0';
-	return (uint32_t)i;
+	return i;
 }
 
-static LIST_IT_CALLBK(read_file)
+static LIST_IT_CALLBK(clip)
 {
-	size_t nread;
-	uint32_t newlen;
 	LIST_OBJ(struct snippet_hi, h, ln);
-	P_CAST(fh, FILE, pa_extra);
+	struct snippet_hi* next_h =
+		MEMBER_2_STRUCT(pa_fwd->now, struct snippet_hi, ln);
+	P_CAST(text_sz, size_t, pa_extra);
 
-	/* re-seek file from beginning if left h is not joint */
-	if (!h->joint_left)
-		fseek(fh, h->kw_pos - h->pad_left, SEEK_SET);
-
-	/* read into left_str buffer */
-	nread = fread(h->left_str, 1, h->pad_left, fh);
-	h->left_str[nread] = '\0';
-	if (!h->joint_left) {
-		newlen = strip_utf8conti_from_head(h->left_str, nread);
-		h->pad_left = newlen;
-	}
+	/* strip ranges if they exceed buffer tail */
+	h->kw_pos = _min(h->kw_pos, *text_sz);
+	h->kw_end = _min(h->kw_end, *text_sz);
 
-	/* read into keyword buffer */
-	nread = fread(h->kw_str, 1, h->kw_end - h->kw_pos, fh);
-	h->kw_str[nread] = '\0';
+	if (h->kw_end + h->pad_right > *text_sz)
+		h->pad_right = *text_sz - h->kw_end;
 
-	/* read into right_str buffer */
-	nread = fread(h->right_str, 1, h->pad_right, fh);
-	h->right_str[nread] = '\0';
-	if (!h->joint_right) {
-		newlen = strip_utf8conti_from_tail(h->right_str, nread);
-		h->pad_right = newlen;
+	/* overlapping part of next highlight is left to this one */
+	if (pa_now->now != pa_head->last && next_h->kw_pos < h->kw_end) {
+		next_h->kw_pos = h->kw_end;
+		if (next_h->kw_end < next_h->kw_pos)
+			next_h->kw_end = next_h->kw_pos;
 	}
 
 	LIST_GO_OVER;
 }
 
-static void _rm_linefeed(char *str, size_t len)
-{
-	size_t i;
-	for (i = 0; i < len; i++) {
-		if (str[i] == '\n')
-			str[i] = ' ';
-		else if (str[i] == '\r')
-			str[i] = ' ';
-	}
-}
-
-static LIST_IT_CALLBK(rm_linefeed)
+static LIST_IT_CALLBK(fit_utf8)
 {
 	LIST_OBJ(struct snippet_hi, h, ln);
-	_rm_linefeed(h->left_str, h->pad_left);
-	_rm_linefeed(h->right_str, h->pad_right);
+	P_CAST(text, const char, pa_extra);
+
+	/* paddings not joint to other highlights should not begin or
+	 * end in the middle of an UTF-8 character */
+	if (!h->joint_left)
+		h->pad_left -= utf8conti_head(text + h->kw_pos - h->pad_left,
+		                              h->pad_left);
+
+	if (!h->joint_right)
+		h->pad_right = utf8conti_cut_tail(text + h->kw_end, h->pad_right);
 
 	LIST_GO_OVER;
 }
 
-void snippet_read_file(FILE* fh, list* hi_li)
+void snippet_align(list* hi_li, const char *text, size_t text_sz)
 {
 #ifdef DEBUG_SNIPPET
-	printf("snippet right before reading file:\n");
+	printf("snippet right before alignment:\n");
 	snippet_pos_print(hi_li);
 #endif
 
+	list_foreach(hi_li, &clip, &text_sz);
 	list_foreach(hi_li, &align, NULL);
-	list_foreach(hi_li, &read_file, fh);
-	list_foreach(hi_li, &rm_linefeed, NULL);
+	list_foreach(hi_li, &fit_utf8, (void*)text);
+}
+
+static void _rm_linefeed(char *str, size_t len)
+{
+	size_t i;
+	for (i = 0; i < len; i++) {
+		if (str[i] == '\n')
+			str[i] = ' ';
+		else if (str[i] == '\r')
+			str[i] = ' ';
+	}
+}
+
+static void
+write_range(struct write_snippet_arg *arg, const char *src, size_t len)
+{
+	memcpy(arg->wr_cur, src, len);
+	arg->wr_cur += len;
 }
 
 static LIST_IT_CALLBK(write_snippet)
 {
 	LIST_OBJ(struct snippet_hi, h, ln);
 	P_CAST(arg, struct write_snippet_arg, pa_extra);
-	char *p = arg->wr_cur;
+	const char *text = arg->text;
+	size_t open_len = strlen(arg->open), close_len = strlen(arg->close);
+	size_t kw_len = h->kw_end - h->kw_pos;
+	size_t sep_len = (h->joint_right) ? 0 : strlen(" ... ");
+
+	/* stop if this highlight does not fit in snippet buffer */
+	if (arg->wr_cur + h->pad_left + open_len + kw_len + close_len +
+	    h->pad_right + sep_len >= arg->wr_end)
+		return LIST_RET_BREAK;
 
-	p += sprintf(p, "%s", h->left_str);
-	p += sprintf(p, "%s", arg->open);
-	p += sprintf(p, "%s", h->kw_str);
-	p += sprintf(p, "%s", arg->close);
-	p += sprintf(p, "%s", h->right_str);
+	write_range(arg, text + h->kw_pos - h->pad_left, h->pad_left);
+	_rm_linefeed(arg->wr_cur - h->pad_left, h->pad_left);
 
-	if (!h->joint_right)
-		p += sprintf(p, " ... ");
+	/* empty if it totally overlaps with previous highlight */
+	if (kw_len != 0) {
+		write_range(arg, arg->open, open_len);
+		write_range(arg, text + h->kw_pos, kw_len);
+		write_range(arg, arg->close, close_len);
+	}
+
+	write_range(arg, text + h->kw_end, h->pad_right);
+	_rm_linefeed(arg->wr_cur - h->pad_right, h->pad_right);
 
-	/* update current writing position */
-	arg->wr_cur = p;
+	write_range(arg, " ... ", sep_len);
 
 	LIST_GO_OVER;
 }
 
 const char
-*snippet_highlighted(list* hi_li, const char *open, const char *close)
+*snippet_highlighted(list* hi_li, const char *text,
+                     const char *open, const char *close)
 {
-	static char snippet[MAX_SNIPPET_SZ];
-	struct write_snippet_arg arg = {snippet, open, close};
+	static __thread char snippet[MAX_SNIPPET_SZ];
+	struct write_snippet_arg arg = {text, snippet, snippet + MAX_SNIPPET_SZ,
+	                                open, close};
 
 	list_foreach(hi_li, &write_snippet, &arg);
+	*arg.wr_cur = '\0';
 
 	return snippet;
 }
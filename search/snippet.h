@@ -1,14 +1,20 @@
-void snippet_push_highlight(list*, char*, uint32_t, uint32_t);
+/*
+ * highlights are byte ranges of a source text (with paddings around
+ * them), snippet string is only written when it is requested, so the
+ * source text should be kept until then.
+ */
+void snippet_push_highlight(list*, uint32_t, uint32_t);
 void snippet_free_highlight_list(list*);
 
-void snippet_read_file(FILE*, list*);
+/* align highlight paddings to source text of given size */
+void snippet_align(list*, const char*, size_t);
 
-/* return a static string */
+/* return a (per-thread) static string */
 const char
-*snippet_highlighted(list*, const char*, const char*);
+*snippet_highlighted(list*, const char*, const char*, const char*);
 
 /* print a color highlighted string in terminal */
-void snippet_hi_print(list*);
+void snippet_hi_print(list*, const char*);
 
 /* print position info of div list (for debug) */
 void snippet_pos_print(list*);
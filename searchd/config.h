@@ -9,6 +9,14 @@
 
 #define SEARCHD_DEFAULT_CACHE_MB 32 /* 32 MB */
 
+/* response cache, see respcache.h */
+#define SEARCHD_DEFAULT_RESPCACHE_MB 16
+#define SEARCHD_RESPCACHE_BUCKETS    (1 << 12)
+
+/* ranked results cache, see rescache.h */
+#define SEARCHD_DEFAULT_RESCACHE_MB 16
+#define SEARCHD_RESCACHE_BUCKETS    (1 << 12)
+
 #define SEARCHD_LOG_FILE "searchd.log"
 #define SEARCHD_LOG_ENABLE
 
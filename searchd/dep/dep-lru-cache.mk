@@ -0,0 +1,2 @@
+CFLAGS +=
+LDFLAGS += -L "../lru-cache/$(BUILD_DIR)"
@@ -1,7 +1,16 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
 #include <evhttp.h>
 #include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
 
 #undef N_DEBUG
 #include <assert.h>
@@ -25,6 +34,57 @@ static void signal_handler(int sig) {
 	}
 }
 
+/* listen with SO_REUSEPORT, set in forked processes */
+static bool reuseport = 0;
+
+static struct evhttp *httpd_listen(unsigned short port)
+{
+	struct evhttp *httpd;
+	struct sockaddr_in addr;
+	int fd, on = 1;
+
+	if (!reuseport)
+		return evhttp_start("0.0.0.0", port);
+
+	/* every process has its own listening socket on the same port,
+	 * kernel distributes incoming connections among them. */
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket() function");
+		return NULL;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on))) {
+		perror("setsockopt() function");
+		goto fail;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+
+	if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) ||
+	    listen(fd, 128)) {
+		perror("bind() or listen() function");
+		goto fail;
+	}
+
+	evutil_make_socket_nonblocking(fd);
+
+	httpd = evhttp_new(NULL);
+	if (httpd && 0 == evhttp_accept_socket(httpd, fd))
+		return httpd; /* socket is closed along with httpd */
+
+	if (httpd)
+		evhttp_free(httpd);
+
+fail:
+	close(fd);
+	return NULL;
+}
+
 static void print_headers(struct evhttp_request *req)
 {
 	struct evkeyvalq *headers;
@@ -89,7 +149,6 @@ httpd_callbk(struct evhttp_request *req, void *arg_)
 	struct http_cb_arg *arg = (struct http_cb_arg *)arg_;
 	struct evbuffer *buf;
 	char *request;
-	const char *response;
 
 #ifdef DEBUG_PRINT_HTTP_HEAD
 	printf("HTTP request header:\n");
@@ -117,7 +176,8 @@ httpd_callbk(struct evhttp_request *req, void *arg_)
 
 	request = get_POST_str(req);
 	if (request != NULL) {
-		response = arg->on_recv(request, arg->arg);
+		/* set HTTP response content */
+		arg->on_recv(request, buf, arg->arg);
 	} else {
 		fprintf(stderr, "httpd: POST data is NULL.\n");
 		goto reply;
@@ -129,14 +189,6 @@ httpd_callbk(struct evhttp_request *req, void *arg_)
 	evhttp_add_header(req->output_headers, "Connection",
 	                  "close");
 
-	/* set HTTP response content */
-	if (response)
-		evbuffer_add_printf(buf, "%s", response);
-
-	/*
-	 * Free request after response is copied (in case they
-	 * have the same pointer address, e.g. an echo server)
-	 */
 	free(request);
 
 reply:
@@ -145,6 +197,267 @@ reply:
 	evbuffer_free(buf);
 }
 
+/*
+ * worker pool mode: event loop receives requests and sends replies,
+ * while requests are handled by worker threads. Handled requests are
+ * passed back to event loop through a pipe.
+ */
+struct httpd_job {
+	struct evhttp_request *req; /* NULL if connection is closed */
+	char                  *request;
+	struct evbuffer       *buf; /* response */
+	struct httpd_job      *next;
+};
+
+struct httpd_worker {
+	pthread_t          tid;
+	void              *arg;
+	struct httpd_pool *pool;
+};
+
+struct httpd_pool {
+	httpd_on_recv_cb     on_recv;
+	struct httpd_worker *workers;
+	unsigned int         n_workers;
+
+	/* queue of requests to be handled */
+	pthread_mutex_t      mutex;
+	pthread_cond_t       cond;
+	struct httpd_job    *head, *tail;
+	bool                 stop;
+
+	/* pipe of handled jobs */
+	int                  done_fd[2];
+	struct event         done_ev;
+};
+
+static void job_free(struct httpd_job *job)
+{
+	free(job->request);
+	evbuffer_free(job->buf);
+	free(job);
+}
+
+/* free a job without reply */
+static void job_drop(struct httpd_job *job)
+{
+	if (job->req)
+		evhttp_connection_set_closecb(
+			evhttp_request_get_connection(job->req), NULL, NULL);
+
+	job_free(job);
+}
+
+static void *worker_main(void *arg)
+{
+	struct httpd_worker *worker = (struct httpd_worker*)arg;
+	struct httpd_pool *pool = worker->pool;
+	struct httpd_job *job;
+
+	while (1) {
+		pthread_mutex_lock(&pool->mutex);
+		while (!pool->stop && pool->head == NULL)
+			pthread_cond_wait(&pool->cond, &pool->mutex);
+
+		if (pool->stop) {
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+
+		job = pool->head;
+		pool->head = job->next;
+		if (pool->head == NULL)
+			pool->tail = NULL;
+		pthread_mutex_unlock(&pool->mutex);
+
+		/* handle request, response is written to job buffer */
+		pool->on_recv(job->request, job->buf, worker->arg);
+
+		if (sizeof(job) != write(pool->done_fd[1], &job, sizeof(job))) {
+			fprintf(stderr, "httpd: cannot pass back a handled job.\n");
+			job_free(job);
+		}
+	}
+
+	return NULL;
+}
+
+static void on_connection_close(struct evhttp_connection *evcon, void *arg)
+{
+	struct httpd_job *job = (struct httpd_job*)arg;
+
+	/* request is freed along with connection, do not reply */
+	job->req = NULL;
+}
+
+static void on_jobs_done(evutil_socket_t fd, short events, void *arg)
+{
+	struct httpd_job *job;
+
+	/* reply all handled jobs */
+	while (sizeof(job) == read(fd, &job, sizeof(job))) {
+		if (job->req) {
+			evhttp_connection_set_closecb(
+				evhttp_request_get_connection(job->req), NULL, NULL);
+			evhttp_send_reply(job->req, HTTP_OK, "OK", job->buf);
+		}
+
+		job_free(job);
+	}
+}
+
+static void
+httpd_pool_callbk(struct evhttp_request *req, void *arg)
+{
+	struct httpd_pool *pool = (struct httpd_pool *)arg;
+	struct httpd_job *job;
+	char *request;
+
+	request = get_POST_str(req);
+	if (request == NULL) {
+		fprintf(stderr, "httpd: POST data is NULL.\n");
+		evhttp_send_reply(req, HTTP_OK, "OK", NULL);
+		return;
+	}
+
+	/* set HTTP response header */
+	evhttp_add_header(req->output_headers, "Content-Type",
+	                  "application/json; charset=UTF-8");
+	evhttp_add_header(req->output_headers, "Connection",
+	                  "close");
+
+	job = malloc(sizeof(struct httpd_job));
+	job->req = req;
+	job->request = request;
+	job->buf = evbuffer_new();
+	job->next = NULL;
+
+	evhttp_connection_set_closecb(evhttp_request_get_connection(req),
+	                              &on_connection_close, job);
+
+	/* enqueue job for workers */
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->tail)
+		pool->tail->next = job;
+	else
+		pool->head = job;
+	pool->tail = job;
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+static int
+pool_start(struct httpd_pool *pool, httpd_on_recv_cb on_recv,
+           void **args, unsigned int n_workers)
+{
+	unsigned int i;
+	sigset_t set, old_set;
+
+	pool->on_recv = on_recv;
+	pool->n_workers = n_workers;
+	pool->head = pool->tail = NULL;
+	pool->stop = 0;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+
+	if (pipe(pool->done_fd)) {
+		perror("pipe() function");
+		return 1;
+	}
+
+	/* event loop reads handled jobs until pipe is empty */
+	fcntl(pool->done_fd[0], F_SETFL, O_NONBLOCK);
+	event_set(&pool->done_ev, pool->done_fd[0], EV_READ | EV_PERSIST,
+	          &on_jobs_done, pool);
+	event_add(&pool->done_ev, NULL);
+
+	/* let signals go to event loop thread only */
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, &old_set);
+
+	pool->workers = malloc(sizeof(struct httpd_worker) * n_workers);
+	for (i = 0; i < n_workers; i++) {
+		pool->workers[i].arg = args[i];
+		pool->workers[i].pool = pool;
+		pthread_create(&pool->workers[i].tid, NULL, &worker_main,
+		               pool->workers + i);
+	}
+
+	pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+	return 0;
+}
+
+static void pool_stop(struct httpd_pool *pool)
+{
+	unsigned int i;
+	struct httpd_job *job;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (i = 0; i < pool->n_workers; i++)
+		pthread_join(pool->workers[i].tid, NULL);
+
+	/* free jobs not handled or not replied */
+	while ((job = pool->head) != NULL) {
+		pool->head = job->next;
+		job_drop(job);
+	}
+
+	while (sizeof(job) == read(pool->done_fd[0], &job, sizeof(job)))
+		job_drop(job);
+
+	event_del(&pool->done_ev);
+	close(pool->done_fd[0]);
+	close(pool->done_fd[1]);
+
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->cond);
+	free(pool->workers);
+}
+
+int httpd_run_pool(unsigned short port, httpd_on_recv_cb on_recv,
+                   void **args, unsigned int n_workers)
+{
+	struct evhttp *httpd;
+	struct httpd_pool pool;
+
+	/* initialization */
+	signal(SIGINT, signal_handler);
+	event_init();
+
+	/* binding */
+	httpd = httpd_listen(port);
+
+	/* check if port is already binded */
+	if (httpd == NULL) {
+		fprintf(stderr, "Failed to listen on port %d.\n", port);
+		return 1;
+	}
+
+	if (pool_start(&pool, on_recv, args, n_workers)) {
+		evhttp_free(httpd);
+		return 1;
+	}
+
+	/* set callback functions on receving */
+	evhttp_set_cb(httpd, SEARCHD_DEFAULT_URI,
+	              httpd_pool_callbk, &pool);
+
+	/* main loop */
+	event_dispatch();
+
+	/* closing */
+	printf("\n");
+	printf("shutdown httpd...\n");
+	pool_stop(&pool);
+	evhttp_free(httpd);
+
+	return 0;
+}
+
 int httpd_run(unsigned short port,
               httpd_on_recv_cb on_recv, void *arg)
 {
@@ -156,7 +469,7 @@ int httpd_run(unsigned short port,
 	event_init();
 
 	/* binding */
-	httpd = evhttp_start("0.0.0.0", port);
+	httpd = httpd_listen(port);
 
 	/* check if port is already binded */
 	if (httpd == NULL) {
@@ -178,3 +491,81 @@ int httpd_run(unsigned short port,
 
 	return 0;
 }
+
+/*
+ * pre-fork mode: forked processes run httpd on the same port, while
+ * parent process waits for them and passes stop signals to them.
+ */
+static volatile sig_atomic_t prefork_sig = 0;
+
+static void prefork_signal_handler(int sig)
+{
+	prefork_sig = sig;
+}
+
+int httpd_prefork(unsigned int n_procs)
+{
+	unsigned int i, n_alive = 0;
+	struct sigaction sa, old_int, old_term;
+	pid_t pid, *pids = calloc(n_procs, sizeof(pid_t));
+	int status;
+
+	/* do not let children inherit buffered output */
+	fflush(stdout);
+	fflush(stderr);
+
+	for (i = 0; i < n_procs; i++) {
+		pid = fork();
+		if (pid == 0) {
+			free(pids);
+			reuseport = 1;
+			return i;
+		} else if (pid < 0) {
+			perror("fork() function");
+			break;
+		}
+
+		pids[i] = pid;
+		n_alive ++;
+	}
+
+	/* no SA_RESTART, so that waitpid() is interrupted by signals */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = prefork_signal_handler;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, &old_int);
+	sigaction(SIGTERM, &sa, &old_term);
+
+	while (n_alive) {
+		pid = waitpid(-1, &status, 0);
+
+		if (pid < 0) {
+			if (errno != EINTR)
+				break;
+
+			if (prefork_sig) {
+				for (i = 0; i < n_procs; i++)
+					if (pids[i])
+						kill(pids[i], SIGINT);
+				prefork_sig = 0;
+			}
+
+			continue;
+		}
+
+		for (i = 0; i < n_procs; i++) {
+			if (pids[i] == pid) {
+				printf("httpd process #%u exits (status %d).\n", i,
+				       WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+				pids[i] = 0;
+				n_alive --;
+			}
+		}
+	}
+
+	sigaction(SIGINT, &old_int, NULL);
+	sigaction(SIGTERM, &old_term, NULL);
+
+	free(pids);
+	return -1;
+}
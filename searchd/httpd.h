@@ -1,5 +1,18 @@
-/* httpd on receive callback */
-typedef const char *(*httpd_on_recv_cb)(const char*, void*);
+struct evbuffer;
+
+/* httpd on receive callback, response is appended to a (per-request)
+ * output buffer. */
+typedef void (*httpd_on_recv_cb)(const char*, struct evbuffer*, void*);
 
 /* httpd start and loop function */
 int httpd_run(unsigned short, httpd_on_recv_cb, void*);
+
+/* httpd with a pool of worker threads handling requests, the i-th
+ * worker calls on-receive callback with the i-th argument. */
+int httpd_run_pool(unsigned short, httpd_on_recv_cb, void**, unsigned int);
+
+/* pre-fork mode: return (in each of forked processes) process index
+ * starting from 0, httpd run by a forked process listens on the port
+ * along with the others (SO_REUSEPORT). Parent process returns -1 when
+ * all forked processes exit, stop signals it receives are passed on. */
+int httpd_prefork(unsigned int);
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "search/config.h"
+
+#include "config.h"
+#include "rescache.h"
+
+static uint64_t results_mem_usage(ranked_results_t *rk_res)
+{
+	/* hit occurs are allocated for MAX_HIGHLIGHT_OCCURS positions */
+	return rk_res->heap.volume * sizeof(void*) + rk_res->n_elements *
+	       (sizeof(struct rank_hit) +
+	        MAX_HIGHLIGHT_OCCURS * sizeof(position_t));
+}
+
+static void free_ent(struct lru_cache_ent *ent)
+{
+	struct rescache_ent *r;
+	r = MEMBER_2_STRUCT(ent, struct rescache_ent, ent);
+
+	free_ranked_results(&r->results);
+	free(r);
+}
+
+int rescache_init(struct rescache *cache, uint64_t mem_limit)
+{
+	return lru_cache_init(&cache->lru, SEARCHD_RESCACHE_BUCKETS,
+	                      mem_limit, &free_ent);
+}
+
+void rescache_clear(struct rescache *cache)
+{
+	lru_cache_clear(&cache->lru);
+}
+
+void rescache_free(struct rescache *cache)
+{
+	lru_cache_free(&cache->lru);
+}
+
+ranked_results_t *rescache_get(struct rescache *cache, const char *key)
+{
+	struct lru_cache_ent *ent;
+	struct rescache_ent *r;
+
+	ent = lru_cache_get(&cache->lru, key);
+	if (ent == NULL)
+		return NULL;
+
+	r = MEMBER_2_STRUCT(ent, struct rescache_ent, ent);
+	return &r->results;
+}
+
+ranked_results_t *
+rescache_put(struct rescache *cache, const char *key,
+             ranked_results_t *rk_res)
+{
+	struct rescache_ent *r;
+
+	r = malloc(sizeof(struct rescache_ent));
+	r->results = *rk_res;
+	lru_cache_ent_init(&r->ent, key, sizeof(struct rescache_ent) +
+	                   results_mem_usage(rk_res));
+
+	lru_cache_put(&cache->lru, &r->ent);
+	return &r->results;
+}
+
+void rescache_release(struct rescache *cache, ranked_results_t *rk_res)
+{
+	struct rescache_ent *r;
+	r = MEMBER_2_STRUCT(rk_res, struct rescache_ent, results);
+
+	lru_cache_release(&cache->lru, &r->ent);
+}
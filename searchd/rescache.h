@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lru-cache/lru-cache.h"
+#include "term-index/term-index.h" /* for doc_id_t and position_t */
+#include "search/rank.h"
+
+/*
+ * ranked results cache: sorted top-K results of recent queries keyed by
+ * normalized query (without page number), so that other pages of a
+ * query are generated without running it again. Bounded by bytes and
+ * evicted in LRU order, results in use are pinned by reference count
+ * and an evicted entry is freed by its last user.
+ */
+struct rescache_ent {
+	struct lru_cache_ent ent;
+	ranked_results_t     results;
+};
+
+struct rescache {
+	struct lru_cache lru;
+};
+
+int  rescache_init(struct rescache*, uint64_t);
+void rescache_free(struct rescache*); /* no results should be pinned */
+
+/* drop all entries, e.g. when indices are reloaded */
+void rescache_clear(struct rescache*);
+
+/* return pinned cached results of a key, NULL if not cached */
+ranked_results_t *rescache_get(struct rescache*, const char*);
+
+/* cache sorted results of a key if they fit in memory limit, results
+ * are owned by cache afterwards, return them pinned (even if they are
+ * not cached, in which case they are freed upon release). */
+ranked_results_t *rescache_put(struct rescache*, const char*,
+                               ranked_results_t*);
+
+/* unpin results returned by functions above */
+void rescache_release(struct rescache*, ranked_results_t*);
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <event2/buffer.h>
+
+#include "wstring/wstring.h"
+
+#include "search/config.h"
+#include "search/search.h"
+
+#include "config.h"
+#include "respcache.h"
+
+static void free_ent(struct lru_cache_ent *ent)
+{
+	struct respcache_ent *r;
+	r = MEMBER_2_STRUCT(ent, struct respcache_ent, ent);
+
+	free(r->resp);
+	free(r);
+}
+
+int respcache_init(struct respcache *cache, uint64_t mem_limit)
+{
+	return lru_cache_init(&cache->lru, SEARCHD_RESPCACHE_BUCKETS,
+	                      mem_limit, &free_ent);
+}
+
+void respcache_clear(struct respcache *cache)
+{
+	lru_cache_clear(&cache->lru);
+}
+
+void respcache_free(struct respcache *cache)
+{
+	lru_cache_free(&cache->lru);
+}
+
+char *respcache_key(struct query *qry, uint32_t page)
+{
+	struct list_node *ln = qry->keywords.now;
+	struct query_keyword *kw;
+	char *key, *mbstr;
+	size_t sz, len;
+
+	/* page number, then keywords in their normalized order */
+	sz = 32;
+	key = malloc(sz);
+	len = sprintf(key, "%u", page);
+
+	if (ln) do {
+		kw = MEMBER_2_STRUCT(ln, struct query_keyword, ln);
+		mbstr = wstr2mbstr(kw->wstr);
+
+		if (len + strlen(mbstr) + 3 > sz) {
+			sz = (len + strlen(mbstr) + 3) * 2;
+			key = realloc(key, sz);
+		}
+
+		len += sprintf(key + len, "\n%c%s",
+		               (kw->type == QUERY_KEYWORD_TEX) ? 'M' : 'T', mbstr);
+		ln = ln->next;
+	} while (ln != qry->keywords.now);
+
+	return key;
+}
+
+bool respcache_get(struct respcache *cache, const char *key,
+                   struct evbuffer *buf)
+{
+	struct lru_cache_ent *ent;
+	struct respcache_ent *r;
+
+	ent = lru_cache_get(&cache->lru, key);
+	if (ent == NULL)
+		return 0;
+
+	/* pinned entry is not freed while we copy it */
+	r = MEMBER_2_STRUCT(ent, struct respcache_ent, ent);
+	evbuffer_add(buf, r->resp, r->resp_sz);
+	lru_cache_release(&cache->lru, ent);
+
+	return 1;
+}
+
+void respcache_put(struct respcache *cache, const char *key,
+                   struct evbuffer *buf)
+{
+	struct respcache_ent *r;
+	size_t resp_sz = evbuffer_get_length(buf);
+
+	r = malloc(sizeof(struct respcache_ent));
+	r->resp_sz = resp_sz;
+	r->resp = malloc(resp_sz);
+	evbuffer_copyout(buf, r->resp, resp_sz);
+	lru_cache_ent_init(&r->ent, key,
+	                   sizeof(struct respcache_ent) + resp_sz);
+
+	/* freed here if it is not cached */
+	lru_cache_put(&cache->lru, &r->ent);
+	lru_cache_release(&cache->lru, &r->ent);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lru-cache/lru-cache.h"
+
+struct query;
+struct evbuffer;
+
+/*
+ * response cache: response JSON of recent requests keyed by normalized
+ * query (see indices_prepare_query()) and page number, bounded by bytes
+ * and evicted in LRU order. Entries are only valid for the indices they
+ * are generated from, the cache is cleared when indices are reloaded.
+ */
+struct respcache_ent {
+	struct lru_cache_ent ent;
+	char                *resp;
+	size_t               resp_sz;
+};
+
+struct respcache {
+	struct lru_cache lru;
+};
+
+int  respcache_init(struct respcache*, uint64_t);
+void respcache_free(struct respcache*);
+
+/* drop all entries, e.g. when indices are reloaded */
+void respcache_clear(struct respcache*);
+
+/* return allocated key string of a prepared query and page number,
+ * page number zero for a key of all pages. */
+char *respcache_key(struct query*, uint32_t);
+
+/* append cached response to a buffer, return false if not cached */
+bool respcache_get(struct respcache*, const char*, struct evbuffer*);
+
+/* cache response (buffer content) of a key if it fits in memory limit */
+void respcache_put(struct respcache*, const char*, struct evbuffer*);
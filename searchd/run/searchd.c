@@ -11,15 +11,23 @@
 #include "config.h"
 #include "httpd.h"
 #include "utils.h"
+#include "respcache.h"
+#include "rescache.h"
 
-const char *httpd_on_recv(const char* req, void* arg_)
+/* response and ranked results caches of this process, shared by
+ * search threads */
+static struct respcache resp_cache;
+static struct rescache  res_cache;
+
+void httpd_on_recv(const char* req, struct evbuffer* out, void* arg_)
 {
 	P_CAST(args, struct searcher_args, arg_);
-	const char      *ret = NULL;
 	struct query     qry;
 	uint32_t         page;
 	ranked_results_t srch_res; /* search results */
+	ranked_results_t *results;
 	struct timer     timer;
+	char            *key = NULL, *res_key = NULL;
 
 #ifdef SEARCHD_LOG_ENABLE
 	FILE *log_fh = fopen(SEARCHD_LOG_FILE, "a");
@@ -49,28 +57,28 @@ const char *httpd_on_recv(const char* req, void* arg_)
 #ifdef SEARCHD_LOG_ENABLE
 		fprintf(log_fh, "requested JSON parse error.\n");
 #endif
-		ret = search_errcode_json(SEARCHD_RET_BAD_QRY_JSON);
+		search_errcode_json(out, SEARCHD_RET_BAD_QRY_JSON);
 		goto reply;
 
 	} else if (qry.len == 0) {
 #ifdef SEARCHD_LOG_ENABLE
 		fprintf(log_fh, "resulted qry of length zero.\n");
 #endif
-		ret = search_errcode_json(SEARCHD_RET_EMPTY_QRY);
+		search_errcode_json(out, SEARCHD_RET_EMPTY_QRY);
 		goto reply;
 
 	} else if (qry.n_math > MAX_ACCEPTABLE_MATH_KEYWORDS) {
 #ifdef SEARCHD_LOG_ENABLE
 		fprintf(log_fh, "qry contains too many math keywords.\n");
 #endif
-		ret = search_errcode_json(SEARCHD_RET_TOO_MANY_MATH_KW);
+		search_errcode_json(out, SEARCHD_RET_TOO_MANY_MATH_KW);
 		goto reply;
 
 	} else if (qry.n_term > MAX_ACCEPTABLE_TERM_KEYWORDS) {
 #ifdef SEARCHD_LOG_ENABLE
 		fprintf(log_fh, "qry contains too many term keywords.\n");
 #endif
-		ret = search_errcode_json(SEARCHD_RET_TOO_MANY_TERM_KW);
+		search_errcode_json(out, SEARCHD_RET_TOO_MANY_TERM_KW);
 		goto reply;
 	}
 
@@ -82,27 +90,49 @@ const char *httpd_on_recv(const char* req, void* arg_)
 	fflush(log_fh);
 #endif
 
-	/* search query */
+	/* look up response of normalized query */
+	indices_prepare_query(args->indices, &qry);
+	key = respcache_key(&qry, page);
+
+	if (respcache_get(&resp_cache, key, out)) {
 #ifdef SEARCHD_LOG_ENABLE
-	fprintf(log_fh, "run query...\n");
-	fflush(log_fh);
+		fprintf(log_fh, "return cached response.\n");
 #endif
+		goto reply;
+	}
 
-	srch_res = indices_run_query(args->indices, &qry);
+	/* other pages of this query may have been requested */
+	res_key = respcache_key(&qry, 0);
+	results = rescache_get(&res_cache, res_key);
+
+	if (results) {
+#ifdef SEARCHD_LOG_ENABLE
+		fprintf(log_fh, "use cached ranked results.\n");
+#endif
+	} else {
+		/* search query */
+#ifdef SEARCHD_LOG_ENABLE
+		fprintf(log_fh, "run query...\n");
+		fflush(log_fh);
+#endif
+		srch_res = indices_run_query(args->indices, &qry);
+		results = rescache_put(&res_cache, res_key, &srch_res);
+	}
 
 	/* generate response JSON */
 #ifdef SEARCHD_LOG_ENABLE
 	fprintf(log_fh, "return results...\n");
 	fflush(log_fh);
 #endif
-	ret = search_results_json(&srch_res, page - 1, args);
+	search_results_json(out, results, page - 1, args);
+	respcache_put(&resp_cache, key, out);
 
-	/* free ranked results */
+	/* release ranked results (freed if not cached) */
 #ifdef SEARCHD_LOG_ENABLE
-	fprintf(log_fh, "free results...\n");
+	fprintf(log_fh, "release results...\n");
 	fflush(log_fh);
 #endif
-	free_ranked_results(&srch_res);
+	rescache_release(&res_cache, results);
 
 reply:
 #ifdef SEARCHD_LOG_ENABLE
@@ -110,6 +140,8 @@ reply:
 	fflush(log_fh);
 #endif
 	query_delete(qry);
+	free(key);
+	free(res_key);
 
 #ifdef SEARCHD_LOG_ENABLE
 	fprintf(log_fh, "query handled, "
@@ -122,7 +154,6 @@ reply:
 	fprintf(log_fh, "\n");
 	fclose(log_fh);
 #endif
-	return ret;
 }
 
 int main(int argc, char *argv[])
@@ -131,13 +162,20 @@ int main(int argc, char *argv[])
 	char                 *index_path = NULL;
 	struct indices        indices;
 	unsigned short        cache_sz = SEARCHD_DEFAULT_CACHE_MB;
+	unsigned short        resp_cache_sz = SEARCHD_DEFAULT_RESPCACHE_MB;
+	unsigned short        res_cache_sz = SEARCHD_DEFAULT_RESCACHE_MB;
 	unsigned short        port = SEARCHD_DEFAULT_PORT;
 	text_lexer            lex = lex_eng_file;
 	char                 *dict_path = NULL;
 	struct searcher_args  searcher_args;
+	unsigned int          i, n_threads = 1, n_procs = 1;
+	unsigned int          n_readers = 0;
+	struct indices       *readers = NULL;
+	struct searcher_args *worker_args = NULL;
+	void                **worker_argp = NULL;
 
 	/* parse program arguments */
-	while ((opt = getopt(argc, argv, "hi:t:p:c:d:")) != -1) {
+	while ((opt = getopt(argc, argv, "hi:t:p:c:d:j:f:r:k:")) != -1) {
 		switch (opt) {
 		case 'h':
 			printf("DESCRIPTION:\n");
@@ -148,7 +186,11 @@ int main(int argc, char *argv[])
 			       " -i <index path> |"
 			       " -p <port> | "
 			       " -c <cache size (MB)> | "
-			       " -d <dict> "
+			       " -r <response cache size (MB)> | "
+			       " -k <ranked results cache size (MB)> | "
+			       " -d <dict> | "
+			       " -j <search threads> | "
+			       " -f <search processes> "
 			       "\n", argv[0]);
 			printf("\n");
 			goto exit;
@@ -165,11 +207,27 @@ int main(int argc, char *argv[])
 			sscanf(optarg, "%hu", &cache_sz);
 			break;
 
+		case 'r':
+			sscanf(optarg, "%hu", &resp_cache_sz);
+			break;
+
+		case 'k':
+			sscanf(optarg, "%hu", &res_cache_sz);
+			break;
+
 		case 'd':
 			dict_path = strdup(optarg);
 			lex = lex_mix_file;
 			break;
 
+		case 'j':
+			sscanf(optarg, "%u", &n_threads);
+			break;
+
+		case 'f':
+			sscanf(optarg, "%u", &n_procs);
+			break;
+
 		default:
 			printf("bad argument(s). \n");
 			goto exit;
@@ -202,17 +260,94 @@ int main(int argc, char *argv[])
 	printf("setup cache size: %hu MB\n", cache_sz);
 	indices_cache(&indices, cache_sz MB);
 
+	/* responses and results are valid as long as the opened indices,
+	 * caches would be cleared if indices were reloaded. */
+	printf("setup response cache size: %hu MB\n", resp_cache_sz);
+	if (respcache_init(&resp_cache, resp_cache_sz MB)) {
+		printf("response cache setup failed.\n");
+		goto close;
+	}
+
+	printf("setup ranked results cache size: %hu MB\n", res_cache_sz);
+	if (rescache_init(&res_cache, res_cache_sz MB)) {
+		printf("ranked results cache setup failed.\n");
+		goto close;
+	}
+
 	/* run httpd */
 	printf("listen on port %hu\n", port);
 
-	searcher_args.indices = &indices;
-	searcher_args.lex     = lex;
-	httpd_run(port, &httpd_on_recv, &searcher_args);
+	if (n_procs > 1) {
+		/* forked processes share cached lists, instead of copies */
+		printf("share cache with %u processes...\n", n_procs);
+		if (postcache_share(indices.cache)) {
+			printf("cache sharing failed.\n");
+			goto close;
+		}
+
+		if (httpd_prefork(n_procs) < 0)
+			goto close; /* all search processes have exited */
+
+		/* opened index files are shared with other processes, this
+		 * process needs its own readers even with one thread */
+		n_readers = n_threads;
+	} else if (n_threads > 1) {
+		n_readers = n_threads;
+	}
+
+	/* lists missed in (private) cache are admitted in background */
+	if (n_procs <= 1 && indices_cache_admitter(&indices, index_path)) {
+		printf("cache admitter start failed.\n");
+		goto close;
+	}
+
+	if (n_readers) {
+		/* every search thread has its own index readers */
+		printf("open %u index readers...\n", n_readers);
+		readers = malloc(sizeof(struct indices) * n_readers);
+		worker_args = malloc(sizeof(struct searcher_args) * n_readers);
+		worker_argp = malloc(sizeof(void*) * n_readers);
+
+		for (i = 0; i < n_readers; i++) {
+			if (indices_open_reader(readers + i, &indices, index_path)) {
+				printf("index reader open failed.\n");
+				n_readers = i + 1;
+				goto close;
+			}
+
+			worker_args[i].indices = readers + i;
+			worker_args[i].lex     = lex;
+			worker_argp[i] = worker_args + i;
+		}
+	}
+
+	if (n_threads > 1) {
+		printf("search with %u threads.\n", n_threads);
+		httpd_run_pool(port, &httpd_on_recv, worker_argp, n_threads);
+	} else if (n_readers) {
+		httpd_run(port, &httpd_on_recv, worker_argp[0]);
+	} else {
+		searcher_args.indices = &indices;
+		searcher_args.lex     = lex;
+		httpd_run(port, &httpd_on_recv, &searcher_args);
+	}
 
 close:
+	/* close index readers before the indices they share */
+	if (readers) {
+		for (i = 0; i < n_readers; i++)
+			indices_close_reader(readers + i);
+
+		free(readers);
+		free(worker_args);
+		free(worker_argp);
+	}
+
 	/* close indices */
 	printf("closing index...\n");
 	indices_close(&indices);
+	respcache_free(&resp_cache);
+	rescache_free(&res_cache);
 
 	/* close text-segment dictionary if opened */
 	if (lex == lex_mix_file) {
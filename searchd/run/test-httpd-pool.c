@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <event2/buffer.h>
+
+#include "mhook/mhook.h"
+#include "timer/timer.h"
+
+#include "config.h"
+#include "httpd.h"
+
+#define N_WORKERS 4
+
+static void httpd_on_recv(const char* req, struct evbuffer* out, void* arg_)
+{
+	int *worker = (int*)arg_;
+	printf("worker#%d: recv a request, wait 5 sec...\n", *worker);
+	delay(5, 0, 0);
+	printf("worker#%d: %s.\n", *worker, req);
+
+	evbuffer_add(out, req, strlen(req));
+}
+
+int main()
+{
+	int   i, ids[N_WORKERS];
+	void *args[N_WORKERS];
+
+	for (i = 0; i < N_WORKERS; i++) {
+		ids[i] = i;
+		args[i] = ids + i;
+	}
+
+	printf("listening (%u workers)...\n", N_WORKERS);
+	httpd_run_pool(8921, &httpd_on_recv, args, N_WORKERS);
+
+	mhook_print_unfree();
+	return 0;
+}
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <event2/buffer.h>
 
 #include "mhook/mhook.h"
 #include "timer/timer.h"
@@ -7,13 +9,13 @@
 #include "config.h"
 #include "httpd.h"
 
-static const char *httpd_on_recv(const char* req, void* arg_)
+static void httpd_on_recv(const char* req, struct evbuffer* out, void* arg_)
 {
 	printf("recv a request, wait 5 sec...\n");
 	delay(5, 0, 0);
 	printf("%s.\n", req);
 
-	return req;
+	evbuffer_add(out, req, strlen(req));
 }
 
 int main()
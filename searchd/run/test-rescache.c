@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mhook/mhook.h"
+#include "search/config.h"
+
+#undef N_DEBUG
+#include <assert.h>
+
+#include "rescache.h"
+
+static ranked_results_t gen_results(uint32_t n)
+{
+	ranked_results_t rk_res;
+	struct rank_hit *hit;
+	uint32_t i;
+
+	priority_Q_init(&rk_res, RANK_SET_DEFAULT_VOL);
+
+	for (i = 0; i < n; i++) {
+		hit = malloc(sizeof(struct rank_hit));
+		hit->docID = i + 1;
+		hit->score = (float)i;
+		hit->occurs = malloc(sizeof(position_t) * MAX_HIGHLIGHT_OCCURS);
+		hit->n_occurs = 1;
+		hit->occurs[0] = i;
+		priority_Q_add_or_replace(&rk_res, hit);
+	}
+
+	priority_Q_sort(&rk_res);
+	return rk_res;
+}
+
+int main()
+{
+	struct rescache cache;
+	ranked_results_t rk_res, *res, *pinned;
+	struct rank_hit *top;
+	char key[32];
+	uint32_t i;
+
+	/* room for a couple of entries only */
+	rescache_init(&cache, 3 * (sizeof(struct rescache_ent) + 32 +
+	              RANK_SET_DEFAULT_VOL * sizeof(void*) +
+	              20 * (sizeof(struct rank_hit) +
+	                    MAX_HIGHLIGHT_OCCURS * sizeof(position_t))));
+
+	/* pin the first entry */
+	rk_res = gen_results(20);
+	pinned = rescache_put(&cache, "0\nTkey0", &rk_res);
+
+	for (i = 1; i < 8; i++) {
+		sprintf(key, "0\nTkey%u", i);
+		rk_res = gen_results(20);
+		res = rescache_put(&cache, key, &rk_res);
+		rescache_release(&cache, res);
+
+		printf("put %s, %u entries (%lu bytes)\n", key + 2,
+		       cache.lru.n_ents, cache.lru.mem_usage);
+		assert(cache.lru.mem_usage <= cache.lru.mem_limit);
+	}
+
+	/* evicted entry is still valid while pinned */
+	assert(NULL == rescache_get(&cache, "0\nTkey0"));
+	top = (struct rank_hit*)pinned->heap.array[0];
+	assert(pinned->n_elements == 20 && top->docID == 20);
+	rescache_release(&cache, pinned);
+
+	/* recent entry is cached */
+	res = rescache_get(&cache, "0\nTkey7");
+	assert(res != NULL && res->n_elements == 20);
+
+	/* results too large to be cached are freed upon release */
+	rk_res = gen_results(RANK_SET_DEFAULT_VOL);
+	pinned = rescache_put(&cache, "0\nTkey8", &rk_res);
+	assert(NULL == rescache_get(&cache, "0\nTkey8"));
+	rescache_release(&cache, pinned);
+
+	rescache_release(&cache, res);
+	rescache_clear(&cache);
+	assert(cache.lru.n_ents == 0 && cache.lru.mem_usage == 0);
+	rescache_free(&cache);
+
+	printf("passed.\n");
+	mhook_print_unfree();
+	return 0;
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <event2/buffer.h>
+
+#include "mhook/mhook.h"
+
+#undef N_DEBUG
+#include <assert.h>
+
+#include "respcache.h"
+
+/* take out buffer content as a string */
+static const char *get_str(struct evbuffer *buf)
+{
+	static char str[64];
+	size_t len = evbuffer_get_length(buf);
+
+	evbuffer_remove(buf, str, len);
+	str[len] = '\0';
+	return str;
+}
+
+int main()
+{
+	struct respcache cache;
+	struct evbuffer *buf = evbuffer_new();
+	char key[32], resp[64];
+	uint32_t i;
+
+	/* room for a few entries only */
+	respcache_init(&cache, 4 * (sizeof(struct respcache_ent) + 64));
+
+	for (i = 0; i < 16; i++) {
+		sprintf(key, "%u\nTkey%u", 1 + i % 2, i);
+		sprintf(resp, "{\"i\": %u}", i);
+		evbuffer_add(buf, resp, strlen(resp));
+		respcache_put(&cache, key, buf);
+		evbuffer_drain(buf, strlen(resp));
+
+		/* keep the first entry recently used */
+		assert(respcache_get(&cache, "1\nTkey0", buf));
+		assert(0 == strcmp(get_str(buf), "{\"i\": 0}"));
+
+		printf("put `%s', %u entries (%lu bytes)\n", resp,
+		       cache.lru.n_ents, cache.lru.mem_usage);
+		assert(cache.lru.mem_usage <= cache.lru.mem_limit);
+	}
+
+	/* least recently used entries are evicted */
+	assert(!respcache_get(&cache, "2\nTkey1", buf));
+	assert(respcache_get(&cache, "2\nTkey15", buf));
+	assert(0 == strcmp(get_str(buf), "{\"i\": 15}"));
+
+	respcache_clear(&cache);
+	assert(cache.lru.n_ents == 0 && cache.lru.mem_usage == 0);
+	assert(!respcache_get(&cache, "1\nTkey0", buf));
+
+	respcache_free(&cache);
+	evbuffer_free(buf);
+
+	printf("passed.\n");
+	mhook_print_unfree();
+	return 0;
+}
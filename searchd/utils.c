@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <event2/buffer.h>
 
 #include "txt-seg/config.h"
 #include "txt-seg/txt-seg.h"
@@ -15,12 +16,6 @@
 #include "config.h"
 #include "utils.h"
 
-#define MAX_SEARCHD_RESPONSE_JSON_SZ \
-	(MAX_SNIPPET_SZ * DEFAULT_RES_PER_PAGE)
-
-/* response construction buffer */
-static char response[MAX_SEARCHD_RESPONSE_JSON_SZ];
-
 /* parse JSON keyword result */
 enum parse_json_kw_res {
 	PARSE_JSON_KW_LACK_KEY,
@@ -30,9 +25,10 @@ enum parse_json_kw_res {
 
 /* append_result() callback function arguments */
 struct append_result_args {
-	struct indices *indices;
-	text_lexer      lex;
-	uint32_t        n_results;
+	struct indices  *indices;
+	text_lexer       lex;
+	uint32_t         n_results;
+	struct evbuffer *buf; /* response */
 };
 
 /*
@@ -168,28 +164,26 @@ free:
 }
 
 /*
- * Response construction related
+ * Response construction related, responses are appended to a
+ * (per-request) buffer.
  */
-static const char
-*response_head_str(enum searchd_ret_code code,
-                   uint32_t tot_pages)
+static void
+response_head(struct evbuffer *buf, enum searchd_ret_code code,
+              uint32_t tot_pages)
 {
-	static char head_str[MAX_SEARCHD_RESPONSE_JSON_SZ];
-
-	sprintf(head_str,
+	evbuffer_add_printf(buf,
 		"\"ret_code\": %d, "    /* return code */
 		"\"ret_str\": \"%s\", " /* code-corresponding string */
 		"\"tot_pages\": %u",    /* number of total pages */
 		code, searchd_ret_str_map[code], tot_pages
 	);
-
-	return head_str;
 }
 
-const char *search_errcode_json(enum searchd_ret_code code)
+void search_errcode_json(struct evbuffer *buf, enum searchd_ret_code code)
 {
-	sprintf(response, "{%s}\n", response_head_str(code, 0));
-	return response;
+	evbuffer_add(buf, "{", 1);
+	response_head(buf, code, 0);
+	evbuffer_add(buf, "}\n", 2);
 }
 
 void json_encode_str(char *dest, const char *src)
@@ -199,62 +193,77 @@ void json_encode_str(char *dest, const char *src)
 	free(enc_str);
 }
 
-static const char
-*response_hit_str(doc_id_t docID, float score, const char *title,
-                  const char *url, const char *snippet)
+void json_encode_to(struct evbuffer *buf, const char *src, size_t len)
 {
-	static char hit_str[MAX_SEARCHD_RESPONSE_JSON_SZ];
-	static char enc_snippet[MAX_SNIPPET_SZ];
-
-	/*
-	 * encode into JSON string (encoded snippet is already
-	 * enclosed by double quotes)
-	 */
-	json_encode_str(enc_snippet, snippet);
+	static const char hex[] = "0123456789abcdef";
+	const char *run = src, *end = src + len;
+	char esc[8];
+	size_t esc_len;
+
+	evbuffer_add(buf, "\"", 1);
+
+	/* escape the same characters as json_encode_string() does,
+	 * characters between escaped ones are appended in runs. */
+	for (; src < end; src++) {
+		esc_len = 2;
+		esc[0] = '\\';
+
+		switch (*src) {
+		case '\"':  esc[1] = '\"';  break;
+		case '\\': esc[1] = '\\'; break;
+		case '/':  esc[1] = '/';  break;
+		case '\b': esc[1] = 'b';  break;
+		case '\f': esc[1] = 'f';  break;
+		case '\n': esc[1] = 'n';  break;
+		case '\r': esc[1] = 'r';  break;
+		case '\t': esc[1] = 't';  break;
+		default:
+			if ((unsigned char)*src >= 0x20)
+				continue;
+
+			sprintf(esc, "\\u00%c%c", hex[*src >> 4], hex[*src & 0xf]);
+			esc_len = 6;
+		}
 
-	sprintf(hit_str, "{"
-		"\"docid\": %u, "     /* hit docID */
-		"\"score\": %.3f, "   /* hit score */
-		"\"title\": %s, "     /* hit title */
-		"\"url\": \"%s\", "   /* hit document URL */
-		"\"snippet\": %s"     /* hit document snippet */
-		"}",
-		docID, score, title, url, enc_snippet
-	);
+		evbuffer_add(buf, run, src - run);
+		evbuffer_add(buf, esc, esc_len);
+		run = src + 1;
+	}
 
-	return hit_str;
+	evbuffer_add(buf, run, end - run);
+	evbuffer_add(buf, "\"", 1);
 }
 
-static char *extract_title_string(const char *doc)
+static void
+response_hit(struct evbuffer *buf, doc_id_t docID, float score,
+             const char *doc, const char *url, const char *snippet)
 {
-	char *title = NULL;
-	char *sep = strstr(doc, "\n\n");
-
-	if (NULL == sep) {
-		const char no_title[] = "\"No title available.\"";
-		title = malloc(strlen(no_title) + 1);
-		strcpy(title, no_title);
-	} else {
-		unsigned int len = sep - doc;
-		char *raw_title = malloc(len + 1);
+	const char *sep = strstr(doc, "\n\n");
 
-		/* extract titile into raw_title */
-		memcpy(raw_title, doc, len);
-		raw_title[len] = '\0';
+	evbuffer_add_printf(buf, "{"
+		"\"docid\": %u, "     /* hit docID */
+		"\"score\": %.3f, ",  /* hit score */
+		docID, score
+	);
 
-		/* JSON encode raw_title to titile */
-		title = json_encode_string(raw_title);
-		free(raw_title);
-	}
+	/* hit title, the first paragraph of document */
+	evbuffer_add_printf(buf, "\"title\": ");
+	if (NULL == sep)
+		evbuffer_add_printf(buf, "\"No title available.\"");
+	else
+		json_encode_to(buf, doc, sep - doc);
 
-	return title;
+	/* hit document URL and snippet */
+	evbuffer_add_printf(buf, ", \"url\": \"%s\", \"snippet\": ", url);
+	json_encode_to(buf, snippet, strlen(snippet));
+	evbuffer_add(buf, "}", 1);
 }
 
 static void
 append_result(struct rank_hit* hit, uint32_t cnt, void* arg)
 {
-	char       *url, *doc, *title;
-	const char *snippet, *hit_json;
+	char       *url, *doc;
+	const char *snippet;
 	size_t      url_sz, doc_sz;
 	list        hl_list;
 	doc_id_t    docID = hit->docID;
@@ -279,14 +288,14 @@ append_result(struct rank_hit* hit, uint32_t cnt, void* arg)
 #ifdef DEBUG_APPEND_RESULTS
 	printf("getting URL...\n");
 #endif
-	url = get_blob_string(indices->url_bi, docID, 0, &url_sz);
+	url = get_blob_string(indices->url_bi, docID, NULL, &url_sz);
 
 	/* get document text */
 #ifdef DEBUG_APPEND_RESULTS
 	printf("getting doc text...\n");
 #endif
-	doc = get_blob_string(indices->txt_bi, docID, 1, &doc_sz);
-	title = extract_title_string(doc);
+	doc = get_blob_string(indices->txt_bi, docID, indices->txt_codec,
+	                      &doc_sz);
 
 	/* prepare highlighter arguments */
 #ifdef DEBUG_APPEND_RESULTS
@@ -304,20 +313,23 @@ append_result(struct rank_hit* hit, uint32_t cnt, void* arg)
 		free(hit->occurs);
 		hit->occurs = malloc(sizeof(position_t));
 		hit->occurs[0] = 0;
-		hl_list = prepare_snippet(hit, esc,
-		                          doc_sz, app_args->lex);
-		free(esc);
+		/* snippet is written from escaped string */
+		free(doc);
+		doc = esc;
+		doc_sz = strlen(esc);
+		hl_list = prepare_snippet(hit, doc, doc_sz, app_args->lex);
 	}
 #else
-	hl_list = prepare_snippet(hit, doc, doc_sz, app_args->lex);
+	hl_list = prepare_snippet_indexed(indices, hit, doc, doc_sz,
+	                                  app_args->lex);
 #endif
 
 	/* get snippet */
 #ifdef DEBUG_APPEND_RESULTS
 	printf("getting snippet...\n");
 #endif
-	snippet = snippet_highlighted(&hl_list,
-                                  SEARCHD_HIGHLIGHT_OPEN,
+	snippet = snippet_highlighted(&hl_list, doc,
+	                              SEARCHD_HIGHLIGHT_OPEN,
 	                              SEARCHD_HIGHLIGHT_CLOSE);
 
 	/* free highlight list */
@@ -330,24 +342,22 @@ append_result(struct rank_hit* hit, uint32_t cnt, void* arg)
 #ifdef DEBUG_APPEND_RESULTS
 	printf("append JSON result...\n");
 #endif
-	hit_json = response_hit_str(docID, score, title, url, snippet);
-	strcat(response, hit_json);
+	response_hit(app_args->buf, docID, score, doc, url, snippet);
 
 	if (cnt + 1 < app_args->n_results)
-		strcat(response, ", ");
+		evbuffer_add(app_args->buf, ", ", 2);
 
 	/* free allocated strings */
 #ifdef DEBUG_APPEND_RESULTS
-	printf("free URL, doc, title strings...\n");
+	printf("free URL, doc strings...\n");
 #endif
 	free(url);
 	free(doc);
-	free(title);
 }
 
-const char
-*search_results_json(ranked_results_t *rk_res, uint32_t i,
-                     struct searcher_args *se_args)
+void
+search_results_json(struct evbuffer *buf, ranked_results_t *rk_res,
+                    uint32_t i, struct searcher_args *se_args)
 {
 	struct rank_window wind;
 	uint32_t tot_pages;
@@ -357,10 +367,13 @@ const char
 	                        &tot_pages);
 
 	/* check requested page number legality */
-	if ((i | tot_pages) == 0)
-		return search_errcode_json(SEARCHD_RET_NO_HIT_FOUND);
-	else if (i >= tot_pages)
-		return search_errcode_json(SEARCHD_RET_ILLEGAL_PAGENUM);
+	if ((i | tot_pages) == 0) {
+		search_errcode_json(buf, SEARCHD_RET_NO_HIT_FOUND);
+		return;
+	} else if (i >= tot_pages) {
+		search_errcode_json(buf, SEARCHD_RET_ILLEGAL_PAGENUM);
+		return;
+	}
 
 	/* check window calculation validity */
 	if (wind.to > 0) {
@@ -369,21 +382,18 @@ const char
 		struct append_result_args app_args = {
 			se_args->indices,
 			se_args->lex,
-			n_results
+			n_results,
+			buf
 		};
 
-		sprintf(
-			response, "{%s, \"hits\": [", response_head_str(
-				SEARCHD_RET_SUCC, tot_pages
-			)
-		);
+		evbuffer_add(buf, "{", 1);
+		response_head(buf, SEARCHD_RET_SUCC, tot_pages);
+		evbuffer_add_printf(buf, ", \"hits\": [");
 
 		rank_window_foreach(&wind, &append_result, &app_args);
-		strcat(response, "]}\n");
+		evbuffer_add(buf, "]}\n", 3);
 	} else {
 		/* not valid calculation, return error */
-		return search_errcode_json(SEARCHD_RET_WIND_CALC_ERR);
+		search_errcode_json(buf, SEARCHD_RET_WIND_CALC_ERR);
 	}
-
-	return response;
 }
@@ -1,3 +1,5 @@
+struct evbuffer;
+
 /*
  * Searchd response (JSON) code/string
  */
@@ -32,10 +34,12 @@ uint32_t parse_json_qry(const char*, text_lexer, struct query*);
 /* encode a C string into JSON string */
 void json_encode_str(char*, const char*);
 
-/* get response JSON with search results */
-const char
-*search_results_json(ranked_results_t*, uint32_t,
-                     struct searcher_args*);
+/* append JSON string encoded from a string of given length */
+void json_encode_to(struct evbuffer*, const char*, size_t);
+
+/* append response JSON with search results */
+void search_results_json(struct evbuffer*, ranked_results_t*, uint32_t,
+                         struct searcher_args*);
 
-/* get response JSON to indicate an error */
-const char *search_errcode_json(enum searchd_ret_code);
+/* append response JSON to indicate an error */
+void search_errcode_json(struct evbuffer*, enum searchd_ret_code);
@@ -47,6 +47,12 @@ void *term_index_open(const char *path, enum term_index_open_flag flag)
 		} else {
 			return NULL;
 		}
+	} else if (flag == TERM_INDEX_OPEN_READ) {
+		if (indri::collection::Repository::exists(path)) {
+			ti->repo.openRead(path, &ti->parameters);
+		} else {
+			return NULL;
+		}
 	} else {
 		return NULL;
 	}
@@ -134,6 +140,34 @@ doc_id_t term_index_doc_end(void *handle)
 	return new_docID;
 }
 
+doc_id_t term_index_doc_copy(void *handle, void *src_handle, doc_id_t doc_id)
+{
+	struct term_index *ti = (struct term_index*)handle;
+	struct term_index *src = (struct term_index*)src_handle;
+	const indri::index::TermList *tl = src->index->termList(doc_id);
+	size_t i;
+
+	if (tl == NULL)
+		return 0;
+
+	term_index_doc_begin(ti);
+
+	const indri::utility::greedy_vector<lemur::api::TERMID_T> &terms =
+		tl->terms();
+
+	for (i = 0; i < terms.size(); i++) {
+		if (terms[i] == 0)
+			/* stopped term, keep its position */
+			ti->document.terms.push_back(NULL);
+		else
+			term_index_doc_add(ti,
+				(char*)src->index->term(terms[i]).c_str());
+	}
+
+	delete tl;
+	return term_index_doc_end(ti);
+}
+
 uint32_t term_index_get_termN(void *handle)
 {
 	struct term_index *ti = (struct term_index*)handle;
@@ -176,64 +210,80 @@ char *term_lookup_r(void *handle, term_id_t term_id)
 	return strdup(ti->index->term(term_id).c_str());
 }
 
+/* posting list iterator, the current item is kept in iterator so that
+ * different posting lists (merged together, or by concurrent queries)
+ * never share an item object. */
+#pragma pack(push, 1)
+struct term_posting_item_with_pos {
+	doc_id_t   doc_id;
+	uint32_t   tf;
+	position_t pos_arr[MAX_TERM_INDEX_ITEM_POSITIONS];
+};
+#pragma pack(pop)
+
+struct term_posting {
+	indri::index::DocListIterator    *it;
+	struct term_posting_item_with_pos item;
+};
+
 void *term_index_get_posting(void *handle, term_id_t term_id)
 {
 	struct term_index *ti = (struct term_index*)handle;
-	return ti->index->docListIterator(term_id);
+	struct term_posting *po;
+	indri::index::DocListIterator *it;
+
+	it = ti->index->docListIterator(term_id);
+	if (it == NULL)
+		return NULL;
+
+	po = new struct term_posting;
+	po->it = it;
+	return po;
 }
 
 bool term_posting_start(void *posting)
 {
-	indri::index::DocListIterator *po = (indri::index::DocListIterator*)posting;
+	struct term_posting *po = (struct term_posting*)posting;
 
-	po->startIteration();
-	return (0 == po->finished());
+	po->it->startIteration();
+	return (0 == po->it->finished());
 }
 
 /* returns false if pass the last posting item. */
 bool term_posting_next(void *posting)
 {
-	indri::index::DocListIterator *po = (indri::index::DocListIterator*)posting;
-	return po->nextEntry();
+	struct term_posting *po = (struct term_posting*)posting;
+	return po->it->nextEntry();
 }
 
 /* find the first document which contains an ID >= given ID.
  * returns false if no such document exists. */
 bool term_posting_jump(void *posting, uint64_t doc_id)
 {
-	indri::index::DocListIterator *po = (indri::index::DocListIterator*)posting;
-	return po->nextEntry(doc_id);
+	struct term_posting *po = (struct term_posting*)posting;
+	return po->it->nextEntry(doc_id);
 }
 
 void term_posting_finish(void *posting)
 {
-	indri::index::DocListIterator *po = (indri::index::DocListIterator*)posting;
+	struct term_posting *po = (struct term_posting*)posting;
+	delete po->it;
 	delete po;
 }
 
-#include "search/config.h" /* for MAX_MERGE_POSTINGS */
-
 struct term_posting_item *term_posting_cur_item(void *posting)
 {
-	static struct term_posting_item *ret, q[MAX_MERGE_POSTINGS];
-	static int i = 0;
-
-	indri::index::DocListIterator *po = (indri::index::DocListIterator*)posting;
+	struct term_posting *po = (struct term_posting*)posting;
+	struct term_posting_item_with_pos *ret = &po->item;
 	indri::index::DocListIterator::DocumentData *doc;
-	doc = po->currentEntry();
+
+	doc = po->it->currentEntry();
 
 	if (doc) {
-		/* a hacky way to return term_posting_item pointers. This array is
-		 * made of MAX_MERGE_POSTINGS objects to avoid different posting
-		 * lists referring to the same object at merge time, which leads to
-		 * all query terms sharing an identical term-frequency, and a wrong
-		 * score as a result. */
-		ret = &q[i];
-		i = (i + 1) % MAX_MERGE_POSTINGS;
 		ret->doc_id = doc->document;
 		ret->tf = doc->positions.size();
 
-		return ret;
+		return (struct term_posting_item *)ret;
 	} else {
 		return NULL;
 	}
@@ -241,28 +291,14 @@ struct term_posting_item *term_posting_cur_item(void *posting)
 
 struct term_posting_item *term_posting_cur_item_with_pos(void *posting)
 {
-	static int i = 0;
-
-#pragma pack(push, 1)
-	static struct _item_with_pos {
-		doc_id_t   doc_id;
-		uint32_t   tf;
-		position_t pos_arr[MAX_TERM_INDEX_ITEM_POSITIONS];
-	} q[MAX_MERGE_POSTINGS];
-#pragma pack(pop)
-
-	unsigned int k;
-	static struct _item_with_pos *ret;
-
-	indri::index::DocListIterator *po = (indri::index::DocListIterator*)posting;
+	struct term_posting *po = (struct term_posting*)posting;
+	struct term_posting_item_with_pos *ret = &po->item;
 	indri::index::DocListIterator::DocumentData *doc;
+	unsigned int k;
 
-	doc = po->currentEntry();
+	doc = po->it->currentEntry();
 
 	if (doc) {
-		ret = &q[i];
-		i = (i + 1) % MAX_MERGE_POSTINGS;
-
 		ret->doc_id = doc->document;
 		ret->tf = doc->positions.size();
 
@@ -15,7 +15,8 @@ typedef uint32_t position_t;
 
 enum term_index_open_flag {
 	TERM_INDEX_OPEN_CREATE,
-	TERM_INDEX_OPEN_EXISTS
+	TERM_INDEX_OPEN_EXISTS,
+	TERM_INDEX_OPEN_READ /* existing, read-only (can be opened again) */
 };
 
 void *term_index_open(const char *, enum term_index_open_flag);
@@ -27,6 +28,10 @@ void     term_index_doc_begin(void *);
 void     term_index_doc_add(void *, char *);
 doc_id_t term_index_doc_end(void *);
 
+/* add a document of another term index (same term sequence),
+ * return the new docID, or 0 if source document does not exist. */
+doc_id_t term_index_doc_copy(void *, void *, doc_id_t);
+
 uint32_t term_index_get_termN(void *); /* unique terms */
 /* Indri bug: call term_index_get_docN() during indexing will crash shortly */
 uint32_t term_index_get_docN(void *); /* number of document in collection */
@@ -1,18 +1,23 @@
 %{
 #include "head.h"
 
-/* parser interfaces */
-struct optr_node *grammar_optr_root = NULL;
-bool grammar_err_flag = 0;
-char grammar_last_err_str[MAX_GRAMMAR_ERR_STR_LEN] = "";
-
 /* handy macro */
 #define OPTR_ATTACH(_ret, _child1, _child2, _father) \
 	optr_attach(_child1, _father); \
 	optr_attach(_child2, _father); \
-	_ret = grammar_optr_root = _father;
+	_ret = ctx->optr_root = _father;
 %}
 
+/* ==============================================
+ * pure parser, all states are kept in scanner
+ * and a per-call context (see yy.h)
+ * ==============================================*/
+%define api.pure full
+%define api.prefix {tex}
+%lex-param   {void *scanner}
+%parse-param {void *scanner}
+%parse-param {struct tex_parse_ctx *ctx}
+
 /* =========================
  * data type and destructor
  * ========================*/
@@ -29,6 +34,10 @@ char grammar_last_err_str[MAX_GRAMMAR_ERR_STR_LEN] = "";
 
 %error-verbose
 
+%code {
+int texlex(TEXSTYPE*, void*);
+}
+
 /* ====================
  * token definitions
  * ===================*/
@@ -517,14 +526,14 @@ pair: _L_BRACKET tex _R_BRACKET {
 ;
 %%
 
-/* yyerror shows grammar error */
-int yyerror(const char *msg)
+/* texerror shows grammar error */
+int texerror(void *scanner, struct tex_parse_ctx *ctx, const char *msg)
 {
-	strcpy(grammar_last_err_str, msg);
+	strcpy(ctx->err_str, msg);
 
 	/* set root to NULL to avoid double free */
-	grammar_optr_root = NULL;
-	grammar_err_flag = 1;
+	ctx->optr_root = NULL;
+	ctx->err_flag = 1;
 
 	return 0;
 }
@@ -9,7 +9,7 @@
 #include "tree/tree.h"
 #include "gen-token.h"
 #include "gen-symbol.h"
-#include "yy.h"
 #include "trans.h"
 #include "tex-parser.h"
+#include "yy.h"
 #include "optr.h"
@@ -10,7 +10,6 @@ enum {
 };
 
 static int depth_flag[MAX_OPTR_PRINT_DEPTH];
-static bool gen_subpaths_bitmap[MAX_SUBPATH_ID * 2];
 
 struct optr_node* optr_alloc(enum symbol_id s_id, enum token_id t_id, bool uwc)
 {
@@ -375,9 +374,15 @@ void insert_subpath_nodes(struct subpath *subpath, struct optr_node *p)
 	} while(p);
 }
 
+struct gen_subpaths_arg {
+	struct subpaths *ret;
+	bool             bitmap[MAX_SUBPATH_ID * 2];
+};
+
 static TREE_IT_CALLBK(gen_subpaths)
 {
-	P_CAST(ret, struct subpaths, pa_extra);
+	P_CAST(arg, struct gen_subpaths_arg, pa_extra);
+	struct subpaths  *ret = arg->ret;
 	TREE_OBJ(struct optr_node, p, tnd);
 	struct subpath   *subpath;
 	struct optr_node *f;
@@ -405,12 +410,12 @@ static TREE_IT_CALLBK(gen_subpaths)
 				bitmap_idx --; /* map to [0, 63] */
 
 				/* insert only when not inserted before */
-				if (!gen_subpaths_bitmap[bitmap_idx]) {
+				if (!arg->bitmap[bitmap_idx]) {
 					subpath = create_subpath(p, is_leaf);
 					insert_subpath_nodes(subpath, p);
 					list_insert_one_at_tail(&subpath->ln, &ret->li,
 					                        NULL, NULL);
-					gen_subpaths_bitmap[bitmap_idx] = 1;
+					arg->bitmap[bitmap_idx] = 1;
 
 					/* count total subpaths generated. */
 					ret->n_subpaths ++;
@@ -429,15 +434,17 @@ static TREE_IT_CALLBK(gen_subpaths)
 struct subpaths optr_subpaths(struct optr_node* optr)
 {
 	struct subpaths subpaths;
+	struct gen_subpaths_arg arg;
 	LIST_CONS(subpaths.li);
 	subpaths.n_lr_paths = 0;
 	subpaths.n_subpaths = 0;
 
-	/* clear bitmap */
-	memset(gen_subpaths_bitmap, 0, sizeof(bool) * (MAX_SUBPATH_ID << 1));
+	/* clear bitmap (per call, so that it is reentrant) */
+	arg.ret = &subpaths;
+	memset(arg.bitmap, 0, sizeof(bool) * (MAX_SUBPATH_ID << 1));
 
 	tree_foreach(&optr->tnd, &tree_post_order_DFS, &gen_subpaths,
-	             0 /* excluding root */, &subpaths);
+	             0 /* excluding root */, &arg);
 	return subpaths;
 }
 
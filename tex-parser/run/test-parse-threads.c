@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "tex-parser.h"
+
+/*
+ * parse expressions from concurrent threads, every parse result
+ * should be identical to its single-threaded result.
+ */
+#define N_THREADS 8
+#define N_ROUNDS  200
+
+static const char *test[] = {
+	"a_1^2",
+	"\\frac{a+b}{c} = \\sqrt{x^2 + y^2}",
+	"\\begin{matrix} a & b \\\\ c & d \\end{matrix} + \\array{1 & 2}",
+	"f(x) = \\sum_{i=1}^n x_i \\text{ for all } x",
+	"\\left( a \\over b \\right) \\binom{n}{k}",
+	"1.25 + x \\times y - z!",
+	"(a + b", /* grammar error */
+	"\\int_0^\\infty e^{-x} dx"
+};
+
+#define N_TEST (sizeof(test) / sizeof(test[0]))
+
+static uint64_t signature(struct tex_parse_ret *ret)
+{
+	uint64_t sig = ret->code;
+	struct list_it it;
+	struct list_node *ln, *pn;
+	struct subpath *sp;
+	struct subpath_node *nd;
+
+	if (ret->code == PARSER_RETCODE_ERR)
+		return sig;
+
+	sig = sig * 31 + ret->subpaths.n_lr_paths;
+	sig = sig * 31 + ret->subpaths.n_subpaths;
+
+	it = ret->subpaths.li;
+	ln = it.now;
+	while (ln) {
+		sp = MEMBER_2_STRUCT(ln, struct subpath, ln);
+		sig = sig * 31 + sp->path_id;
+		sig = sig * 31 + sp->type;
+		sig = sig * 31 + sp->lf_symbol_id;
+		sig = sig * 31 + sp->fr_hash;
+
+		pn = sp->path_nodes.now;
+		while (pn) {
+			nd = MEMBER_2_STRUCT(pn, struct subpath_node, ln);
+			sig = sig * 31 + nd->token_id;
+
+			pn = (pn->next == sp->path_nodes.now) ? NULL : pn->next;
+		}
+
+		ln = (ln->next == it.now) ? NULL : ln->next;
+	}
+
+	subpaths_release(&ret->subpaths);
+	return sig;
+}
+
+static uint64_t parse_sig(const char *tex)
+{
+	struct tex_parse_ret ret = tex_parse(tex, 0, false);
+	return signature(&ret);
+}
+
+static uint64_t expected[N_TEST];
+
+static void *parse_thread(void *arg)
+{
+	uint32_t i, r, *n_diff = arg;
+
+	for (r = 0; r < N_ROUNDS; r++)
+		for (i = 0; i < N_TEST; i++)
+			if (parse_sig(test[i]) != expected[i])
+				(*n_diff) ++;
+
+	return NULL;
+}
+
+int main()
+{
+	pthread_t thread[N_THREADS];
+	uint32_t  i, n_diff[N_THREADS] = {0}, tot_diff = 0;
+
+	for (i = 0; i < N_TEST; i++)
+		expected[i] = parse_sig(test[i]);
+
+	for (i = 0; i < N_THREADS; i++)
+		pthread_create(thread + i, NULL, &parse_thread, n_diff + i);
+
+	for (i = 0; i < N_THREADS; i++) {
+		pthread_join(thread[i], NULL);
+		tot_diff += n_diff[i];
+	}
+
+	printf("%u threads x %u parses, %u differ.\n", N_THREADS,
+	       N_ROUNDS * (uint32_t)N_TEST, tot_diff);
+
+	return tot_diff;
+}
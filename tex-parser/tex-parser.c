@@ -1,10 +1,5 @@
 #include "head.h"
 
-extern struct optr_node *grammar_optr_root;
-extern bool grammar_err_flag;
-extern char grammar_last_err_str[];
-extern int  lexer_warning_flag;
-
 static char *mk_scan_buf(const char *str, size_t *out_sz)
 {
 	char *buf;
@@ -20,27 +15,28 @@ struct tex_parse_ret
 tex_parse(const char *tex_str, size_t len, bool keep_optr)
 {
 	struct tex_parse_ret ret;
+	struct tex_parse_ctx ctx = {NULL, 0, "", 0, 0, 0};
+	struct optr_node *grammar_optr_root;
+	yyscan_t scanner;
 	YY_BUFFER_STATE state_buf;
 	char *scan_buf;
 	size_t scan_buf_sz;
 
-	/* create parser buffer */
+	/* create scanner and parser buffer */
+	texlex_init_extra(&ctx, &scanner);
 	scan_buf = mk_scan_buf(tex_str, &scan_buf_sz);
-	state_buf = yy_scan_buffer(scan_buf, scan_buf_sz);
-
-	/* clear flags */
-	grammar_err_flag = 0;
-	lexer_warning_flag = 0;
+	state_buf = tex_scan_buffer(scan_buf, scan_buf_sz, scanner);
 
 	/* do parse */
-	yyparse();
+	texparse(scanner, &ctx);
+	grammar_optr_root = ctx.optr_root;
 
 	/* free parser buffer */
-	yy_delete_buffer(state_buf);
+	tex_delete_buffer(state_buf, scanner);
 	free(scan_buf);
 
 	/* avoid memory leakage */
-	yylex_destroy();
+	texlex_destroy(scanner);
 
 	/* return operator tree or not, depends on `keep_optr' */
 	if (keep_optr)
@@ -49,10 +45,10 @@ tex_parse(const char *tex_str, size_t len, bool keep_optr)
 		ret.operator_tree = NULL;
 
 	/* is there any grammar error? */
-	if (grammar_err_flag) {
+	if (ctx.err_flag) {
 		/* grammar error */
 		ret.code = PARSER_RETCODE_ERR;
-		strcpy(ret.msg, grammar_last_err_str);
+		strcpy(ret.msg, ctx.err_str);
 	} else {
 		if (grammar_optr_root) {
 			uint32_t max_path_id;
@@ -68,7 +64,7 @@ tex_parse(const char *tex_str, size_t len, bool keep_optr)
 			if (max_path_id <= MAX_SUBPATH_ID) {
 				ret.subpaths = optr_subpaths(grammar_optr_root);
 
-				if (lexer_warning_flag) {
+				if (ctx.warning_flag) {
 					ret.code = PARSER_RETCODE_WARN;
 					strcpy(ret.msg, "character(s) escaped.");
 				} else {
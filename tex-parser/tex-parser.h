@@ -11,8 +11,9 @@ typedef uint16_t symbol_id_t;
 
 #define MAX_PARSER_ERR_STR  1024
 
-/* assigned pathID is in [1, 64] */
-#define MAX_SUBPATH_ID      64
+/* assigned pathID is in [1, 255], number of paths must also fit
+ * in the (8-bit) pathinfo_num_t of math index. */
+#define MAX_SUBPATH_ID      255
 
 enum subpath_type {
 	SUBPATH_TYPE_GENERNODE,
@@ -51,6 +52,8 @@ struct tex_parse_ret {
 	void            *operator_tree;
 };
 
+/* parse a TeX string, reentrant (every call has its own scanner
+ * and parser state), so it can be called by concurrent threads. */
 struct tex_parse_ret tex_parse(const char *, size_t,
                                bool /* keep operator tree */);
 
@@ -1,12 +1,36 @@
 #include <stddef.h>
-extern int yyparse();
-extern int yyerror(const char *);
-extern int yylex();
-extern int yylex_destroy();
+#include <stdbool.h>
+
+struct optr_node;
+
+/*
+ * context of a single tex_parse() call, passed to the pure parser
+ * and to the reentrant lexer (as its extra data), so that different
+ * threads can parse at the same time.
+ */
+struct tex_parse_ctx {
+	struct optr_node *optr_root;
+	bool              err_flag;
+	char              err_str[MAX_GRAMMAR_ERR_STR_LEN];
+	int               warning_flag; /* set by lexer */
+	unsigned int      ign_stack, mat_stack;
+};
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+/* TeX scanner and parser are prefixed by "tex", so that they do not
+ * clash with the (non-reentrant) "yy" lexers of other modules */
+extern int texparse(void *, struct tex_parse_ctx *);
+extern int texerror(void *, struct tex_parse_ctx *, const char *);
+extern int texlex_init_extra(struct tex_parse_ctx *, yyscan_t *);
+extern int texlex_destroy(yyscan_t);
 
 struct yy_buffer_state;
 typedef struct yy_buffer_state *YY_BUFFER_STATE;
 typedef size_t yy_size_t;
 
-YY_BUFFER_STATE yy_scan_buffer(char *, yy_size_t);
-void yy_delete_buffer(YY_BUFFER_STATE);
+YY_BUFFER_STATE tex_scan_buffer(char *, yy_size_t, yyscan_t);
+void tex_delete_buffer(YY_BUFFER_STATE, yyscan_t);
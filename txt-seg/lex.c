@@ -2,6 +2,7 @@
 #include "lex.h"
 
 lex_handle_callbk g_lex_handler = NULL;
+pthread_mutex_t   g_lex_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int lex_handler_last_err = 0;
 
 size_t lex_bytes_now = 0;
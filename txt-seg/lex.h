@@ -1,6 +1,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #ifndef LEX_DEF_HEAD
 #define LEX_DEF_HEAD /* begin LEX_DEF_HEAD */
@@ -40,6 +41,10 @@ typedef int (*lex_handle_callbk)(struct lex_slice *);
 
 extern lex_handle_callbk g_lex_handler;
 
+/* lexers and the handler are global, concurrent threads should hold
+ * this lock from setting the handler until lexing is done. */
+extern pthread_mutex_t g_lex_mutex;
+
 /* lexer invoke functions */
 int lex_eng_file(FILE*);
 int lex_mix_file(FILE*);
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <locale.h>
 #include <string.h>
+#include <pthread.h>
 #include "wstring.h"
 #include "config.h"
 
@@ -20,9 +21,18 @@ size_t mbstr_chars(const char *mbstr)
 	return mbstowcs(NULL, mbstr, 0);
 }
 
+/* setlocale() is not thread-safe, set it only once */
+static pthread_once_t locale_once = PTHREAD_ONCE_INIT;
+
+static void set_locale(void)
+{
+	setlocale(LC_ALL, "en_US.UTF-8");
+}
+
+/* conversion results are returned in per-thread buffers */
 wchar_t *mbstr2wstr(const char *multibyte_string)
 {
-	static wchar_t retstr[MAX_WSTR_CONV_BUF_LEN];
+	static __thread wchar_t retstr[MAX_WSTR_CONV_BUF_LEN];
 
 	/* mbstowcs() will convert a string from the 
 	 * current locale's multibyte encoding into a 
@@ -30,16 +40,16 @@ wchar_t *mbstr2wstr(const char *multibyte_string)
 	 * are not necessarily unicode, but on Linux they 
 	 * are.
 	 */
-	setlocale(LC_ALL, "en_US.UTF-8");
+	pthread_once(&locale_once, &set_locale);
 	mbstowcs(retstr, multibyte_string, MAX_WSTR_CONV_BUF_LEN);
 	return retstr;
 }
 
 char *wstr2mbstr(const wchar_t *wide_string)
 {
-	static char retstr[MAX_STR_CONV_BUF_LEN];
+	static __thread char retstr[MAX_STR_CONV_BUF_LEN];
 
-	setlocale(LC_ALL, "en_US.UTF-8");
+	pthread_once(&locale_once, &set_locale);
 	wcstombs(retstr, wide_string, MAX_STR_CONV_BUF_LEN);
 
 	return retstr;
@@ -31,6 +31,18 @@ static __inline void eng_to_lower_case_w(wchar_t *str, size_t n)
 		str[i] = towlower(str[i]);
 }
 
+/* djb2 hash of a (byte) string, e.g. a key in string hash tables */
+#include <stdint.h>
+static __inline uint32_t str_hash(const char *str)
+{
+	uint32_t h = 5381;
+
+	while (*str)
+		h = ((h << 5) + h) + (unsigned char)(*str++);
+
+	return h;
+}
+
 /*
  * Many of C’s string functions are locale-independent
  * and they just look at zero-terminated byte sequences: